@@ -0,0 +1,768 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bitset_world.h"
+#include "room_catalog.h"
+#include "room_index.h"
+#include "world.h"
+#include "world_generator.h"
+#include "world_verifier.h"
+#include "CuTest.h"
+
+/*
+ * The most words a row or a room mask can have.
+ */
+#define BITSET_MAX_WORDS (BITSET_WORLD_MAX_ROOMS / 64)
+
+static uint64_t *bitset_row_of(struct BitsetWorld *world, const size_t room) {
+    return world->adjacency + room * world->num_words;
+}
+
+static inline size_t row_degree(const uint64_t *row, const size_t num_words) {
+    size_t degree = 0;
+    size_t w;
+
+    for (w = 0; w < num_words; ++w) {
+        degree += __builtin_popcountll(row[w]);
+    }
+
+    return degree;
+}
+
+static void set_bit(uint64_t *mask, const size_t bit) {
+    mask[bit / 64] |= (uint64_t) 1 << (bit % 64);
+}
+
+static void clear_bit(uint64_t *mask, const size_t bit) {
+    mask[bit / 64] &= ~((uint64_t) 1 << (bit % 64));
+}
+
+/*
+ * Returns a uniformly chosen set bit among the first num_bits of the given
+ * mask or BITSET_UNREACHABLE if it is empty. The masks the generator draws
+ * from are mostly full, so a few random probes usually find a set bit before
+ * the bits need to be counted.
+ */
+static inline size_t random_bit(const uint64_t *mask, const size_t num_words,
+        const size_t num_bits, struct Xoshiro256 *rng) {
+    size_t total = 0;
+    size_t probe;
+    size_t w;
+
+    for (probe = 0; probe < 4; ++probe) {
+        const size_t bit = xoshiro_below(rng, num_bits);
+
+        if ((mask[bit / 64] >> (bit % 64)) & 1) {
+            return bit;
+        }
+    }
+
+    for (w = 0; w < num_words; ++w) {
+        total += __builtin_popcountll(mask[w]);
+    }
+
+    if (total == 0) {
+        return BITSET_UNREACHABLE;
+    }
+
+    size_t rank = xoshiro_below(rng, total);
+
+    for (w = 0; ; ++w) {
+        const size_t count = __builtin_popcountll(mask[w]);
+
+        if (rank < count) {
+            uint64_t bits = mask[w];
+
+            while (rank-- > 0) {
+                bits &= bits - 1;
+            }
+
+            return w * 64 + __builtin_ctzll(bits);
+        }
+
+        rank -= count;
+    }
+}
+
+/*
+ * Constructs a new BitsetWorld of unconnected, unnamed MID_ROOMs. Rows are the
+ * narrowest of 64, 128 or 256 bits that fit every room.
+ *
+ * @param num_rooms The number of rooms.
+ * @return A pointer to a new BitsetWorld or NULL if num_rooms is 0 or above
+ * BITSET_WORLD_MAX_ROOMS.
+ */
+struct BitsetWorld *new_bitset_world(const size_t num_rooms) {
+    if (num_rooms == 0 || num_rooms > BITSET_WORLD_MAX_ROOMS) {
+        return NULL;
+    }
+
+    size_t num_words = 1;
+    size_t i;
+
+    while (num_words * 64 < num_rooms) {
+        num_words *= 2;
+    }
+
+    // The rows, names and types share one allocation with the world so that
+    // a small world costs a single malloc
+    const size_t adjacency_size = num_rooms * num_words * sizeof(uint64_t);
+    const size_t names_size = num_rooms * sizeof(char*);
+    struct BitsetWorld *world = (struct BitsetWorld*) calloc(1,
+            sizeof(struct BitsetWorld) + adjacency_size + names_size
+            + num_rooms * sizeof(room_t));
+
+    world->num_rooms = num_rooms;
+    world->num_words = num_words;
+    world->max_connections = MAX_CONNECTIONS;
+    world->adjacency = (uint64_t*) (world + 1);
+    world->names = (const char**) ((char*) world->adjacency + adjacency_size);
+    world->types = (room_t*) ((char*) world->names + names_size);
+
+    for (i = 0; i < num_rooms; ++i) {
+        world->types[i] = MID_ROOM;
+    }
+
+    return world;
+}
+
+/*
+ * Constructs a new BitsetWorld with the rooms and connections of the given
+ * world, numbered in RoomList order. The names are borrowed from the rooms,
+ * which must outlive it.
+ *
+ * @param world A pointer to a RoomList.
+ * @return A pointer to a new BitsetWorld or NULL if the world is too large or
+ * has a self loop, a duplicate connection or a connection to a room outside
+ * of it.
+ */
+struct BitsetWorld *new_bitset_world_from(const struct RoomList *world) {
+    struct BitsetWorld *bitset = new_bitset_world(world->size);
+
+    if (bitset == NULL) {
+        return NULL;
+    }
+
+    struct RoomIndex *index = new_room_index(world, 1);
+    bool ok = true;
+    size_t i;
+    size_t j;
+
+    for (i = 0; ok && i < index->size; ++i) {
+        const struct Room *room = index->rooms[i];
+        uint64_t *row = bitset_row_of(bitset, i);
+
+        bitset->names[i] = room->name;
+        bitset->types[i] = room->type;
+
+        if (room->max_connections > bitset->max_connections) {
+            bitset->max_connections = room->max_connections;
+        }
+
+        for (j = index->offsets[i]; ok && j < index->offsets[i + 1]; ++j) {
+            const size_t other = index->neighbors[j];
+
+            ok = other != ROOM_INDEX_NONE && other != i
+                && !bitset_connected(bitset, i, other);
+
+            if (ok) {
+                set_bit(row, other);
+            }
+        }
+    }
+
+    del_room_index(index);
+
+    if (!ok) {
+        del_bitset_world(bitset);
+        return NULL;
+    }
+
+    return bitset;
+}
+
+/*
+ * Destructs a BitsetWorld. The names it borrows are left alone.
+ *
+ * @param world A pointer to a BitsetWorld.
+ */
+void del_bitset_world(struct BitsetWorld *world) {
+    free(world);
+}
+
+/*
+ * Connects rooms a and b, the way add_connection does for Rooms.
+ *
+ * @param world A pointer to a BitsetWorld.
+ * @param a The id of a room.
+ * @param b The id of another room.
+ * @return Whether the rooms were connected. Fails for a self loop, rooms that
+ * are already connected or a room with no connection available.
+ */
+bool bitset_connect(struct BitsetWorld *world, const size_t a, const size_t b) {
+    if (a == b || bitset_connected(world, a, b)
+            || bitset_degree(world, a) >= world->max_connections
+            || bitset_degree(world, b) >= world->max_connections) {
+        return false;
+    }
+
+    set_bit(bitset_row_of(world, a), b);
+    set_bit(bitset_row_of(world, b), a);
+
+    return true;
+}
+
+/*
+ * Disconnects rooms a and b.
+ *
+ * @param world A pointer to a BitsetWorld.
+ * @param a The id of a room.
+ * @param b The id of another room.
+ * @return Whether the rooms were connected.
+ */
+bool bitset_disconnect(struct BitsetWorld *world, const size_t a,
+        const size_t b) {
+    if (!bitset_connected(world, a, b)) {
+        return false;
+    }
+
+    clear_bit(bitset_row_of(world, a), b);
+    clear_bit(bitset_row_of(world, b), a);
+
+    return true;
+}
+
+static inline size_t distances_in_words(const struct BitsetWorld *world,
+        const size_t source, size_t *distances, const size_t num_words) {
+    uint64_t visited[BITSET_MAX_WORDS] = { 0 };
+    uint64_t frontier[BITSET_MAX_WORDS] = { 0 };
+    size_t reached = 1;
+    size_t distance;
+    size_t i;
+    size_t w;
+
+    for (i = 0; i < world->num_rooms; ++i) {
+        distances[i] = BITSET_UNREACHABLE;
+    }
+
+    distances[source] = 0;
+    set_bit(visited, source);
+    set_bit(frontier, source);
+
+    for (distance = 1; reached < world->num_rooms; ++distance) {
+        uint64_t next[BITSET_MAX_WORDS] = { 0 };
+        bool any = false;
+
+        for (w = 0; w < num_words; ++w) {
+            uint64_t bits = frontier[w];
+
+            while (bits != 0) {
+                const uint64_t *row = bitset_row(world,
+                        w * 64 + __builtin_ctzll(bits));
+                size_t k;
+
+                for (k = 0; k < num_words; ++k) {
+                    next[k] |= row[k];
+                }
+
+                bits &= bits - 1;
+            }
+        }
+
+        for (w = 0; w < num_words; ++w) {
+            uint64_t bits = next[w] & ~visited[w];
+
+            frontier[w] = bits;
+            visited[w] |= bits;
+            any = any || bits != 0;
+
+            while (bits != 0) {
+                distances[w * 64 + __builtin_ctzll(bits)] = distance;
+                ++reached;
+                bits &= bits - 1;
+            }
+        }
+
+        if (!any) {
+            break;
+        }
+    }
+
+    return reached;
+}
+
+/*
+ * Computes the number of connections between the given room and every other
+ * with a breadth-first search whose frontier is a bitmask: each level ORs the
+ * rows of the frontier together and masks out the rooms already seen.
+ *
+ * @param world A pointer to a BitsetWorld.
+ * @param source The id of the room to start from.
+ * @param distances An array of num_rooms distances to fill in, set to
+ * BITSET_UNREACHABLE for rooms that cannot be reached.
+ * @return The number of rooms reached, the source included.
+ */
+size_t bitset_distances(const struct BitsetWorld *world, const size_t source,
+        size_t *distances) {
+    // Dispatching on the row width lets every word loop be unrolled
+    switch (world->num_words) {
+        case 1:
+            return distances_in_words(world, source, distances, 1);
+        case 2:
+            return distances_in_words(world, source, distances, 2);
+        default:
+            return distances_in_words(world, source, distances, 4);
+    }
+}
+
+static inline void connect_in_words(struct BitsetWorld *world,
+        const size_t min_connections, struct Xoshiro256 *rng,
+        const size_t num_words) {
+    uint64_t open[BITSET_MAX_WORDS] = { 0 };
+    uint64_t short_rooms[BITSET_MAX_WORDS] = { 0 };
+    uint64_t stuck[BITSET_MAX_WORDS] = { 0 };
+    uint64_t choices[BITSET_MAX_WORDS];
+    uint16_t degrees[BITSET_WORLD_MAX_ROOMS];
+    size_t num_short = 0;
+    size_t i;
+    size_t w;
+
+    for (i = 0; i < world->num_rooms; ++i) {
+        const size_t degree = row_degree(bitset_row(world, i), num_words);
+
+        degrees[i] = degree;
+
+        if (degree < world->max_connections) {
+            set_bit(open, i);
+        }
+
+        if (degree < min_connections) {
+            set_bit(short_rooms, i);
+            ++num_short;
+        }
+    }
+
+    while (num_short > 0) {
+        for (w = 0; w < num_words; ++w) {
+            choices[w] = short_rooms[w] & ~stuck[w];
+        }
+
+        const size_t a = random_bit(choices, num_words, world->num_rooms, rng);
+
+        if (a == BITSET_UNREACHABLE) {
+            break;
+        }
+
+        const uint64_t *row = bitset_row(world, a);
+
+        for (w = 0; w < num_words; ++w) {
+            choices[w] = open[w] & ~row[w];
+        }
+
+        clear_bit(choices, a);
+
+        const size_t b = random_bit(choices, num_words, world->num_rooms, rng);
+
+        if (b == BITSET_UNREACHABLE) {
+            set_bit(stuck, a);
+            continue;
+        }
+
+        set_bit(bitset_row_of(world, a), b);
+        set_bit(bitset_row_of(world, b), a);
+
+        const size_t ends[] = { a, b };
+        size_t e;
+
+        for (e = 0; e < 2; ++e) {
+            const size_t degree = ++degrees[ends[e]];
+
+            if (degree == world->max_connections) {
+                clear_bit(open, ends[e]);
+            }
+
+            if (degree == min_connections) {
+                clear_bit(short_rooms, ends[e]);
+                --num_short;
+            }
+        }
+    }
+}
+
+/*
+ * Adds random connections until every room has at least min_connections, the
+ * way the classic game builds its world: a random room that still needs
+ * connections is connected to a random room that is not full and not already
+ * connected to it. Picking the first room among the rooms that are short,
+ * rather than among every room that is not full, keeps larger worlds from
+ * filling every other room up before a short one gets its turn. Both picks
+ * are taken from bitmasks rather than by trial and error. Rooms that cannot
+ * be connected any further are left short.
+ *
+ * @param world A pointer to a BitsetWorld.
+ * @param min_connections The minimum number of connections of every room.
+ * @param rng The random number generator to draw from.
+ */
+void connect_bitset_world(struct BitsetWorld *world,
+        const size_t min_connections, struct Xoshiro256 *rng) {
+    switch (world->num_words) {
+        case 1:
+            connect_in_words(world, min_connections, rng, 1);
+            break;
+        case 2:
+            connect_in_words(world, min_connections, rng, 2);
+            break;
+        default:
+            connect_in_words(world, min_connections, rng, 4);
+            break;
+    }
+}
+
+/*
+ * Constructs the world of a classic game: CLASSIC_WORLD_ROOMS distinct rooms
+ * drawn from the catalog, one START_ROOM, one END_ROOM and every room with at
+ * least CLASSIC_WORLD_MIN_CONNECTIONS connections. Seven rooms with three
+ * connections each cannot be split in two, so the world is always connected.
+ *
+ * @param rng The random number generator to draw from.
+ * @return A pointer to a new BitsetWorld.
+ */
+struct BitsetWorld *new_classic_bitset_world(struct Xoshiro256 *rng) {
+    struct BitsetWorld *world = new_bitset_world(CLASSIC_WORLD_ROOMS);
+    size_t picks[BITSET_WORLD_MAX_ROOMS];
+    size_t i;
+
+    for (i = 0; i < ROOM_CATALOG_SIZE; ++i) {
+        picks[i] = i;
+    }
+
+    for (i = 0; i < CLASSIC_WORLD_ROOMS; ++i) {
+        const size_t j = i + xoshiro_below(rng, ROOM_CATALOG_SIZE - i);
+        const size_t pick = picks[j];
+
+        picks[j] = picks[i];
+        picks[i] = pick;
+        world->names[i] = catalog_name(pick);
+    }
+
+    world->types[0] = START_ROOM;
+    world->types[1] = END_ROOM;
+    connect_bitset_world(world, CLASSIC_WORLD_MIN_CONNECTIONS, rng);
+
+    return world;
+}
+
+/*
+ * Constructs a new world of Rooms with the rooms and connections of the given
+ * BitsetWorld, in id order. Unnamed rooms are named "Room <id>".
+ *
+ * @param world A pointer to a BitsetWorld.
+ * @return A pointer to a new world.
+ */
+struct RoomList *new_world_from_bitset(const struct BitsetWorld *world) {
+    struct RoomList *rooms = new_room_list();
+    struct Room **by_id = (struct Room**) malloc(world->num_rooms *
+            sizeof(struct Room*));
+    char name[32];
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < world->num_rooms; ++i) {
+        snprintf(name, sizeof(name), "Room %zu", i);
+        by_id[i] = new_room(world->names[i] != NULL ? world->names[i] : name,
+                world->types[i]);
+
+        if (world->max_connections > MAX_CONNECTIONS) {
+            set_max_connections(by_id[i], world->max_connections);
+        }
+
+        add_room(rooms, by_id[i]);
+    }
+
+    for (i = 0; i < world->num_rooms; ++i) {
+        for (j = i + 1; j < world->num_rooms; ++j) {
+            if (bitset_connected(world, i, j)) {
+                add_connection(by_id[i], by_id[j]);
+            }
+        }
+    }
+
+    free(by_id);
+
+    return rooms;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Computes distances over the pointer graph of an indexed world by following
+ * each room's connections, the way the game walks it.
+ */
+static size_t room_distances(const struct RoomIndex *index,
+        const size_t source, size_t *distances, size_t *queue) {
+    size_t head = 0;
+    size_t tail = 0;
+    size_t i;
+
+    for (i = 0; i < index->size; ++i) {
+        distances[i] = BITSET_UNREACHABLE;
+    }
+
+    distances[source] = 0;
+    queue[tail++] = source;
+
+    while (head < tail) {
+        const size_t id = queue[head++];
+        const struct Room *room = index->rooms[id];
+
+        for (i = 0; i < room->num_connections; ++i) {
+            const size_t other = room_index_find(index, room->connections[i]);
+
+            if (distances[other] == BITSET_UNREACHABLE) {
+                distances[other] = distances[id] + 1;
+                queue[tail++] = other;
+            }
+        }
+    }
+
+    return tail;
+}
+
+void bitset_connect_when_duplicate_or_full_should_fail(CuTest *tc) {
+    // Given
+    struct BitsetWorld *world = new_bitset_world(100);
+    size_t i;
+
+    for (i = 1; i <= MAX_CONNECTIONS; ++i) {
+        CuAssertIntEquals(tc, true, bitset_connect(world, 0, 70 + i));
+    }
+
+    // When / Then
+    CuAssertIntEquals(tc, 2, world->num_words);
+    CuAssertIntEquals(tc, MAX_CONNECTIONS, bitset_degree(world, 0));
+    CuAssertIntEquals(tc, false, bitset_connect(world, 71, 0));
+    CuAssertIntEquals(tc, false, bitset_connect(world, 0, 5));
+    CuAssertIntEquals(tc, false, bitset_connect(world, 5, 5));
+    CuAssertIntEquals(tc, true, bitset_disconnect(world, 71, 0));
+    CuAssertIntEquals(tc, false, bitset_connected(world, 0, 71));
+    CuAssertIntEquals(tc, true, bitset_connect(world, 0, 5));
+
+    // Clean up
+    del_bitset_world(world);
+}
+
+void new_bitset_world_when_too_many_rooms_should_return_null(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(BITSET_WORLD_MAX_ROOMS + 1, 4);
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, new_bitset_world(0));
+    CuAssertPtrEquals(tc, NULL, new_bitset_world_from(world));
+
+    // Clean up
+    del_world(world);
+}
+
+void bitset_distances_should_match_room_world(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_random_world(200, 3, 41);
+    struct RoomIndex *index = new_room_index(world, 1);
+    struct BitsetWorld *bitset = new_bitset_world_from(world);
+    size_t expected[200];
+    size_t actual[200];
+    size_t queue[200];
+    size_t source;
+    size_t i;
+
+    CuAssertPtrNotNull(tc, bitset);
+    CuAssertIntEquals(tc, 4, bitset->num_words);
+
+    for (source = 0; source < 200; source += 17) {
+        // When
+        const size_t reached = bitset_distances(bitset, source, actual);
+
+        // Then
+        CuAssertIntEquals(tc, room_distances(index, source, expected, queue),
+                reached);
+
+        for (i = 0; i < 200; ++i) {
+            CuAssertIntEquals(tc, expected[i], actual[i]);
+        }
+    }
+
+    // Clean up
+    del_bitset_world(bitset);
+    del_room_index(index);
+    del_world(world);
+}
+
+void new_classic_bitset_world_should_be_a_valid_game_world(CuTest *tc) {
+    struct Xoshiro256 rng;
+    size_t i;
+    size_t j;
+
+    seed_xoshiro(&rng, 344);
+
+    for (i = 0; i < 100; ++i) {
+        // Given
+        struct BitsetWorld *world = new_classic_bitset_world(&rng);
+
+        // When
+        struct RoomList *rooms = new_world_from_bitset(world);
+        struct VerifyReport *report = verify_world(rooms,
+                CLASSIC_WORLD_MIN_CONNECTIONS, 1);
+
+        // Then
+        CuAssertIntEquals(tc, true, verify_report_ok(report));
+
+        for (j = 0; j < CLASSIC_WORLD_ROOMS; ++j) {
+            CuAssertTrue(tc, find_catalog_name(world->names[j])
+                    != ROOM_CATALOG_NONE);
+        }
+
+        // Clean up
+        del_verify_report(report);
+        del_world(rooms);
+        del_bitset_world(world);
+    }
+}
+
+CuSuite *get_bitset_world_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bitset_connect_when_duplicate_or_full_should_fail);
+    SUITE_ADD_TEST(suite, new_bitset_world_when_too_many_rooms_should_return_null);
+    SUITE_ADD_TEST(suite, bitset_distances_should_match_room_world);
+    SUITE_ADD_TEST(suite, new_classic_bitset_world_should_be_a_valid_game_world);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Builds a classic game world out of Rooms the way the game always has,
+ * picking random rooms until a valid pair turns up.
+ */
+static struct RoomList *new_classic_room_world(struct Xoshiro256 *rng) {
+    struct RoomList *world = new_room_list();
+    struct Room *rooms[CLASSIC_WORLD_ROOMS];
+    size_t picks[BITSET_WORLD_MAX_ROOMS];
+    size_t num_short = CLASSIC_WORLD_ROOMS;
+    size_t i;
+
+    for (i = 0; i < ROOM_CATALOG_SIZE; ++i) {
+        picks[i] = i;
+    }
+
+    for (i = 0; i < CLASSIC_WORLD_ROOMS; ++i) {
+        const size_t j = i + xoshiro_below(rng, ROOM_CATALOG_SIZE - i);
+        const size_t pick = picks[j];
+
+        picks[j] = picks[i];
+        picks[i] = pick;
+        rooms[i] = new_catalog_room(pick, i == 0 ? START_ROOM
+                : (i == 1 ? END_ROOM : MID_ROOM));
+        add_room(world, rooms[i]);
+    }
+
+    while (num_short > 0) {
+        struct Room *a;
+        struct Room *b;
+
+        do {
+            a = rooms[xoshiro_below(rng, CLASSIC_WORLD_ROOMS)];
+        } while (a->num_connections >= CLASSIC_WORLD_MIN_CONNECTIONS);
+
+        do {
+            b = rooms[xoshiro_below(rng, CLASSIC_WORLD_ROOMS)];
+        } while (a == b || !has_connection_available(b) || has_connection(a, b));
+
+        add_connection(a, b);
+        num_short -= a->num_connections == CLASSIC_WORLD_MIN_CONNECTIONS;
+        num_short -= b->num_connections == CLASSIC_WORLD_MIN_CONNECTIONS;
+    }
+
+    return world;
+}
+
+void run_bitset_world_benchmark() {
+    const size_t num_worlds = 1000000;
+    const size_t sizes[] = { 7, 64, 128, 256 };
+    struct Xoshiro256 rng;
+    size_t checksum = 0;
+    size_t i;
+    size_t s;
+
+    seed_xoshiro(&rng, 41);
+    double start = now_seconds();
+
+    for (i = 0; i < num_worlds; ++i) {
+        struct RoomList *world = new_classic_room_world(&rng);
+        checksum += world->head->room->num_connections;
+        del_world(world);
+    }
+
+    const double room_seconds = now_seconds() - start;
+    start = now_seconds();
+
+    for (i = 0; i < num_worlds; ++i) {
+        struct BitsetWorld *world = new_classic_bitset_world(&rng);
+        checksum += bitset_degree(world, 0);
+        del_bitset_world(world);
+    }
+
+    const double bitset_seconds = now_seconds() - start;
+
+    printf("bitset_world: classic generation: rooms %.0f ns, bitset %.0f ns "
+            "per world\n", room_seconds / num_worlds * 1e9,
+            bitset_seconds / num_worlds * 1e9);
+
+    // Every-source BFS, the core of any distance or reachability query
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        const size_t n = sizes[s];
+        const size_t rounds = 2000000 / (n * n) + 1;
+        struct RoomList *world = n == CLASSIC_WORLD_ROOMS
+            ? new_classic_room_world(&rng) : new_random_world(n, 3, n);
+        struct RoomIndex *index = new_room_index(world, 1);
+        struct BitsetWorld *bitset = new_bitset_world_from(world);
+        size_t *distances = (size_t*) malloc(n * sizeof(size_t));
+        size_t *queue = (size_t*) malloc(n * sizeof(size_t));
+        size_t r;
+
+        start = now_seconds();
+
+        for (r = 0; r < rounds; ++r) {
+            for (i = 0; i < n; ++i) {
+                checksum += room_distances(index, i, distances, queue);
+            }
+        }
+
+        const double room_bfs = (now_seconds() - start) / (rounds * n);
+        start = now_seconds();
+
+        for (r = 0; r < rounds; ++r) {
+            for (i = 0; i < n; ++i) {
+                checksum += bitset_distances(bitset, i, distances);
+            }
+        }
+
+        const double bitset_bfs = (now_seconds() - start) / (rounds * n);
+
+        printf("bitset_world: %3zu rooms (%zu-bit rows): BFS rooms %.0f ns, "
+                "bitset %.0f ns\n", n, bitset->num_words * 64, room_bfs * 1e9,
+                bitset_bfs * 1e9);
+
+        free(queue);
+        free(distances);
+        del_bitset_world(bitset);
+        del_room_index(index);
+        del_world(world);
+    }
+
+    printf("bitset_world: checksum %zu\n", checksum);
+}
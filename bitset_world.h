@@ -0,0 +1,95 @@
+#ifndef BITSET_WORLD_H
+#define BITSET_WORLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "room.h"
+#include "room_list.h"
+#include "utils.h"
+
+/*
+ * The largest world a BitsetWorld can hold.
+ */
+#define BITSET_WORLD_MAX_ROOMS 256
+
+/*
+ * The distance bitset_distances gives rooms it cannot reach.
+ */
+#define BITSET_UNREACHABLE ((size_t) -1)
+
+/*
+ * The number of rooms of a classic game world, drawn from the catalog, and the
+ * minimum number of connections of each of them.
+ */
+#define CLASSIC_WORLD_ROOMS 7
+#define CLASSIC_WORLD_MIN_CONNECTIONS 3
+
+/*
+ * A structure that stores a small world as one neighbour bitmask per room.
+ * Rows are 64, 128 or 256 bits wide depending on the number of rooms, so edge
+ * tests, degrees and BFS frontiers are a few word operations. Names are
+ * borrowed from the catalog or the RoomList the world was built from.
+ */
+struct BitsetWorld {
+    size_t num_rooms;
+    size_t num_words;
+    size_t max_connections;
+    uint64_t *adjacency;
+    const char **names;
+    room_t *types;
+};
+
+/*
+ * Returns the row of neighbours of the given room.
+ */
+static inline const uint64_t *bitset_row(const struct BitsetWorld *world,
+        const size_t room) {
+    return world->adjacency + room * world->num_words;
+}
+
+/*
+ * Returns whether rooms a and b are connected.
+ */
+static inline bool bitset_connected(const struct BitsetWorld *world,
+        const size_t a, const size_t b) {
+    return (bitset_row(world, a)[b / 64] >> (b % 64)) & 1;
+}
+
+/*
+ * Returns the number of connections of the given room.
+ */
+static inline size_t bitset_degree(const struct BitsetWorld *world,
+        const size_t room) {
+    const uint64_t *row = bitset_row(world, room);
+    size_t degree = 0;
+    size_t w;
+
+    for (w = 0; w < world->num_words; ++w) {
+        degree += __builtin_popcountll(row[w]);
+    }
+
+    return degree;
+}
+
+struct BitsetWorld *new_bitset_world(const size_t num_rooms);
+
+struct BitsetWorld *new_bitset_world_from(const struct RoomList *world);
+
+void del_bitset_world(struct BitsetWorld *world);
+
+bool bitset_connect(struct BitsetWorld *world, const size_t a, const size_t b);
+
+bool bitset_disconnect(struct BitsetWorld *world, const size_t a,
+        const size_t b);
+
+size_t bitset_distances(const struct BitsetWorld *world, const size_t source,
+        size_t *distances);
+
+void connect_bitset_world(struct BitsetWorld *world,
+        const size_t min_connections, struct Xoshiro256 *rng);
+
+struct BitsetWorld *new_classic_bitset_world(struct Xoshiro256 *rng);
+
+struct RoomList *new_world_from_bitset(const struct BitsetWorld *world);
+
+#endif
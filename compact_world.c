@@ -0,0 +1,276 @@
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compact_world.h"
+#include "room_index.h"
+#include "world.h"
+#include "CuTest.h"
+
+/*
+ * Constructs a CompactWorld from the given world. Fails if the world has more
+ * than UINT32_MAX - 1 rooms, a room with more than ROOM_MAX_CONNECTIONS
+ * connections or a connection to a room outside of it.
+ *
+ * @param world A pointer to a RoomList.
+ * @return A pointer to a new CompactWorld or NULL.
+ */
+struct CompactWorld *new_compact_world(const struct RoomList *world) {
+    if (world->size >= COMPACT_NONE) {
+        return NULL;
+    }
+
+    struct RoomIndex *index = new_room_index(world, 0);
+    struct CompactWorld *compact = (struct CompactWorld*) malloc(
+            sizeof(struct CompactWorld));
+    size_t i;
+    size_t j;
+
+    compact->num_rooms = (uint32_t) index->size;
+    compact->rooms = (struct CompactRoom*) aligned_alloc(64,
+            ((index->size * sizeof(struct CompactRoom) + 63) / 64 + 1) * 64);
+    compact->names_size = 0;
+
+    for (i = 0; i < index->size; ++i) {
+        compact->names_size += strlen(index->rooms[i]->name) + 1;
+    }
+
+    compact->names = (char*) malloc(compact->names_size + 1);
+    compact->names_size = 0;
+
+    for (i = 0; i < index->size; ++i) {
+        const struct Room *room = index->rooms[i];
+        struct CompactRoom *compact_room = &compact->rooms[i];
+        const size_t name_size = strlen(room->name) + 1;
+
+        if (room->num_connections > ROOM_MAX_CONNECTIONS) {
+            del_compact_world(compact);
+            del_room_index(index);
+            return NULL;
+        }
+
+        memset(compact_room, 0, sizeof(struct CompactRoom));
+        compact_room->num_connections = (uint8_t) room->num_connections;
+        compact_room->type = (uint8_t) room->type;
+        compact_room->name_offset = (uint32_t) compact->names_size;
+
+        for (j = 0; j < room->num_connections; ++j) {
+            const size_t neighbor = index->neighbors[index->offsets[i] + j];
+
+            if (neighbor == ROOM_INDEX_NONE) {
+                del_compact_world(compact);
+                del_room_index(index);
+                return NULL;
+            }
+
+            compact_room->connections[j] = (uint32_t) neighbor;
+        }
+
+        memcpy(compact->names + compact->names_size, room->name, name_size);
+        compact->names_size += name_size;
+    }
+
+    del_room_index(index);
+
+    return compact;
+}
+
+/*
+ * Deletes the given CompactWorld.
+ */
+void del_compact_world(struct CompactWorld *world) {
+    free(world->rooms);
+    free(world->names);
+    free(world);
+}
+
+/*
+ * Returns the name of the room with the given id.
+ */
+const char *compact_room_name(const struct CompactWorld *world,
+        const uint32_t id) {
+    return world->names + world->rooms[id].name_offset;
+}
+
+/*
+ * Finds the connection of a given room by name. If the connection cannot be
+ * found COMPACT_NONE is returned.
+ */
+uint32_t compact_find_connection(const struct CompactWorld *world,
+        const uint32_t id, const char *name) {
+    const struct CompactRoom *room = &world->rooms[id];
+    size_t i;
+
+    for (i = 0; i < room->num_connections; ++i) {
+        if (strcmp(name, compact_room_name(world, room->connections[i])) == 0) {
+            return room->connections[i];
+        }
+    }
+
+    return COMPACT_NONE;
+}
+
+/*
+ * Returns the number of bytes the given CompactWorld occupies.
+ */
+size_t compact_world_bytes(const struct CompactWorld *world) {
+    return sizeof(struct CompactWorld)
+        + world->num_rooms * sizeof(struct CompactRoom) + world->names_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void compact_room_should_fit_half_a_cache_line(CuTest *tc) {
+    CuAssertIntEquals(tc, 32, sizeof(struct CompactRoom));
+}
+
+void new_compact_world_should_preserve_rooms_and_connections(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(50, 6);
+
+    // When
+    struct CompactWorld *compact = new_compact_world(world);
+
+    // Then
+    CuAssertPtrNotNull(tc, compact);
+    CuAssertIntEquals(tc, 50, compact->num_rooms);
+
+    uint32_t i;
+    size_t j;
+    struct RoomLink *curr;
+    for (i = 0, curr = world->head; curr != NULL; ++i, curr = curr->next) {
+        const struct CompactRoom *room = &compact->rooms[i];
+
+        CuAssertStrEquals(tc, curr->room->name, compact_room_name(compact, i));
+        CuAssertIntEquals(tc, curr->room->type, room->type);
+        CuAssertIntEquals(tc, curr->room->num_connections, room->num_connections);
+
+        for (j = 0; j < room->num_connections; ++j) {
+            CuAssertStrEquals(tc, curr->room->connections[j]->name,
+                    compact_room_name(compact, room->connections[j]));
+        }
+    }
+
+    // Clean up
+    del_compact_world(compact);
+    del_world(world);
+}
+
+void new_compact_world_when_connection_outside_world_should_return_null(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 4);
+    struct Room *stranger = new_room("stranger", MID_ROOM);
+    add_connection(world->tail->room, stranger);
+
+    // When
+    struct CompactWorld *compact = new_compact_world(world);
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, compact);
+
+    // Clean up
+    del_world(world);
+    del_room(stranger);
+}
+
+void compact_find_connection_should_find_connection_by_name(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 4);
+    struct CompactWorld *compact = new_compact_world(world);
+
+    // When / Then
+    CuAssertIntEquals(tc, 8, compact_find_connection(compact, 0, "Room 8"));
+    CuAssertTrue(tc, compact_find_connection(compact, 0, "Room 5") == COMPACT_NONE);
+
+    // Clean up
+    del_compact_world(compact);
+    del_world(world);
+}
+
+CuSuite *get_compact_world_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, compact_room_should_fit_half_a_cache_line);
+    SUITE_ADD_TEST(suite, new_compact_world_should_preserve_rooms_and_connections);
+    SUITE_ADD_TEST(suite, new_compact_world_when_connection_outside_world_should_return_null);
+    SUITE_ADD_TEST(suite, compact_find_connection_should_find_connection_by_name);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Returns the heap bytes of a block including the 8-byte glibc chunk header.
+ */
+static size_t heap_bytes(void *block) {
+    return malloc_usable_size(block) + 8;
+}
+
+void run_compact_world_benchmark() {
+    const size_t num_rooms = 1000000;
+    const size_t num_steps = 10000000;
+    struct RoomList *world = new_circulant_world(num_rooms, 6);
+    struct CompactWorld *compact = new_compact_world(world);
+    struct RoomIndex *index = new_room_index(world, 0);
+    struct RoomLink *curr;
+    size_t pointer_bytes = sizeof(struct RoomList);
+    uint64_t rng;
+    size_t i;
+
+    for (curr = world->head; curr != NULL; curr = curr->next) {
+        pointer_bytes += heap_bytes(curr) + heap_bytes(curr->room)
+            + heap_bytes(curr->room->name) + heap_bytes(curr->room->connections);
+    }
+
+    printf("compact_world: pointer representation: %.1f bytes per room\n",
+            (double) pointer_bytes / num_rooms);
+    printf("compact_world: compact representation: %.1f bytes per room\n",
+            (double) compact_world_bytes(compact) / num_rooms);
+
+    // Random walks that jump to a random room every few steps so that most
+    // steps miss the cache
+    const struct Room *room = world->head->room;
+    double start = now_seconds();
+
+    for (i = 0, rng = 1; i < num_steps; ++i) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+
+        if (i % 4 == 0) {
+            room = index->rooms[(rng >> 20) % num_rooms];
+        } else {
+            room = room->connections[(rng >> 33) % room->num_connections];
+        }
+    }
+
+    const double pointer_seconds = now_seconds() - start;
+    uint32_t id = 0;
+    start = now_seconds();
+
+    for (i = 0, rng = 1; i < num_steps; ++i) {
+        const struct CompactRoom *compact_room = &compact->rooms[id];
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+
+        if (i % 4 == 0) {
+            id = (uint32_t) ((rng >> 20) % num_rooms);
+        } else {
+            id = compact_room->connections[(rng >> 33)
+                % compact_room->num_connections];
+        }
+    }
+
+    const double compact_seconds = now_seconds() - start;
+
+    printf("compact_world: pointer walk: %.1f ns per step (ended at %s)\n",
+            pointer_seconds / num_steps * 1e9, room->name);
+    printf("compact_world: compact walk: %.1f ns per step (ended at %s)\n",
+            compact_seconds / num_steps * 1e9, compact_room_name(compact, id));
+
+    del_room_index(index);
+    del_compact_world(compact);
+    del_world(world);
+}
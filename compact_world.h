@@ -0,0 +1,50 @@
+#ifndef COMPACT_WORLD_H
+#define COMPACT_WORLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "room.h"
+#include "room_list.h"
+
+/*
+ * The id returned when a compact room has no such connection.
+ */
+#define COMPACT_NONE UINT32_MAX
+
+/*
+ * A structure that stores a room of a CompactWorld in 32 bytes, so that two
+ * rooms share a cache line. Connections are 32-bit ids into the rooms array
+ * and the name is an offset into the world's name pool.
+ */
+struct CompactRoom {
+    uint32_t connections[ROOM_MAX_CONNECTIONS];
+    uint32_t name_offset;
+    uint8_t num_connections;
+    uint8_t type;
+    uint16_t padding;
+};
+
+/*
+ * A structure that stores a world as one array of CompactRooms plus a pool of
+ * NUL-terminated names. Rooms are numbered in RoomList order.
+ */
+struct CompactWorld {
+    uint32_t num_rooms;
+    struct CompactRoom *rooms;
+    size_t names_size;
+    char *names;
+};
+
+struct CompactWorld *new_compact_world(const struct RoomList *world);
+
+void del_compact_world(struct CompactWorld *world);
+
+const char *compact_room_name(const struct CompactWorld *world,
+        const uint32_t id);
+
+uint32_t compact_find_connection(const struct CompactWorld *world,
+        const uint32_t id, const char *name);
+
+size_t compact_world_bytes(const struct CompactWorld *world);
+
+#endif
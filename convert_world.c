@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <string.h>
+#include "world.h"
+#include "world_codec.h"
+
+/*
+ * Converts a world between the text and the compact encodings, reading from
+ * standard input and writing to standard output.
+ */
+int main(int argc, char *argv[]) {
+    if (argc != 2 || (strcmp(argv[1], "text") != 0
+                && strcmp(argv[1], "compact") != 0
+                && strcmp(argv[1], "compact-blocks") != 0)) {
+        fprintf(stderr, "usage: %s text|compact|compact-blocks "
+                "< world > converted\n", argv[0]);
+        return 2;
+    }
+
+    const bool to_text = strcmp(argv[1], "text") == 0;
+    struct RoomList *world = to_text ? read_compact_world(stdin)
+        : read_text_world(stdin);
+
+    if (world == NULL) {
+        fprintf(stderr, "%s: malformed %s world\n", argv[0],
+                to_text ? "compact" : "text");
+        return 1;
+    }
+
+    const bool ok = to_text ? write_text_world(stdout, world)
+        : write_compact_world(stdout, world,
+                strcmp(argv[1], "compact-blocks") == 0);
+
+    del_world(world);
+
+    return ok && fflush(stdout) == 0 ? 0 : 1;
+}
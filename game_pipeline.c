@@ -0,0 +1,622 @@
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "game_pipeline.h"
+#include "spsc_queue.h"
+#include "CuTest.h"
+
+#define PIPELINE_QUEUE_CAPACITY 1024
+#define COMMAND_NAME_SIZE 128
+#define OUTPUT_CHUNK_SIZE 256
+#define IO_BUFFER_SIZE 65536
+
+/*
+ * A parsed line of input. A quit command is sent once the input runs out.
+ */
+struct Command {
+    char name[COMMAND_NAME_SIZE];
+    double parsed_at;
+    bool quit;
+};
+
+/*
+ * A piece of rendered output. The chunk that finishes the response to a
+ * command carries the time that command was parsed at; the last chunk of the
+ * game tells the output thread to stop.
+ */
+struct OutputChunk {
+    char text[OUTPUT_CHUNK_SIZE];
+    size_t length;
+    double parsed_at;
+    bool ends_command;
+    bool last;
+};
+
+/*
+ * The state shared by the three pipeline threads. Apart from the two queues
+ * the only thing they share is the stopped flag, which the world thread sets
+ * when the game ends so the input thread stops reading. The wake pipe is
+ * closed once the world thread is done, so an input thread waiting for a line
+ * that may never come, say from a terminal, wakes up and stops.
+ */
+struct Pipeline {
+    struct Room *current;
+    int input_fd;
+    int output_fd;
+    int wake_fds[2];
+    struct SpscQueue *commands;
+    struct SpscQueue *output;
+    bool stopped;
+    bool found_end;
+    struct PipelineStats *stats;
+};
+
+/*
+ * Renders the screen shown when the player is in the given room, in the same
+ * way snprintf would: at most size bytes are written including the terminator
+ * and the full length of the screen is returned.
+ *
+ * @param room A pointer to the current Room.
+ * @param buffer The buffer to render into.
+ * @param size The size of the buffer.
+ * @return The length of the screen.
+ */
+size_t render_room_screen(const struct Room *room, char *buffer,
+        const size_t size) {
+    size_t length = 0;
+    size_t i;
+
+#define APPEND(...) length += snprintf(buffer + (length < size ? length : size), \
+        length < size ? size - length : 0, __VA_ARGS__)
+
+    APPEND("CURRENT LOCATION: %s\nPOSSIBLE CONNECTIONS:", room->name);
+
+    for (i = 0; i < room->num_connections; ++i) {
+        APPEND("%s %s", i > 0 ? "," : "", room->connections[i]->name);
+    }
+
+    APPEND(".\nWHERE TO? >");
+
+#undef APPEND
+
+    return length;
+}
+
+/*
+ * Pushes an element unless the pipeline stops while the queue is full.
+ */
+static bool push_unless_stopped(struct Pipeline *pipeline,
+        struct SpscQueue *queue, const void *element) {
+    while (!spsc_push(queue, element)) {
+        if (__atomic_load_n(&pipeline->stopped, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+
+        sched_yield();
+    }
+
+    return true;
+}
+
+/*
+ * Waits until there is input to read or the pipeline stops. Returns whether
+ * there is input.
+ */
+static bool wait_for_input(struct Pipeline *pipeline) {
+    struct pollfd fds[2];
+
+    fds[0].fd = pipeline->input_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = pipeline->wake_fds[0];
+    fds[1].events = POLLIN;
+
+    while (poll(fds, 2, -1) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+
+    return fds[1].revents == 0 && fds[0].revents != 0;
+}
+
+/*
+ * Reads the input in large blocks, splits it into lines and queues every line
+ * as a command. Lines too long to be a room name are queued empty so they are
+ * still answered.
+ */
+static void *run_input(void *arg) {
+    struct Pipeline *pipeline = (struct Pipeline*) arg;
+    char *buffer = (char*) malloc(IO_BUFFER_SIZE);
+    struct Command command;
+    size_t length = 0;
+    bool overlong = false;
+    ssize_t n;
+
+    command.quit = false;
+
+    while (wait_for_input(pipeline)
+            && (n = read(pipeline->input_fd, buffer, IO_BUFFER_SIZE)) > 0) {
+        ssize_t i;
+
+        for (i = 0; i < n; ++i) {
+            const char c = buffer[i];
+
+            if (c != '\n') {
+                if (c == '\r') {
+                    continue;
+                } else if (length + 1 < COMMAND_NAME_SIZE) {
+                    command.name[length++] = c;
+                } else {
+                    overlong = true;
+                }
+
+                continue;
+            }
+
+            command.name[overlong ? 0 : length] = '\0';
+            command.parsed_at = now_seconds();
+            length = 0;
+            overlong = false;
+
+            if (!push_unless_stopped(pipeline, pipeline->commands, &command)) {
+                free(buffer);
+                return NULL;
+            }
+        }
+    }
+
+    command.quit = true;
+    push_unless_stopped(pipeline, pipeline->commands, &command);
+    free(buffer);
+
+    return NULL;
+}
+
+/*
+ * Splits rendered text into chunks and queues them for the output thread.
+ */
+static void queue_text(struct Pipeline *pipeline, const char *text,
+        const size_t length, const double parsed_at, const bool last) {
+    struct OutputChunk chunk;
+    size_t done = 0;
+
+    do {
+        chunk.length = length - done < OUTPUT_CHUNK_SIZE ? length - done
+            : OUTPUT_CHUNK_SIZE;
+        memcpy(chunk.text, text + done, chunk.length);
+        done += chunk.length;
+        chunk.ends_command = done == length && parsed_at > 0;
+        chunk.parsed_at = parsed_at;
+        chunk.last = done == length && last;
+        spsc_push_wait(pipeline->output, &chunk);
+    } while (done < length);
+}
+
+/*
+ * Renders the given prefix followed by the current room's screen and queues
+ * them.
+ */
+static void respond(struct Pipeline *pipeline, const char *prefix,
+        const double parsed_at) {
+    char screen[4096];
+    const size_t prefix_length = strlen(prefix);
+    char *text = screen;
+
+    memcpy(text, prefix, prefix_length);
+    size_t length = prefix_length + render_room_screen(pipeline->current,
+            text + prefix_length, sizeof(screen) - prefix_length);
+
+    // Long room names may not fit the stack buffer
+    if (length + 1 > sizeof(screen)) {
+        text = (char*) malloc(length + 1);
+        memcpy(text, prefix, prefix_length);
+        render_room_screen(pipeline->current, text + prefix_length,
+                length + 1 - prefix_length);
+    }
+
+    queue_text(pipeline, text, length, parsed_at, false);
+
+    if (text != screen) {
+        free(text);
+    }
+}
+
+/*
+ * Applies queued commands to the world and queues the resulting screens.
+ */
+static void *run_world(void *arg) {
+    struct Pipeline *pipeline = (struct Pipeline*) arg;
+    struct Command command;
+    char text[256];
+
+    respond(pipeline, "", 0);
+
+    while (true) {
+        spsc_pop_wait(pipeline->commands, &command);
+
+        if (command.quit) {
+            queue_text(pipeline, "\n", 1, 0, true);
+            break;
+        }
+
+        struct Room *next = find_connection(pipeline->current, command.name);
+        pipeline->stats->commands++;
+
+        if (next == NULL) {
+            respond(pipeline, "\nHUH? I DON'T UNDERSTAND THAT ROOM. TRY AGAIN.\n\n",
+                    command.parsed_at);
+            continue;
+        }
+
+        pipeline->current = next;
+        pipeline->stats->moves++;
+
+        if (next->type == END_ROOM) {
+            const size_t length = snprintf(text, sizeof(text),
+                    "\nYOU HAVE FOUND THE END ROOM. CONGRATULATIONS!\n"
+                    "YOU TOOK %zu STEPS.\n", pipeline->stats->moves);
+            pipeline->found_end = true;
+            __atomic_store_n(&pipeline->stopped, true, __ATOMIC_RELEASE);
+            queue_text(pipeline, text, length, command.parsed_at, true);
+            break;
+        }
+
+        respond(pipeline, "\n\n", command.parsed_at);
+    }
+
+    __atomic_store_n(&pipeline->stopped, true, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+/*
+ * Writes everything buffered so far and records the latency of the commands
+ * whose responses were in it.
+ */
+static void flush_output(struct Pipeline *pipeline, const char *buffer,
+        size_t *length, size_t *pending, double *pending_sum,
+        double *oldest) {
+    struct PipelineStats *stats = pipeline->stats;
+    size_t done = 0;
+
+    while (done < *length) {
+        const ssize_t n = write(pipeline->output_fd, buffer + done,
+                *length - done);
+
+        if (n <= 0) {
+            break;
+        }
+
+        done += (size_t) n;
+    }
+
+    if (*length > 0) {
+        stats->writes++;
+        stats->bytes_written += done;
+    }
+
+    if (*pending > 0) {
+        const double now = now_seconds();
+        const double latency_us = (now - *oldest) * 1e6;
+
+        stats->mean_latency_us += (*pending * now - *pending_sum) * 1e6;
+
+        if (latency_us > stats->max_latency_us) {
+            stats->max_latency_us = latency_us;
+        }
+    }
+
+    *length = 0;
+    *pending = 0;
+    *pending_sum = 0;
+}
+
+/*
+ * Collects queued output into a large buffer and writes it out whenever it
+ * fills up or no more output is immediately available.
+ */
+static void *run_output(void *arg) {
+    struct Pipeline *pipeline = (struct Pipeline*) arg;
+    char *buffer = (char*) malloc(IO_BUFFER_SIZE);
+    struct OutputChunk chunk;
+    size_t length = 0;
+    size_t pending = 0;
+    double pending_sum = 0;
+    double oldest = 0;
+
+    while (true) {
+        if (!spsc_pop(pipeline->output, &chunk)) {
+            flush_output(pipeline, buffer, &length, &pending, &pending_sum,
+                    &oldest);
+            spsc_pop_wait(pipeline->output, &chunk);
+        }
+
+        if (length + chunk.length > IO_BUFFER_SIZE) {
+            flush_output(pipeline, buffer, &length, &pending, &pending_sum,
+                    &oldest);
+        }
+
+        memcpy(buffer + length, chunk.text, chunk.length);
+        length += chunk.length;
+
+        if (chunk.ends_command) {
+            if (pending == 0) {
+                oldest = chunk.parsed_at;
+            }
+
+            pending++;
+            pending_sum += chunk.parsed_at;
+        }
+
+        if (chunk.last) {
+            break;
+        }
+    }
+
+    flush_output(pipeline, buffer, &length, &pending, &pending_sum, &oldest);
+    free(buffer);
+
+    return NULL;
+}
+
+/*
+ * Plays the game from the given room with three threads: one reading and
+ * parsing commands from input_fd, one applying them to the world and rendering
+ * the next screen, and one writing the screens to output_fd in large writes.
+ * The threads hand work to each other through lock-free single-producer
+ * single-consumer queues so that slow input or output never stalls the world.
+ * The game ends when the END_ROOM is reached or the input runs out.
+ *
+ * @param start A pointer to the Room the player starts in.
+ * @param input_fd The file descriptor to read commands from.
+ * @param output_fd The file descriptor to write screens to.
+ * @param stats A pointer to the PipelineStats to fill in.
+ * @return Whether the player reached the END_ROOM.
+ */
+bool run_game_pipeline(struct Room *start, const int input_fd,
+        const int output_fd, struct PipelineStats *stats) {
+    struct Pipeline pipeline;
+    pthread_t input_thread;
+    pthread_t world_thread;
+
+    memset(stats, 0, sizeof(struct PipelineStats));
+
+    pipeline.current = start;
+    pipeline.input_fd = input_fd;
+    pipeline.output_fd = output_fd;
+    pipeline.commands = new_spsc_queue(PIPELINE_QUEUE_CAPACITY,
+            sizeof(struct Command));
+    pipeline.output = new_spsc_queue(PIPELINE_QUEUE_CAPACITY,
+            sizeof(struct OutputChunk));
+    pipeline.stopped = false;
+    pipeline.found_end = false;
+    pipeline.stats = stats;
+
+    if (pipe(pipeline.wake_fds) != 0) {
+        abort();
+    }
+
+    const double started_at = now_seconds();
+
+    pthread_create(&input_thread, NULL, run_input, &pipeline);
+    pthread_create(&world_thread, NULL, run_world, &pipeline);
+    run_output(&pipeline);
+    pthread_join(world_thread, NULL);
+    close(pipeline.wake_fds[1]);
+    pthread_join(input_thread, NULL);
+
+    stats->seconds = now_seconds() - started_at;
+    stats->commands_per_second = stats->seconds > 0
+        ? stats->commands / stats->seconds : 0.0;
+
+    if (stats->commands > 0) {
+        stats->mean_latency_us /= stats->commands;
+    }
+
+    del_spsc_queue(pipeline.commands);
+    del_spsc_queue(pipeline.output);
+    close(pipeline.wake_fds[0]);
+
+    return pipeline.found_end;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Runs the pipeline on the given script and returns everything it wrote.
+ */
+static char *play_script(struct Room *start, const char *script,
+        bool *found_end, struct PipelineStats *stats) {
+    FILE *input = tmpfile();
+    FILE *output = tmpfile();
+    char *text = (char*) calloc(65536, 1);
+
+    fputs(script, input);
+    fflush(input);
+    rewind(input);
+
+    *found_end = run_game_pipeline(start, fileno(input), fileno(output), stats);
+
+    rewind(output);
+    fread(text, 1, 65535, output);
+    fclose(input);
+    fclose(output);
+
+    return text;
+}
+
+void render_room_screen_should_list_connections(CuTest *tc) {
+    // Given
+    struct Room *room1 = new_room("Eastern Palace", START_ROOM);
+    struct Room *room2 = new_room("House of Gales", MID_ROOM);
+    struct Room *room3 = new_room("Tower of Hera", END_ROOM);
+    char screen[256];
+    add_connection(room1, room2);
+    add_connection(room1, room3);
+
+    // When
+    const size_t length = render_room_screen(room1, screen, sizeof(screen));
+
+    // Then
+    CuAssertStrEquals(tc, "CURRENT LOCATION: Eastern Palace\n"
+            "POSSIBLE CONNECTIONS: House of Gales, Tower of Hera.\n"
+            "WHERE TO? >", screen);
+    CuAssertIntEquals(tc, strlen(screen), length);
+    CuAssertIntEquals(tc, length, render_room_screen(room1, screen, 10));
+    CuAssertStrEquals(tc, "CURRENT L", screen);
+
+    // Clean up
+    del_room(room1);
+    del_room(room2);
+    del_room(room3);
+}
+
+void run_game_pipeline_should_play_until_end_room(CuTest *tc) {
+    // Given
+    struct Room *room1 = new_room("Eastern Palace", START_ROOM);
+    struct Room *room2 = new_room("House of Gales", MID_ROOM);
+    struct Room *room3 = new_room("Tower of Hera", END_ROOM);
+    struct PipelineStats stats;
+    bool found_end;
+    add_connection(room1, room2);
+    add_connection(room2, room3);
+
+    // When
+    char *output = play_script(room1, "Tower of Hera\nHouse of Gales\n"
+            "Tower of Hera\nEastern Palace\n", &found_end, &stats);
+
+    // Then
+    CuAssertIntEquals(tc, true, found_end);
+    CuAssertIntEquals(tc, 3, stats.commands);
+    CuAssertIntEquals(tc, 2, stats.moves);
+    CuAssertStrEquals(tc, "CURRENT LOCATION: Eastern Palace\n"
+            "POSSIBLE CONNECTIONS: House of Gales.\n"
+            "WHERE TO? >\n"
+            "HUH? I DON'T UNDERSTAND THAT ROOM. TRY AGAIN.\n\n"
+            "CURRENT LOCATION: Eastern Palace\n"
+            "POSSIBLE CONNECTIONS: House of Gales.\n"
+            "WHERE TO? >\n\n"
+            "CURRENT LOCATION: House of Gales\n"
+            "POSSIBLE CONNECTIONS: Eastern Palace, Tower of Hera.\n"
+            "WHERE TO? >\n"
+            "YOU HAVE FOUND THE END ROOM. CONGRATULATIONS!\n"
+            "YOU TOOK 2 STEPS.\n", output);
+    CuAssertTrue(tc, stats.bytes_written == strlen(output));
+
+    // Clean up
+    free(output);
+    del_room(room1);
+    del_room(room2);
+    del_room(room3);
+}
+
+void run_game_pipeline_when_input_runs_out_should_stop(CuTest *tc) {
+    // Given
+    struct Room *room1 = new_room("Eastern Palace", START_ROOM);
+    struct Room *room2 = new_room("House of Gales", END_ROOM);
+    struct PipelineStats stats;
+    bool found_end;
+    add_connection(room1, room2);
+
+    // When
+    char *output = play_script(room1, "Ice Palace\r\n", &found_end, &stats);
+
+    // Then
+    CuAssertIntEquals(tc, false, found_end);
+    CuAssertIntEquals(tc, 1, stats.commands);
+    CuAssertIntEquals(tc, 0, stats.moves);
+    CuAssertTrue(tc, strstr(output, "HUH?") != NULL);
+
+    // Clean up
+    free(output);
+    del_room(room1);
+    del_room(room2);
+}
+
+void run_game_pipeline_when_input_stays_open_should_stop_at_end_room(
+        CuTest *tc) {
+    // Given input from a pipe whose writer stays open after the last command
+    struct Room *room1 = new_room("Eastern Palace", START_ROOM);
+    struct Room *room2 = new_room("House of Gales", END_ROOM);
+    const char script[] = "House of Gales\n";
+    FILE *output = tmpfile();
+    struct PipelineStats stats;
+    int fds[2];
+    add_connection(room1, room2);
+    CuAssertIntEquals(tc, 0, pipe(fds));
+    CuAssertIntEquals(tc, sizeof(script) - 1, write(fds[1], script,
+                sizeof(script) - 1));
+
+    // When
+    const bool found_end = run_game_pipeline(room1, fds[0], fileno(output),
+            &stats);
+
+    // Then
+    CuAssertIntEquals(tc, true, found_end);
+    CuAssertIntEquals(tc, 1, stats.moves);
+
+    // Clean up
+    close(fds[0]);
+    close(fds[1]);
+    fclose(output);
+    del_room(room1);
+    del_room(room2);
+}
+
+CuSuite *get_game_pipeline_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, render_room_screen_should_list_connections);
+    SUITE_ADD_TEST(suite, run_game_pipeline_should_play_until_end_room);
+    SUITE_ADD_TEST(suite, run_game_pipeline_when_input_runs_out_should_stop);
+    SUITE_ADD_TEST(suite, run_game_pipeline_when_input_stays_open_should_stop_at_end_room);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+void run_game_pipeline_benchmark() {
+    const size_t num_commands = 1000000;
+    struct Room *room1 = new_room("Eastern Palace", START_ROOM);
+    struct Room *room2 = new_room("House of Gales", MID_ROOM);
+    struct Room *room3 = new_room("Tower of Hera", END_ROOM);
+    struct PipelineStats stats;
+    FILE *input = tmpfile();
+    FILE *output = fopen("/dev/null", "w");
+    size_t i;
+
+    add_connection(room1, room2);
+    add_connection(room1, room3);
+
+    // A flood of moves back and forth that never reaches the END_ROOM
+    for (i = 0; i < num_commands; ++i) {
+        fputs(i % 2 == 0 ? "House of Gales\n" : "Eastern Palace\n", input);
+    }
+
+    fflush(input);
+    rewind(input);
+
+    run_game_pipeline(room1, fileno(input), fileno(output), &stats);
+
+    printf("game_pipeline: %zu commands in %.3f s: %.0f commands/s\n",
+            stats.commands, stats.seconds, stats.commands_per_second);
+    printf("game_pipeline: latency mean %.1f us, max %.1f us; %zu bytes in "
+            "%zu writes\n", stats.mean_latency_us, stats.max_latency_us,
+            stats.bytes_written, stats.writes);
+
+    fclose(input);
+    fclose(output);
+    del_room(room1);
+    del_room(room2);
+    del_room(room3);
+}
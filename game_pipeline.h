@@ -0,0 +1,29 @@
+#ifndef GAME_PIPELINE_H
+#define GAME_PIPELINE_H
+
+#include <stddef.h>
+#include "room.h"
+
+/*
+ * A structure that stores what happened during a run of the game pipeline.
+ * Command latency is measured from the moment a command is parsed until the
+ * screen it produced has been written out.
+ */
+struct PipelineStats {
+    size_t commands;
+    size_t moves;
+    double seconds;
+    double commands_per_second;
+    double mean_latency_us;
+    double max_latency_us;
+    size_t bytes_written;
+    size_t writes;
+};
+
+size_t render_room_screen(const struct Room *room, char *buffer,
+        const size_t size);
+
+bool run_game_pipeline(struct Room *start, const int input_fd,
+        const int output_fd, struct PipelineStats *stats);
+
+#endif
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "room_catalog.h"
+
+/*
+ * Generates the minimal perfect hash tables of the room catalog. Reads one
+ * name per line from the file given as the only argument and writes a C
+ * source file defining the tables declared in room_catalog.h to stdout.
+ *
+ * Names are first grouped into buckets by their hash. Buckets are then placed
+ * largest first: for a bucket with several names the smallest displacement
+ * that sends all of them to distinct free slots is recorded, and a bucket with
+ * a single name takes the next free slot directly.
+ */
+
+#define MAX_NAMES 4096
+#define MAX_NAME_LENGTH 256
+
+static char *names[MAX_NAMES];
+static size_t bucket_of[MAX_NAMES];
+static size_t bucket_sizes[MAX_NAMES];
+static size_t order[MAX_NAMES];
+static uint64_t hashes[MAX_NAMES];
+static int32_t displacements[MAX_NAMES];
+static const char *slots[MAX_NAMES];
+static size_t num_names = 0;
+
+static int compare_buckets(const void *a, const void *b) {
+    const size_t bucket1 = *(const size_t*) a;
+    const size_t bucket2 = *(const size_t*) b;
+
+    if (bucket_sizes[bucket1] != bucket_sizes[bucket2]) {
+        return bucket_sizes[bucket1] > bucket_sizes[bucket2] ? -1 : 1;
+    }
+
+    return bucket1 < bucket2 ? -1 : (bucket1 > bucket2);
+}
+
+/*
+ * Tries to place every name of the bucket with the given displacement.
+ */
+static int place_bucket(const size_t bucket, const uint32_t d) {
+    size_t placed[MAX_NAMES];
+    size_t num_placed = 0;
+    size_t i;
+
+    for (i = 0; i < num_names; ++i) {
+        if (bucket_of[i] != bucket) {
+            continue;
+        }
+
+        const size_t slot = catalog_slot(hashes[i], d, num_names);
+        size_t j;
+
+        for (j = 0; j < num_placed && placed[j] != slot; ++j) {
+        }
+
+        if (slots[slot] != NULL || j < num_placed) {
+            return 0;
+        }
+
+        placed[num_placed++] = slot;
+    }
+
+    for (i = 0, num_placed = 0; i < num_names; ++i) {
+        if (bucket_of[i] == bucket) {
+            slots[placed[num_placed++]] = names[i];
+        }
+    }
+
+    return 1;
+}
+
+static void print_c_string(const char *str) {
+    putchar('"');
+
+    for (; *str != '\0'; ++str) {
+        if (*str == '"' || *str == '\\') {
+            putchar('\\');
+        }
+
+        putchar(*str);
+    }
+
+    putchar('"');
+}
+
+int main(int argc, char *argv[]) {
+    char line[MAX_NAME_LENGTH];
+    size_t i;
+    size_t j;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s CATALOG\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "r");
+
+    if (file == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (line[0] == '\0') {
+            continue;
+        }
+
+        for (i = 0; i < num_names; ++i) {
+            if (strcmp(names[i], line) == 0) {
+                fprintf(stderr, "%s: duplicate name: %s\n", argv[1], line);
+                return 1;
+            }
+        }
+
+        if (num_names == MAX_NAMES) {
+            fprintf(stderr, "%s: more than %d names\n", argv[1], MAX_NAMES);
+            return 1;
+        }
+
+        names[num_names++] = strdup(line);
+    }
+
+    fclose(file);
+
+    if (num_names == 0) {
+        fprintf(stderr, "%s: no names\n", argv[1]);
+        return 1;
+    }
+
+    for (i = 0; i < num_names; ++i) {
+        hashes[i] = catalog_hash(names[i]);
+        bucket_of[i] = catalog_bucket(hashes[i], num_names);
+        bucket_sizes[bucket_of[i]]++;
+        order[i] = i;
+    }
+
+    qsort(order, num_names, sizeof(size_t), compare_buckets);
+
+    for (i = 0, j = 0; i < num_names && bucket_sizes[order[i]] > 0; ++i) {
+        const size_t bucket = order[i];
+
+        if (bucket_sizes[bucket] == 1) {
+            // Single names go straight into the next free slot
+            size_t k = 0;
+
+            while (slots[j] != NULL) {
+                j++;
+            }
+
+            while (bucket_of[k] != bucket) {
+                k++;
+            }
+
+            slots[j] = names[k];
+            displacements[bucket] = -(int32_t) j - 1;
+            continue;
+        }
+
+        uint32_t d = 0;
+
+        while (!place_bucket(bucket, d)) {
+            d++;
+        }
+
+        displacements[bucket] = (int32_t) d;
+    }
+
+    printf("/* Generated by gen_room_catalog from %s. Do not edit. */\n\n",
+            argv[1]);
+    printf("#include \"room_catalog.h\"\n\n");
+    printf("const size_t ROOM_CATALOG_SIZE = %zu;\n\n", num_names);
+    printf("const char *const ROOM_CATALOG_NAMES[] = {\n");
+
+    for (i = 0; i < num_names; ++i) {
+        printf("    ");
+        print_c_string(slots[i]);
+        printf(",\n");
+    }
+
+    printf("};\n\n");
+    printf("const int32_t ROOM_CATALOG_DISPLACEMENTS[] = {\n");
+
+    for (i = 0; i < num_names; ++i) {
+        printf("    %d,\n", displacements[i]);
+    }
+
+    printf("};\n");
+
+    return 0;
+}
@@ -0,0 +1,637 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lazy_world.h"
+#include "CuTest.h"
+
+/*
+ * Marks the end of the LRU list.
+ */
+#define LAZY_NIL UINT32_MAX
+
+/*
+ * The axial offsets of the six neighbours of a hex. The east/west and
+ * north/south connections are always present, which keeps the world
+ * connected; the two diagonal ones are present or not depending on the seed.
+ */
+static const int32_t DIRECTIONS[LAZY_ROOM_MAX_CONNECTIONS][2] = {
+    { 1, 0 }, { 1, -1 }, { 0, -1 }, { -1, 0 }, { -1, 1 }, { 0, 1 }
+};
+
+/*
+ * A cached room and its links in the LRU list.
+ */
+struct LazyCacheEntry {
+    struct LazyRoom room;
+    uint32_t prev;
+    uint32_t next;
+};
+
+/*
+ * A structure that stores the seed of a lazy world and the bounded cache of
+ * its materialized rooms. The table maps room ids to entry index + 1 with
+ * linear probing; 0 marks an empty slot.
+ */
+struct LazyWorld {
+    uint64_t seed;
+    uint64_t end_id;
+    size_t capacity;
+    size_t size;
+    struct LazyCacheEntry *entries;
+    uint32_t head;
+    uint32_t tail;
+    size_t table_capacity;
+    uint32_t *table;
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+};
+
+/*
+ * The splitmix64 finalizer, used both to hash room ids and to derive
+ * pseudo-random bits from the seed.
+ */
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static int32_t id_q(const uint64_t id) {
+    return (int32_t) (uint32_t) (id >> 32);
+}
+
+static int32_t id_r(const uint64_t id) {
+    return (int32_t) (uint32_t) id;
+}
+
+/*
+ * Packs axial coordinates into a room id.
+ */
+uint64_t lazy_room_id(const int32_t q, const int32_t r) {
+    return ((uint64_t) (uint32_t) q << 32) | (uint32_t) r;
+}
+
+/*
+ * Returns the id of the room at offset d from the given room.
+ */
+static uint64_t step(const uint64_t id, const int32_t *d) {
+    return lazy_room_id((int32_t) ((uint32_t) id_q(id) + (uint32_t) d[0]),
+            (int32_t) ((uint32_t) id_r(id) + (uint32_t) d[1]));
+}
+
+/*
+ * Returns whether the diagonal connection between key and key + (1, -1)
+ * exists. Keying the decision on one endpoint makes it symmetric.
+ */
+static bool has_diagonal(const struct LazyWorld *world, const uint64_t key) {
+    return (mix(world->seed ^ mix(key)) & 1) != 0;
+}
+
+/*
+ * Formats the name of the room with the given id.
+ */
+static void format_name(const uint64_t id, char *name) {
+    snprintf(name, LAZY_ROOM_NAME_SIZE, "Room %d,%d", id_q(id), id_r(id));
+}
+
+/*
+ * Constructor. The END_ROOM is placed on one of the six corners of the ring
+ * of hexes end_distance steps away from the START_ROOM at (0, 0), picked by
+ * the seed. At most cache_capacity rooms are kept materialized at a time.
+ *
+ * @param seed The seed every room is derived from.
+ * @param end_distance The distance between the START_ROOM and END_ROOM.
+ * @param cache_capacity The maximum number of cached rooms.
+ * @return A pointer to a new LazyWorld.
+ */
+struct LazyWorld *new_lazy_world(const uint64_t seed,
+        const uint32_t end_distance, const size_t cache_capacity) {
+    struct LazyWorld *world = (struct LazyWorld*) malloc(
+            sizeof(struct LazyWorld));
+    const int32_t *corner = DIRECTIONS[mix(seed) % LAZY_ROOM_MAX_CONNECTIONS];
+    const int32_t distance = end_distance > 0 ? (int32_t) end_distance : 1;
+
+    world->seed = seed;
+    world->end_id = lazy_room_id(corner[0] * distance, corner[1] * distance);
+    world->capacity = cache_capacity > 0 ? cache_capacity : 1;
+    world->size = 0;
+    world->entries = (struct LazyCacheEntry*) malloc(world->capacity *
+            sizeof(struct LazyCacheEntry));
+    world->head = LAZY_NIL;
+    world->tail = LAZY_NIL;
+
+    world->table_capacity = 16;
+    while (world->table_capacity < 2 * world->capacity) {
+        world->table_capacity *= 2;
+    }
+
+    world->table = (uint32_t*) calloc(world->table_capacity, sizeof(uint32_t));
+    world->hits = 0;
+    world->misses = 0;
+    world->evictions = 0;
+
+    return world;
+}
+
+/*
+ * Deletes the given LazyWorld.
+ */
+void del_lazy_world(struct LazyWorld *world) {
+    free(world->entries);
+    free(world->table);
+    free(world);
+}
+
+/*
+ * Returns the id of the START_ROOM.
+ */
+uint64_t lazy_world_start(const struct LazyWorld *world) {
+    return lazy_room_id(0, 0);
+}
+
+/*
+ * Returns the id of the END_ROOM.
+ */
+uint64_t lazy_world_end(const struct LazyWorld *world) {
+    return world->end_id;
+}
+
+/*
+ * Derives the room with the given id from the world's seed. The result only
+ * depends on the seed, the end distance and the id, so a room that is evicted
+ * and materialized again comes back identical.
+ *
+ * @param world A pointer to a LazyWorld.
+ * @param id The id of the room.
+ * @param room A pointer to the LazyRoom to fill in.
+ */
+void materialize_lazy_room(const struct LazyWorld *world, const uint64_t id,
+        struct LazyRoom *room) {
+    size_t i;
+
+    room->id = id;
+    format_name(id, room->name);
+
+    if (id == lazy_world_start(world)) {
+        room->type = START_ROOM;
+    } else if (id == world->end_id) {
+        room->type = END_ROOM;
+    } else {
+        room->type = MID_ROOM;
+    }
+
+    room->num_connections = 0;
+
+    for (i = 0; i < LAZY_ROOM_MAX_CONNECTIONS; ++i) {
+        const uint64_t neighbor = step(id, DIRECTIONS[i]);
+
+        if (i == 1 && !has_diagonal(world, id)) {
+            continue;
+        } else if (i == 4 && !has_diagonal(world, neighbor)) {
+            continue;
+        }
+
+        room->connections[room->num_connections++] = neighbor;
+    }
+}
+
+static size_t table_slot(const struct LazyWorld *world, const uint64_t id) {
+    return mix(id) & (world->table_capacity - 1);
+}
+
+/*
+ * Returns the slot holding the given id, or the empty slot it would go in.
+ */
+static size_t table_find(const struct LazyWorld *world, const uint64_t id) {
+    const size_t mask = world->table_capacity - 1;
+    size_t slot = table_slot(world, id);
+
+    while (world->table[slot] != 0
+            && world->entries[world->table[slot] - 1].room.id != id) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+/*
+ * Removes the given id from the table, shifting later entries of its probe
+ * sequence back so that no tombstones are needed.
+ */
+static void table_remove(struct LazyWorld *world, const uint64_t id) {
+    const size_t mask = world->table_capacity - 1;
+    size_t hole = table_find(world, id);
+    size_t slot = hole;
+
+    while (true) {
+        slot = (slot + 1) & mask;
+
+        if (world->table[slot] == 0) {
+            break;
+        }
+
+        const size_t home = table_slot(world,
+                world->entries[world->table[slot] - 1].room.id);
+
+        // Leave the entry alone if its home lies cyclically in (hole, slot]
+        if (hole <= slot ? (hole < home && home <= slot)
+                : (hole < home || home <= slot)) {
+            continue;
+        }
+
+        world->table[hole] = world->table[slot];
+        hole = slot;
+    }
+
+    world->table[hole] = 0;
+}
+
+static void unlink_entry(struct LazyWorld *world, const uint32_t e) {
+    struct LazyCacheEntry *entry = &world->entries[e];
+
+    if (entry->prev != LAZY_NIL) {
+        world->entries[entry->prev].next = entry->next;
+    } else {
+        world->head = entry->next;
+    }
+
+    if (entry->next != LAZY_NIL) {
+        world->entries[entry->next].prev = entry->prev;
+    } else {
+        world->tail = entry->prev;
+    }
+}
+
+static void push_front(struct LazyWorld *world, const uint32_t e) {
+    struct LazyCacheEntry *entry = &world->entries[e];
+
+    entry->prev = LAZY_NIL;
+    entry->next = world->head;
+
+    if (world->head != LAZY_NIL) {
+        world->entries[world->head].prev = e;
+    } else {
+        world->tail = e;
+    }
+
+    world->head = e;
+}
+
+/*
+ * Returns the room with the given id, materializing it if it is not cached.
+ * When the cache is full the least recently used room is evicted. The
+ * returned pointer is only valid until the next call to lazy_world_get.
+ *
+ * @param world A pointer to a LazyWorld.
+ * @param id The id of the room.
+ * @return A pointer to the cached LazyRoom.
+ */
+const struct LazyRoom *lazy_world_get(struct LazyWorld *world,
+        const uint64_t id) {
+    const size_t slot = table_find(world, id);
+    uint32_t e;
+
+    if (world->table[slot] != 0) {
+        world->hits++;
+        e = world->table[slot] - 1;
+
+        if (e != world->head) {
+            unlink_entry(world, e);
+            push_front(world, e);
+        }
+
+        return &world->entries[e].room;
+    }
+
+    world->misses++;
+
+    if (world->size < world->capacity) {
+        e = (uint32_t) world->size++;
+    } else {
+        e = world->tail;
+        world->evictions++;
+        table_remove(world, world->entries[e].room.id);
+        unlink_entry(world, e);
+    }
+
+    materialize_lazy_room(world, id, &world->entries[e].room);
+    world->table[table_find(world, id)] = e + 1;
+    push_front(world, e);
+
+    return &world->entries[e].room;
+}
+
+/*
+ * Parses a coordinate written the way format_name writes it: an optional minus
+ * sign followed by digits without leading zeros. Returns a pointer past the
+ * coordinate or NULL if there is none.
+ */
+static const char *parse_coordinate(const char *str, int32_t *value) {
+    const bool negative = *str == '-';
+    int64_t magnitude = 0;
+    const char *digits = negative ? str + 1 : str;
+    const char *curr = digits;
+
+    while (*curr >= '0' && *curr <= '9' && curr - digits < 10) {
+        magnitude = magnitude * 10 + (*curr - '0');
+        curr++;
+    }
+
+    if (curr == digits || (*digits == '0' && (curr - digits > 1 || negative))
+            || magnitude > (negative ? 2147483648LL : 2147483647LL)) {
+        return NULL;
+    }
+
+    *value = (int32_t) (negative ? -magnitude : magnitude);
+
+    return curr;
+}
+
+/*
+ * Follows the connection of the room from with the given name. Neighbour names
+ * are a function of their ids so the name is parsed rather than compared
+ * against every neighbour, and only the destination gets materialized.
+ *
+ * @param world A pointer to a LazyWorld.
+ * @param from The id of the current room.
+ * @param name The name of the room to move to.
+ * @param to Set to the id of the new room if the move succeeds.
+ * @return Whether from is connected to a room with the given name.
+ */
+bool lazy_world_move(struct LazyWorld *world, const uint64_t from,
+        const char *name, uint64_t *to) {
+    const char *curr = name;
+    int32_t q;
+    int32_t r;
+    size_t i;
+
+    if (strncmp(curr, "Room ", 5) != 0
+            || (curr = parse_coordinate(curr + 5, &q)) == NULL
+            || *curr != ','
+            || (curr = parse_coordinate(curr + 1, &r)) == NULL
+            || *curr != '\0') {
+        return false;
+    }
+
+    const uint64_t id = lazy_room_id(q, r);
+    const struct LazyRoom *room = lazy_world_get(world, from);
+
+    for (i = 0; i < room->num_connections; ++i) {
+        if (room->connections[i] == id) {
+            lazy_world_get(world, id);
+            *to = id;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Fills in the cache counters of the given LazyWorld.
+ */
+void lazy_world_stats(const struct LazyWorld *world,
+        struct LazyWorldStats *stats) {
+    stats->hits = world->hits;
+    stats->misses = world->misses;
+    stats->evictions = world->evictions;
+    stats->resident_rooms = world->size;
+    stats->resident_bytes = sizeof(struct LazyWorld)
+        + world->capacity * sizeof(struct LazyCacheEntry)
+        + world->table_capacity * sizeof(uint32_t);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void materialize_lazy_room_should_be_deterministic(CuTest *tc) {
+    // Given
+    struct LazyWorld *world1 = new_lazy_world(42, 10, 4);
+    struct LazyWorld *world2 = new_lazy_world(42, 10, 4);
+    struct LazyRoom room1;
+    struct LazyRoom room2;
+
+    // When
+    materialize_lazy_room(world1, lazy_room_id(-7, 3), &room1);
+    materialize_lazy_room(world2, lazy_room_id(-7, 3), &room2);
+
+    // Then
+    CuAssertStrEquals(tc, "Room -7,3", room1.name);
+    CuAssertStrEquals(tc, room1.name, room2.name);
+    CuAssertIntEquals(tc, MID_ROOM, room1.type);
+    CuAssertIntEquals(tc, room1.num_connections, room2.num_connections);
+    CuAssertTrue(tc, memcmp(room1.connections, room2.connections,
+                room1.num_connections * sizeof(uint64_t)) == 0);
+
+    // Clean up
+    del_lazy_world(world1);
+    del_lazy_world(world2);
+}
+
+void materialize_lazy_room_should_have_symmetric_connections(CuTest *tc) {
+    // Given
+    struct LazyWorld *world = new_lazy_world(7, 10, 4);
+    struct LazyRoom room;
+    struct LazyRoom neighbor;
+    int32_t q;
+    int32_t r;
+    size_t i;
+    size_t j;
+
+    for (q = -5; q <= 5; ++q) {
+        for (r = -5; r <= 5; ++r) {
+            // When
+            materialize_lazy_room(world, lazy_room_id(q, r), &room);
+
+            // Then
+            CuAssertTrue(tc, room.num_connections >= 4);
+
+            for (i = 0; i < room.num_connections; ++i) {
+                materialize_lazy_room(world, room.connections[i], &neighbor);
+
+                for (j = 0; j < neighbor.num_connections
+                        && neighbor.connections[j] != room.id; ++j) {
+                }
+
+                CuAssertTrue(tc, j < neighbor.num_connections);
+            }
+        }
+    }
+
+    // Clean up
+    del_lazy_world(world);
+}
+
+void new_lazy_world_should_place_start_and_end_rooms(CuTest *tc) {
+    // Given
+    struct LazyWorld *world = new_lazy_world(3, 5, 4);
+
+    // When
+    const struct LazyRoom *start = lazy_world_get(world, lazy_world_start(world));
+    const room_t start_type = start->type;
+    const struct LazyRoom *end = lazy_world_get(world, lazy_world_end(world));
+
+    // Then
+    CuAssertIntEquals(tc, START_ROOM, start_type);
+    CuAssertIntEquals(tc, END_ROOM, end->type);
+    CuAssertTrue(tc, lazy_world_start(world) != lazy_world_end(world));
+
+    // Clean up
+    del_lazy_world(world);
+}
+
+void lazy_world_get_when_cache_full_should_evict_and_regenerate(CuTest *tc) {
+    // Given
+    struct LazyWorld *world = new_lazy_world(9, 10, 2);
+    struct LazyRoom first;
+    struct LazyWorldStats stats;
+    int32_t q;
+
+    first = *lazy_world_get(world, lazy_room_id(0, 0));
+
+    // When
+    for (q = 1; q <= 100; ++q) {
+        lazy_world_get(world, lazy_room_id(q, 0));
+    }
+
+    const struct LazyRoom *again = lazy_world_get(world, lazy_room_id(0, 0));
+
+    // Then
+    lazy_world_stats(world, &stats);
+    CuAssertIntEquals(tc, 2, stats.resident_rooms);
+    CuAssertIntEquals(tc, 102, stats.misses);
+    CuAssertIntEquals(tc, 100, stats.evictions);
+    CuAssertStrEquals(tc, first.name, again->name);
+    CuAssertIntEquals(tc, first.num_connections, again->num_connections);
+
+    // Clean up
+    del_lazy_world(world);
+}
+
+void lazy_world_get_when_cached_should_count_hit(CuTest *tc) {
+    // Given
+    struct LazyWorld *world = new_lazy_world(9, 10, 4);
+    struct LazyWorldStats stats;
+
+    lazy_world_get(world, lazy_room_id(1, 1));
+    lazy_world_get(world, lazy_room_id(2, 2));
+
+    // When
+    const struct LazyRoom *room = lazy_world_get(world, lazy_room_id(1, 1));
+
+    // Then
+    lazy_world_stats(world, &stats);
+    CuAssertStrEquals(tc, "Room 1,1", room->name);
+    CuAssertIntEquals(tc, 1, stats.hits);
+    CuAssertIntEquals(tc, 2, stats.misses);
+
+    // Clean up
+    del_lazy_world(world);
+}
+
+void lazy_world_move_when_connected_should_move(CuTest *tc) {
+    // Given
+    struct LazyWorld *world = new_lazy_world(1, 10, 8);
+    uint64_t to = 0;
+
+    // When
+    const bool actual = lazy_world_move(world, lazy_room_id(0, 0), "Room 1,0",
+            &to);
+
+    // Then
+    CuAssertIntEquals(tc, true, actual);
+    CuAssertTrue(tc, to == lazy_room_id(1, 0));
+    CuAssertIntEquals(tc, true, lazy_world_move(world, to, "Room 1,-1", &to));
+    CuAssertTrue(tc, to == lazy_room_id(1, -1));
+
+    // Clean up
+    del_lazy_world(world);
+}
+
+void lazy_world_move_when_not_connected_should_not_move(CuTest *tc) {
+    // Given
+    struct LazyWorld *world = new_lazy_world(1, 10, 8);
+    uint64_t to = 0;
+
+    // When / Then
+    CuAssertIntEquals(tc, false, lazy_world_move(world, lazy_room_id(0, 0),
+                "Room 2,0", &to));
+    CuAssertIntEquals(tc, false, lazy_world_move(world, lazy_room_id(0, 0),
+                "Room 01,0", &to));
+    CuAssertIntEquals(tc, false, lazy_world_move(world, lazy_room_id(0, 0),
+                "Room -0,0", &to));
+    CuAssertIntEquals(tc, false, lazy_world_move(world, lazy_room_id(0, 0),
+                "Room 1,0 ", &to));
+    CuAssertIntEquals(tc, false, lazy_world_move(world, lazy_room_id(0, 0),
+                "Eastern Palace", &to));
+    CuAssertTrue(tc, to == 0);
+
+    // Clean up
+    del_lazy_world(world);
+}
+
+CuSuite *get_lazy_world_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, materialize_lazy_room_should_be_deterministic);
+    SUITE_ADD_TEST(suite, materialize_lazy_room_should_have_symmetric_connections);
+    SUITE_ADD_TEST(suite, new_lazy_world_should_place_start_and_end_rooms);
+    SUITE_ADD_TEST(suite, lazy_world_get_when_cache_full_should_evict_and_regenerate);
+    SUITE_ADD_TEST(suite, lazy_world_get_when_cached_should_count_hit);
+    SUITE_ADD_TEST(suite, lazy_world_move_when_connected_should_move);
+    SUITE_ADD_TEST(suite, lazy_world_move_when_not_connected_should_not_move);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+void run_lazy_world_benchmark() {
+    const size_t num_moves = 1000000;
+    struct LazyWorld *world = new_lazy_world(2016, 1000, 4096);
+    struct LazyWorldStats stats;
+    char name[LAZY_ROOM_NAME_SIZE];
+    uint64_t curr = lazy_world_start(world);
+    size_t i;
+
+    // Walking east always enters a room that has never been visited
+    double start = now_seconds();
+
+    for (i = 0; i < num_moves; ++i) {
+        format_name(step(curr, DIRECTIONS[0]), name);
+        lazy_world_move(world, curr, name, &curr);
+    }
+
+    const double first_visit = now_seconds() - start;
+    lazy_world_stats(world, &stats);
+
+    printf("lazy_world: first-visit move: %.1f ns (%zu misses, %zu evictions, "
+            "%zu resident bytes)\n", first_visit / num_moves * 1e9,
+            stats.misses, stats.evictions, stats.resident_bytes);
+
+    // Walking back and forth between two rooms only hits the cache
+    const uint64_t home = curr;
+    char names[2][LAZY_ROOM_NAME_SIZE];
+    format_name(step(home, DIRECTIONS[3]), names[0]);
+    format_name(home, names[1]);
+
+    start = now_seconds();
+
+    for (i = 0; i < num_moves; ++i) {
+        lazy_world_move(world, curr, names[i % 2], &curr);
+    }
+
+    const double cached_visit = now_seconds() - start;
+    lazy_world_stats(world, &stats);
+
+    printf("lazy_world: cached-visit move: %.1f ns (%zu hits, %zu resident "
+            "bytes)\n", cached_visit / num_moves * 1e9, stats.hits,
+            stats.resident_bytes);
+
+    del_lazy_world(world);
+}
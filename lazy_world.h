@@ -0,0 +1,70 @@
+#ifndef LAZY_WORLD_H
+#define LAZY_WORLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "room.h"
+
+/*
+ * Lazy worlds are unbounded hexagonal grids whose rooms are derived from a
+ * seed and a room id the first time they are needed. A room id packs the
+ * axial coordinates (q, r) of its hex as ((uint32_t) q << 32) | (uint32_t) r.
+ */
+
+/*
+ * The number of neighbours of a hex, which bounds the connections of a room.
+ */
+#define LAZY_ROOM_MAX_CONNECTIONS 6
+
+/*
+ * The size of a room name buffer, large enough for "Room <q>,<r>".
+ */
+#define LAZY_ROOM_NAME_SIZE 32
+
+/*
+ * A structure that stores a materialized room. It mirrors struct Room but
+ * refers to its connections by id so that it never points at an evicted room.
+ */
+struct LazyRoom {
+    uint64_t id;
+    char name[LAZY_ROOM_NAME_SIZE];
+    room_t type;
+    size_t num_connections;
+    uint64_t connections[LAZY_ROOM_MAX_CONNECTIONS];
+};
+
+/*
+ * A structure that stores the cache counters of a LazyWorld.
+ */
+struct LazyWorldStats {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t resident_rooms;
+    size_t resident_bytes;
+};
+
+struct LazyWorld *new_lazy_world(const uint64_t seed,
+        const uint32_t end_distance, const size_t cache_capacity);
+
+void del_lazy_world(struct LazyWorld *world);
+
+uint64_t lazy_room_id(const int32_t q, const int32_t r);
+
+uint64_t lazy_world_start(const struct LazyWorld *world);
+
+uint64_t lazy_world_end(const struct LazyWorld *world);
+
+void materialize_lazy_room(const struct LazyWorld *world, const uint64_t id,
+        struct LazyRoom *room);
+
+const struct LazyRoom *lazy_world_get(struct LazyWorld *world,
+        const uint64_t id);
+
+bool lazy_world_move(struct LazyWorld *world, const uint64_t from,
+        const char *name, uint64_t *to);
+
+void lazy_world_stats(const struct LazyWorld *world,
+        struct LazyWorldStats *stats);
+
+#endif
@@ -0,0 +1,821 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "packed_world.h"
+#include "room_index.h"
+#include "world.h"
+#include "CuTest.h"
+
+/*
+ * Marks a room that is not cached.
+ */
+#define PACKED_NIL UINT32_MAX
+
+static const char PACKED_MAGIC[4] = { 'Z', 'P', 'K', 'W' };
+static const uint32_t PACKED_VERSION = 1;
+
+/*
+ * The header at the start of a packed world file. All integers are stored in
+ * host byte order.
+ */
+struct PackedHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t num_rooms;
+    uint64_t index_offset;
+};
+
+/*
+ * The header of a room record. It is followed by num_connections uint32_t
+ * room ids and then name_length bytes of name without a terminator.
+ */
+struct PackedRecordHeader {
+    uint32_t num_connections;
+    uint16_t name_length;
+    uint8_t type;
+    uint8_t padding;
+};
+
+/*
+ * An entry of the name index, sorted by hash and then by id.
+ */
+struct PackedName {
+    uint32_t hash;
+    uint32_t id;
+};
+
+/*
+ * A cached room. The decoded PackedRoom points into buffer, which holds the
+ * raw record plus a terminator for the name.
+ */
+struct PackedCacheEntry {
+    struct PackedRoom room;
+    char *buffer;
+    size_t buffer_size;
+    bool referenced;
+};
+
+/*
+ * A structure that stores an open packed world file, its resident index and
+ * the CLOCK cache of decoded rooms in front of it.
+ */
+struct PackedWorld {
+    int fd;
+    size_t num_rooms;
+    uint64_t *offsets;
+    uint32_t *name_hashes;
+    struct PackedName *names;
+    uint32_t *slot_of;
+    size_t capacity;
+    size_t size;
+    size_t hand;
+    struct PackedCacheEntry *entries;
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t moves;
+    double move_seconds;
+};
+
+/*
+ * The 32-bit FNV-1a hash of a name.
+ */
+static uint32_t hash_name(const char *name) {
+    uint32_t h = 2166136261u;
+
+    while (*name != '\0') {
+        h = (h ^ (uint8_t) *name++) * 16777619u;
+    }
+
+    return h;
+}
+
+/*
+ * Writes the given world to a packed world file. Fails if the world has a
+ * connection to a room outside of it or a name longer than 65535 bytes, in
+ * which case no file is left behind.
+ *
+ * @param path The path of the file to write.
+ * @param world A pointer to a RoomList.
+ * @return Whether the file was written.
+ */
+bool write_packed_world(const char *path, const struct RoomList *world) {
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    struct RoomIndex *index = new_room_index(world, 0);
+    uint64_t *offsets = (uint64_t*) malloc((index->size + 1) * sizeof(uint64_t));
+    uint32_t *name_hashes = (uint32_t*) malloc((index->size + 1) *
+            sizeof(uint32_t));
+    struct PackedHeader header;
+    uint64_t offset = sizeof(struct PackedHeader);
+    bool ok = true;
+    size_t i;
+    size_t j;
+
+    memcpy(header.magic, PACKED_MAGIC, sizeof(PACKED_MAGIC));
+    header.version = PACKED_VERSION;
+    header.num_rooms = index->size;
+    header.index_offset = 0;
+    ok = ok && fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (i = 0; ok && i < index->size; ++i) {
+        const struct Room *room = index->rooms[i];
+        const size_t name_length = strlen(room->name);
+        struct PackedRecordHeader record;
+
+        if (name_length > UINT16_MAX) {
+            ok = false;
+            break;
+        }
+
+        record.num_connections = (uint32_t) room->num_connections;
+        record.name_length = (uint16_t) name_length;
+        record.type = (uint8_t) room->type;
+        record.padding = 0;
+
+        offsets[i] = offset;
+        name_hashes[i] = hash_name(room->name);
+        ok = fwrite(&record, sizeof(record), 1, file) == 1;
+
+        for (j = index->offsets[i]; ok && j < index->offsets[i + 1]; ++j) {
+            const uint32_t neighbor = (uint32_t) index->neighbors[j];
+            ok = index->neighbors[j] != ROOM_INDEX_NONE
+                && fwrite(&neighbor, sizeof(neighbor), 1, file) == 1;
+        }
+
+        ok = ok && fwrite(room->name, 1, name_length, file) == name_length;
+        offset += sizeof(record) + room->num_connections * sizeof(uint32_t)
+            + name_length;
+    }
+
+    // The index follows the records; the extra offset bounds the last record
+    offsets[index->size] = offset;
+    header.index_offset = offset;
+
+    ok = ok
+        && fwrite(offsets, sizeof(uint64_t), index->size + 1, file)
+            == index->size + 1
+        && fwrite(name_hashes, sizeof(uint32_t), index->size, file)
+            == index->size
+        && fseek(file, 0, SEEK_SET) == 0
+        && fwrite(&header, sizeof(header), 1, file) == 1;
+
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok) {
+        unlink(path);
+    }
+
+    free(name_hashes);
+    free(offsets);
+    del_room_index(index);
+
+    return ok;
+}
+
+static int compare_names(const void *a, const void *b) {
+    const struct PackedName *name1 = (const struct PackedName*) a;
+    const struct PackedName *name2 = (const struct PackedName*) b;
+
+    if (name1->hash != name2->hash) {
+        return name1->hash < name2->hash ? -1 : 1;
+    }
+
+    return name1->id < name2->id ? -1 : (name1->id > name2->id);
+}
+
+/*
+ * Reads exactly size bytes at the given offset.
+ */
+static bool read_at(const int fd, void *buffer, const size_t size,
+        const uint64_t offset) {
+    size_t done = 0;
+
+    while (done < size) {
+        const ssize_t n = pread(fd, (char*) buffer + done, size - done,
+                (off_t) (offset + done));
+
+        if (n <= 0) {
+            return false;
+        }
+
+        done += (size_t) n;
+    }
+
+    return true;
+}
+
+/*
+ * Returns whether the offset index describes records that follow each other
+ * from the header up to the index, which itself must fit in the file.
+ */
+static bool valid_offsets(const struct PackedWorld *world,
+        const struct PackedHeader *header, const uint64_t file_size) {
+    const size_t n = world->num_rooms;
+    size_t i;
+
+    if (world->offsets[0] != sizeof(struct PackedHeader)
+            || world->offsets[n] != header->index_offset
+            || header->index_offset > file_size
+            || (file_size - header->index_offset) / sizeof(uint32_t)
+                < 3 * n + 2) {
+        return false;
+    }
+
+    for (i = 0; i < n; ++i) {
+        if (world->offsets[i + 1] < world->offsets[i]
+                || world->offsets[i + 1] - world->offsets[i]
+                    < sizeof(struct PackedRecordHeader)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Opens a packed world file. Only the offset index and the name hashes are
+ * read up front, and the offsets are checked; rooms are read on demand, and
+ * checked as they are decoded, and at most cache_capacity of them are kept
+ * decoded at a time.
+ *
+ * @param path The path of the file to open.
+ * @param cache_capacity The maximum number of cached rooms.
+ * @return A pointer to a new PackedWorld or NULL if the file is not valid.
+ */
+struct PackedWorld *open_packed_world(const char *path,
+        const size_t cache_capacity) {
+    const int fd = open(path, O_RDONLY);
+    struct PackedHeader header;
+    size_t i;
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (!read_at(fd, &header, sizeof(header), 0)
+            || memcmp(header.magic, PACKED_MAGIC, sizeof(PACKED_MAGIC)) != 0
+            || header.version != PACKED_VERSION
+            || header.num_rooms >= PACKED_NIL) {
+        close(fd);
+        return NULL;
+    }
+
+    struct PackedWorld *world = (struct PackedWorld*) calloc(1,
+            sizeof(struct PackedWorld));
+    const size_t n = (size_t) header.num_rooms;
+
+    world->fd = fd;
+    world->num_rooms = n;
+    world->offsets = (uint64_t*) malloc((n + 1) * sizeof(uint64_t));
+    world->name_hashes = (uint32_t*) malloc((n + 1) * sizeof(uint32_t));
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0
+            || header.index_offset > (uint64_t) st.st_size
+            || !read_at(fd, world->offsets, (n + 1) * sizeof(uint64_t),
+                header.index_offset)
+            || !read_at(fd, world->name_hashes, n * sizeof(uint32_t),
+                header.index_offset + (n + 1) * sizeof(uint64_t))
+            || !valid_offsets(world, &header, (uint64_t) st.st_size)) {
+        free(world->offsets);
+        free(world->name_hashes);
+        free(world);
+        close(fd);
+        return NULL;
+    }
+
+    world->names = (struct PackedName*) malloc((n + 1) *
+            sizeof(struct PackedName));
+    world->slot_of = (uint32_t*) malloc((n + 1) * sizeof(uint32_t));
+
+    for (i = 0; i < n; ++i) {
+        world->names[i].hash = world->name_hashes[i];
+        world->names[i].id = (uint32_t) i;
+        world->slot_of[i] = PACKED_NIL;
+    }
+
+    qsort(world->names, n, sizeof(struct PackedName), compare_names);
+
+    world->capacity = cache_capacity > 0 ? cache_capacity : 1;
+    world->entries = (struct PackedCacheEntry*) calloc(world->capacity,
+            sizeof(struct PackedCacheEntry));
+
+    return world;
+}
+
+/*
+ * Closes and deletes the given PackedWorld.
+ */
+void del_packed_world(struct PackedWorld *world) {
+    size_t i;
+
+    for (i = 0; i < world->size; ++i) {
+        free(world->entries[i].buffer);
+    }
+
+    close(world->fd);
+    free(world->entries);
+    free(world->slot_of);
+    free(world->names);
+    free(world->name_hashes);
+    free(world->offsets);
+    free(world);
+}
+
+/*
+ * Returns the number of rooms in the given PackedWorld.
+ */
+size_t packed_world_size(const struct PackedWorld *world) {
+    return world->num_rooms;
+}
+
+/*
+ * Picks the cache entry to load a room into, evicting the first room the
+ * CLOCK hand finds that has not been referenced since the hand last passed.
+ */
+static size_t claim_entry(struct PackedWorld *world) {
+    if (world->size < world->capacity) {
+        return world->size++;
+    }
+
+    while (world->entries[world->hand].referenced) {
+        world->entries[world->hand].referenced = false;
+        world->hand = (world->hand + 1) % world->capacity;
+    }
+
+    const size_t e = world->hand;
+    world->hand = (world->hand + 1) % world->capacity;
+    world->slot_of[world->entries[e].room.id] = PACKED_NIL;
+    world->evictions++;
+
+    return e;
+}
+
+/*
+ * Returns the room with the given id, reading it with a single positioned read
+ * if it is not cached. The returned pointer is only valid until the next call
+ * that may load a room.
+ *
+ * @param world A pointer to a PackedWorld.
+ * @param id The id of the room.
+ * @return A pointer to the decoded room or NULL if it cannot be read or is
+ * corrupt.
+ */
+const struct PackedRoom *packed_world_get(struct PackedWorld *world,
+        const uint32_t id) {
+    if (id >= world->num_rooms) {
+        return NULL;
+    }
+
+    if (world->slot_of[id] != PACKED_NIL) {
+        struct PackedCacheEntry *entry = &world->entries[world->slot_of[id]];
+        world->hits++;
+        entry->referenced = true;
+        return &entry->room;
+    }
+
+    world->misses++;
+
+    const size_t e = claim_entry(world);
+    struct PackedCacheEntry *entry = &world->entries[e];
+    const size_t length = (size_t) (world->offsets[id + 1] - world->offsets[id]);
+
+    if (entry->buffer_size < length + 1) {
+        free(entry->buffer);
+        entry->buffer_size = length + 1;
+        entry->buffer = (char*) malloc(entry->buffer_size);
+    }
+
+    const struct PackedRecordHeader *record =
+        (const struct PackedRecordHeader*) entry->buffer;
+    const uint32_t *connections = (const uint32_t*) (record + 1);
+    bool ok = read_at(world->fd, entry->buffer, length, world->offsets[id])
+        && record->type <= END_ROOM
+        && length == sizeof(struct PackedRecordHeader)
+            + (uint64_t) record->num_connections * sizeof(uint32_t)
+            + record->name_length;
+    size_t i;
+
+    for (i = 0; ok && i < record->num_connections; ++i) {
+        ok = connections[i] < world->num_rooms;
+    }
+
+    if (!ok) {
+        // Leave the entry holding a room that can never be looked up again
+        entry->room.id = id;
+        entry->referenced = false;
+        return NULL;
+    }
+
+    entry->buffer[length] = '\0';
+    entry->room.id = id;
+    entry->room.type = (room_t) record->type;
+    entry->room.num_connections = record->num_connections;
+    entry->room.connections = (const uint32_t*) (record + 1);
+    entry->room.name = (const char*) (entry->room.connections
+            + record->num_connections);
+    entry->referenced = true;
+    world->slot_of[id] = (uint32_t) e;
+
+    return &entry->room;
+}
+
+/*
+ * Finds the id of the room with the given name.
+ *
+ * @param world A pointer to a PackedWorld.
+ * @param name The name of the room.
+ * @param id Set to the id of the room if it is found.
+ * @return Whether a room with the given name exists.
+ */
+bool packed_world_find(struct PackedWorld *world, const char *name,
+        uint32_t *id) {
+    const uint32_t hash = hash_name(name);
+    size_t low = 0;
+    size_t high = world->num_rooms;
+
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+
+        if (world->names[mid].hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    for (; low < world->num_rooms && world->names[low].hash == hash; ++low) {
+        const struct PackedRoom *room = packed_world_get(world,
+                world->names[low].id);
+
+        if (room != NULL && strcmp(room->name, name) == 0) {
+            *id = room->id;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Follows the connection of the room from with the given name. Connections are
+ * matched on the resident name hashes first so only the destination is read.
+ *
+ * @param world A pointer to a PackedWorld.
+ * @param from The id of the current room.
+ * @param name The name of the room to move to.
+ * @param to Set to the id of the new room if the move succeeds.
+ * @return Whether from is connected to a room with the given name.
+ */
+bool packed_world_move(struct PackedWorld *world, const uint32_t from,
+        const char *name, uint32_t *to) {
+    const double start = now_seconds();
+    const uint32_t hash = hash_name(name);
+    const struct PackedRoom *room = packed_world_get(world, from);
+    uint32_t candidates[64];
+    size_t num_candidates = 0;
+    bool found = false;
+    size_t i;
+
+    if (room == NULL) {
+        return false;
+    }
+
+    // Collect the candidates first since loading one may evict the room
+    for (i = 0; i < room->num_connections && num_candidates < 64; ++i) {
+        if (world->name_hashes[room->connections[i]] == hash) {
+            candidates[num_candidates++] = room->connections[i];
+        }
+    }
+
+    for (i = 0; i < num_candidates && !found; ++i) {
+        const struct PackedRoom *candidate = packed_world_get(world,
+                candidates[i]);
+
+        if (candidate != NULL && strcmp(candidate->name, name) == 0) {
+            *to = candidate->id;
+            found = true;
+        }
+    }
+
+    world->moves++;
+    world->move_seconds += now_seconds() - start;
+
+    return found;
+}
+
+/*
+ * Fills in the cache counters of the given PackedWorld.
+ */
+void packed_world_stats(const struct PackedWorld *world,
+        struct PackedWorldStats *stats) {
+    const size_t lookups = world->hits + world->misses;
+    size_t i;
+
+    stats->hits = world->hits;
+    stats->misses = world->misses;
+    stats->evictions = world->evictions;
+    stats->hit_ratio = lookups > 0 ? (double) world->hits / lookups : 0.0;
+    stats->resident_rooms = world->size;
+    stats->resident_bytes = sizeof(struct PackedWorld)
+        + (world->num_rooms + 1) * (sizeof(uint64_t) + sizeof(uint32_t)
+                + sizeof(struct PackedName) + sizeof(uint32_t))
+        + world->capacity * sizeof(struct PackedCacheEntry);
+
+    for (i = 0; i < world->size; ++i) {
+        stats->resident_bytes += world->entries[i].buffer_size;
+    }
+
+    stats->moves = world->moves;
+    stats->mean_move_ns = world->moves > 0
+        ? world->move_seconds / world->moves * 1e9 : 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void open_packed_world_should_read_back_written_world(CuTest *tc) {
+    // Given
+    char path[64];
+    struct RoomList *world = new_circulant_world(100, 6);
+    test_path(path, sizeof(path), "packed_world_test", ".bin");
+    CuAssertIntEquals(tc, true, write_packed_world(path, world));
+
+    // When
+    struct PackedWorld *packed = open_packed_world(path, 8);
+
+    // Then
+    CuAssertPtrNotNull(tc, packed);
+    CuAssertIntEquals(tc, 100, packed_world_size(packed));
+
+    struct RoomIndex *index = new_room_index(world, 1);
+
+    size_t i;
+    size_t j;
+    struct RoomLink *curr;
+    for (i = 0, curr = world->head; curr != NULL; ++i, curr = curr->next) {
+        const struct PackedRoom *room = packed_world_get(packed, (uint32_t) i);
+
+        CuAssertStrEquals(tc, curr->room->name, room->name);
+        CuAssertIntEquals(tc, curr->room->type, room->type);
+        CuAssertIntEquals(tc, curr->room->num_connections, room->num_connections);
+
+        for (j = 0; j < room->num_connections; ++j) {
+            CuAssertIntEquals(tc, index->neighbors[index->offsets[i] + j],
+                    room->connections[j]);
+        }
+    }
+
+    // Clean up
+    del_room_index(index);
+    del_packed_world(packed);
+    del_world(world);
+    unlink(path);
+}
+
+void open_packed_world_when_file_not_packed_world_should_return_null(CuTest *tc) {
+    // Given
+    char path[64];
+    test_path(path, sizeof(path), "packed_world_test", ".bin");
+    FILE *file = fopen(path, "w");
+    fputs("ROOM NAME: Eastern Palace\n", file);
+    fclose(file);
+
+    // When
+    struct PackedWorld *packed = open_packed_world(path, 8);
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, packed);
+    CuAssertPtrEquals(tc, NULL, open_packed_world("/nonexistent/world.bin", 8));
+
+    // Clean up
+    unlink(path);
+}
+
+void packed_world_get_when_connection_out_of_range_should_return_null(
+        CuTest *tc) {
+    // Given a file whose first room lists a connection to a room that does
+    // not exist
+    char path[64];
+    struct RoomList *world = new_circulant_world(10, 2);
+    const uint32_t bad_id = 1000;
+    uint32_t to;
+    test_path(path, sizeof(path), "packed_world_test", ".bin");
+    CuAssertIntEquals(tc, true, write_packed_world(path, world));
+
+    const int fd = open(path, O_WRONLY);
+    CuAssertIntEquals(tc, sizeof(bad_id), pwrite(fd, &bad_id, sizeof(bad_id),
+                sizeof(struct PackedHeader)
+                + sizeof(struct PackedRecordHeader)));
+    close(fd);
+
+    // When
+    struct PackedWorld *packed = open_packed_world(path, 8);
+
+    // Then
+    CuAssertPtrNotNull(tc, packed);
+    CuAssertPtrEquals(tc, NULL, (void*) packed_world_get(packed, 0));
+    CuAssertIntEquals(tc, false, packed_world_move(packed, 0, "Room 1", &to));
+    CuAssertPtrNotNull(tc, packed_world_get(packed, 1));
+
+    // Clean up
+    del_packed_world(packed);
+    del_world(world);
+    unlink(path);
+}
+
+void open_packed_world_when_offsets_out_of_order_should_return_null(
+        CuTest *tc) {
+    // Given a file whose offset index runs backwards
+    char path[64];
+    struct RoomList *world = new_circulant_world(10, 2);
+    struct PackedHeader header;
+    const uint64_t bad_offset = 1;
+    test_path(path, sizeof(path), "packed_world_test", ".bin");
+    CuAssertIntEquals(tc, true, write_packed_world(path, world));
+
+    const int fd = open(path, O_RDWR);
+    CuAssertIntEquals(tc, sizeof(header), pread(fd, &header, sizeof(header),
+                0));
+    CuAssertIntEquals(tc, sizeof(bad_offset), pwrite(fd, &bad_offset,
+                sizeof(bad_offset), header.index_offset + sizeof(uint64_t)));
+    close(fd);
+
+    // When
+    struct PackedWorld *packed = open_packed_world(path, 8);
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, packed);
+
+    // Clean up
+    del_world(world);
+    unlink(path);
+}
+
+void write_packed_world_when_name_too_long_should_leave_no_file(CuTest *tc) {
+    // Given
+    char path[64];
+    struct RoomList *world = new_circulant_world(10, 2);
+    char *name = (char*) malloc(UINT16_MAX + 2);
+    struct stat st;
+    test_path(path, sizeof(path), "packed_world_test", ".bin");
+    memset(name, 'x', UINT16_MAX + 1);
+    name[UINT16_MAX + 1] = '\0';
+    add_room(world, new_room(name, MID_ROOM));
+
+    // When
+    const bool ok = write_packed_world(path, world);
+
+    // Then
+    CuAssertIntEquals(tc, false, ok);
+    CuAssertIntEquals(tc, -1, stat(path, &st));
+
+    // Clean up
+    free(name);
+    del_world(world);
+}
+
+void packed_world_find_should_find_room_by_name(CuTest *tc) {
+    // Given
+    char path[64];
+    struct RoomList *world = new_circulant_world(100, 6);
+    test_path(path, sizeof(path), "packed_world_test", ".bin");
+    write_packed_world(path, world);
+    struct PackedWorld *packed = open_packed_world(path, 8);
+    uint32_t id = 0;
+
+    // When / Then
+    CuAssertIntEquals(tc, true, packed_world_find(packed, "Room 42", &id));
+    CuAssertIntEquals(tc, 42, id);
+    CuAssertIntEquals(tc, false, packed_world_find(packed, "Room 420", &id));
+
+    // Clean up
+    del_packed_world(packed);
+    del_world(world);
+    unlink(path);
+}
+
+void packed_world_move_should_follow_connection_by_name(CuTest *tc) {
+    // Given
+    char path[64];
+    struct RoomList *world = new_circulant_world(100, 6);
+    test_path(path, sizeof(path), "packed_world_test", ".bin");
+    write_packed_world(path, world);
+    struct PackedWorld *packed = open_packed_world(path, 1);
+    uint32_t to = 0;
+
+    // When / Then
+    CuAssertIntEquals(tc, true, packed_world_move(packed, 0, "Room 97", &to));
+    CuAssertIntEquals(tc, 97, to);
+    CuAssertIntEquals(tc, false, packed_world_move(packed, 97, "Room 1", &to));
+    CuAssertIntEquals(tc, 97, to);
+
+    // Clean up
+    del_packed_world(packed);
+    del_world(world);
+    unlink(path);
+}
+
+void packed_world_stats_should_count_hits_misses_and_evictions(CuTest *tc) {
+    // Given
+    char path[64];
+    struct RoomList *world = new_circulant_world(100, 6);
+    test_path(path, sizeof(path), "packed_world_test", ".bin");
+    write_packed_world(path, world);
+    struct PackedWorld *packed = open_packed_world(path, 2);
+    struct PackedWorldStats stats;
+
+    // When
+    packed_world_get(packed, 0);
+    packed_world_get(packed, 0);
+    packed_world_get(packed, 1);
+    packed_world_get(packed, 2);
+    packed_world_get(packed, 3);
+
+    // Then
+    packed_world_stats(packed, &stats);
+    CuAssertIntEquals(tc, 1, stats.hits);
+    CuAssertIntEquals(tc, 4, stats.misses);
+    CuAssertIntEquals(tc, 2, stats.evictions);
+    CuAssertIntEquals(tc, 2, stats.resident_rooms);
+    CuAssertDblEquals(tc, 0.2, stats.hit_ratio, 1e-9);
+    CuAssertStrEquals(tc, "Room 3", packed_world_get(packed, 3)->name);
+
+    // Clean up
+    del_packed_world(packed);
+    del_world(world);
+    unlink(path);
+}
+
+CuSuite *get_packed_world_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, open_packed_world_should_read_back_written_world);
+    SUITE_ADD_TEST(suite, open_packed_world_when_file_not_packed_world_should_return_null);
+    SUITE_ADD_TEST(suite, packed_world_get_when_connection_out_of_range_should_return_null);
+    SUITE_ADD_TEST(suite, open_packed_world_when_offsets_out_of_order_should_return_null);
+    SUITE_ADD_TEST(suite, write_packed_world_when_name_too_long_should_leave_no_file);
+    SUITE_ADD_TEST(suite, packed_world_find_should_find_room_by_name);
+    SUITE_ADD_TEST(suite, packed_world_move_should_follow_connection_by_name);
+    SUITE_ADD_TEST(suite, packed_world_stats_should_count_hits_misses_and_evictions);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+void run_packed_world_benchmark() {
+    const size_t num_rooms = 1000000;
+    const size_t num_moves = 1000000;
+    const char *path = "/tmp/packed_world_benchmark.bin";
+    struct RoomList *world = new_circulant_world(num_rooms, 6);
+    size_t capacity;
+
+    write_packed_world(path, world);
+    del_world(world);
+
+    for (capacity = 1024; capacity <= num_rooms; capacity *= 16) {
+        struct PackedWorld *packed = open_packed_world(path, capacity);
+        struct PackedWorldStats stats;
+        uint64_t rng = 2016;
+        uint32_t curr = 0;
+        size_t i;
+
+        // A random walk that keeps jumping far away stresses the cache
+        for (i = 0; i < num_moves; ++i) {
+            const struct PackedRoom *room = packed_world_get(packed, curr);
+            char name[32];
+
+            // Circulant worlds name every room after its id
+            rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+            snprintf(name, sizeof(name), "Room %u",
+                    room->connections[(rng >> 33) % room->num_connections]);
+            packed_world_move(packed, curr, name, &curr);
+
+            if (i % 64 == 0) {
+                curr = (uint32_t) ((rng >> 20) % num_rooms);
+            }
+        }
+
+        packed_world_stats(packed, &stats);
+        printf("packed_world: cache %zu rooms: hit ratio %.3f, %zu resident "
+                "bytes, %.1f ns per move\n", capacity, stats.hit_ratio,
+                stats.resident_bytes, stats.mean_move_ns);
+
+        del_packed_world(packed);
+    }
+
+    unlink(path);
+}
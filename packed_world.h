@@ -0,0 +1,63 @@
+#ifndef PACKED_WORLD_H
+#define PACKED_WORLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "room.h"
+#include "room_list.h"
+
+/*
+ * A packed world file stores every room of a world as a variable length record
+ * followed by an offset index, so that a world larger than memory can be
+ * served through a fixed-size cache with one positioned read per miss. Rooms
+ * are identified by their position in the RoomList they were written from.
+ */
+
+/*
+ * A structure that stores a decoded room. It mirrors struct Room but refers
+ * to its connections by id.
+ */
+struct PackedRoom {
+    uint32_t id;
+    const char *name;
+    room_t type;
+    size_t num_connections;
+    const uint32_t *connections;
+};
+
+/*
+ * A structure that stores the cache counters of a PackedWorld.
+ */
+struct PackedWorldStats {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    double hit_ratio;
+    size_t resident_rooms;
+    size_t resident_bytes;
+    size_t moves;
+    double mean_move_ns;
+};
+
+bool write_packed_world(const char *path, const struct RoomList *world);
+
+struct PackedWorld *open_packed_world(const char *path,
+        const size_t cache_capacity);
+
+void del_packed_world(struct PackedWorld *world);
+
+size_t packed_world_size(const struct PackedWorld *world);
+
+const struct PackedRoom *packed_world_get(struct PackedWorld *world,
+        const uint32_t id);
+
+bool packed_world_find(struct PackedWorld *world, const char *name,
+        uint32_t *id);
+
+bool packed_world_move(struct PackedWorld *world, const uint32_t from,
+        const char *name, uint32_t *to);
+
+void packed_world_stats(const struct PackedWorld *world,
+        struct PackedWorldStats *stats);
+
+#endif
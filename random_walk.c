@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "random_walk.h"
+#include "room_index.h"
+#include "world.h"
+#include "CuTest.h"
+
+/*
+ * The state shared by the walker threads. Every thread only writes to its own
+ * row of visits and to the steps of its own walks.
+ */
+struct WalkTask {
+    const struct RoomIndex *index;
+    const struct WalkConfig *config;
+    size_t start;
+    size_t end;
+    size_t max_steps;
+    uint32_t *steps;
+    uint64_t *visits;
+};
+
+/*
+ * Marks a walk that never reached the END_ROOM.
+ */
+#define WALK_UNFINISHED UINT32_MAX
+
+/*
+ * Runs the walks in [begin, end) with a generator seeded from the simulation
+ * seed and the thread index, so results only depend on those two.
+ */
+static void walk_range(void *ctx, size_t begin, size_t end, size_t thread) {
+    struct WalkTask *task = (struct WalkTask*) ctx;
+    const struct RoomIndex *index = task->index;
+    uint64_t *visits = task->visits + thread * index->size;
+    struct Xoshiro256 rng;
+    size_t walk;
+
+    seed_xoshiro(&rng, task->config->seed ^ (0x9e3779b97f4a7c15ULL * (thread + 1)));
+
+    for (walk = begin; walk < end; ++walk) {
+        size_t room = task->start;
+        size_t steps = 0;
+
+        visits[room]++;
+
+        while (room != task->end && steps < task->max_steps) {
+            const size_t degree = index->offsets[room + 1] - index->offsets[room];
+
+            if (degree == 0) {
+                break;
+            }
+
+            room = index->neighbors[index->offsets[room]
+                + xoshiro_below(&rng, degree)];
+
+            if (room == ROOM_INDEX_NONE) {
+                break;
+            }
+
+            visits[room]++;
+            steps++;
+        }
+
+        task->steps[walk] = room == task->end ? (uint32_t) steps
+            : WALK_UNFINISHED;
+    }
+}
+
+static int compare_steps(const void *a, const void *b) {
+    const uint32_t steps1 = *(const uint32_t*) a;
+    const uint32_t steps2 = *(const uint32_t*) b;
+    return steps1 < steps2 ? -1 : (steps1 > steps2);
+}
+
+/*
+ * Simulates num_walks random walks from the START_ROOM, each picking one of
+ * the connections of the current room uniformly at random until it reaches
+ * the END_ROOM. Walks are spread over num_threads threads (0 means one per
+ * online processor) that share nothing but read-only world data, and the
+ * results are deterministic for a given seed and thread count.
+ *
+ * @param world A pointer to a RoomList.
+ * @param config A pointer to the simulation parameters.
+ * @return A pointer to a new WalkReport or NULL if the world has no
+ * START_ROOM or END_ROOM.
+ */
+struct WalkReport *simulate_random_walks(const struct RoomList *world,
+        const struct WalkConfig *config) {
+    const size_t num_threads = config->num_threads > 0 ? config->num_threads
+        : default_num_threads();
+    struct RoomIndex *index = new_room_index(world, num_threads);
+    struct WalkTask task;
+    size_t i;
+    size_t t;
+
+    task.index = index;
+    task.config = config;
+    task.start = ROOM_INDEX_NONE;
+    task.end = ROOM_INDEX_NONE;
+
+    // Step counts must stay below the mark of an unfinished walk
+    task.max_steps = config->max_steps < WALK_UNFINISHED ? config->max_steps
+        : WALK_UNFINISHED - 1;
+
+    for (i = 0; i < index->size; ++i) {
+        if (index->rooms[i]->type == START_ROOM && task.start == ROOM_INDEX_NONE) {
+            task.start = i;
+        } else if (index->rooms[i]->type == END_ROOM && task.end == ROOM_INDEX_NONE) {
+            task.end = i;
+        }
+    }
+
+    if (task.start == ROOM_INDEX_NONE || task.end == ROOM_INDEX_NONE) {
+        del_room_index(index);
+        return NULL;
+    }
+
+    task.steps = (uint32_t*) malloc((config->num_walks + 1) * sizeof(uint32_t));
+    task.visits = (uint64_t*) calloc(num_threads * index->size,
+            sizeof(uint64_t));
+
+    const double start = now_seconds();
+    parallel_for(config->num_walks, num_threads, walk_range, &task);
+    const double seconds = now_seconds() - start;
+
+    struct WalkReport *report = (struct WalkReport*) calloc(1,
+            sizeof(struct WalkReport));
+
+    report->num_walks = config->num_walks;
+    report->num_rooms = index->size;
+    report->visits = (uint64_t*) calloc(index->size + 1, sizeof(uint64_t));
+    report->seconds = seconds;
+    report->walks_per_second = seconds > 0 ? config->num_walks / seconds : 0.0;
+
+    for (t = 0; t < num_threads; ++t) {
+        for (i = 0; i < index->size; ++i) {
+            report->visits[i] += task.visits[t * index->size + i];
+        }
+    }
+
+    // Unfinished walks sort to the end so the finished ones form a prefix
+    qsort(task.steps, config->num_walks, sizeof(uint32_t), compare_steps);
+
+    double total_steps = 0.0;
+
+    while (report->num_finished < config->num_walks
+            && task.steps[report->num_finished] != WALK_UNFINISHED) {
+        total_steps += task.steps[report->num_finished++];
+    }
+
+    if (report->num_finished > 0) {
+        const size_t n = report->num_finished;
+        report->mean_steps = total_steps / n;
+        report->median_steps = task.steps[(n - 1) / 2];
+        report->p95_steps = task.steps[(n * 95 + 99) / 100 - 1];
+        report->max_steps = task.steps[n - 1];
+    }
+
+    free(task.visits);
+    free(task.steps);
+    del_room_index(index);
+
+    return report;
+}
+
+/*
+ * Deletes the given WalkReport.
+ */
+void del_walk_report(struct WalkReport *report) {
+    free(report->visits);
+    free(report);
+}
+
+/*
+ * Prints the given WalkReport.
+ */
+void print_walk_report(const struct WalkReport *report) {
+    printf("WALKS: %zu\n", report->num_walks);
+    printf("FINISHED: %zu\n", report->num_finished);
+    printf("MEAN STEPS: %.2f\n", report->mean_steps);
+    printf("MEDIAN STEPS: %zu\n", report->median_steps);
+    printf("P95 STEPS: %zu\n", report->p95_steps);
+    printf("MAX STEPS: %zu\n", report->max_steps);
+    printf("WALKS PER SECOND: %.0f\n", report->walks_per_second);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void simulate_random_walks_when_end_next_to_start_should_take_one_step(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_room_list();
+    struct Room *start = new_room("start", START_ROOM);
+    struct Room *end = new_room("end", END_ROOM);
+    struct WalkConfig config = { 100, 1000, 1, 2 };
+    add_room(world, start);
+    add_room(world, end);
+    add_connection(start, end);
+
+    // When
+    struct WalkReport *report = simulate_random_walks(world, &config);
+
+    // Then
+    CuAssertIntEquals(tc, 100, report->num_finished);
+    CuAssertDblEquals(tc, 1.0, report->mean_steps, 1e-9);
+    CuAssertIntEquals(tc, 1, report->median_steps);
+    CuAssertIntEquals(tc, 1, report->p95_steps);
+    CuAssertIntEquals(tc, 100, report->visits[0]);
+    CuAssertIntEquals(tc, 100, report->visits[1]);
+
+    // Clean up
+    del_walk_report(report);
+    del_world(world);
+}
+
+void simulate_random_walks_should_be_deterministic(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(30, 4);
+    struct WalkConfig config = { 1000, 100000, 2016, 3 };
+
+    // When
+    struct WalkReport *report1 = simulate_random_walks(world, &config);
+    struct WalkReport *report2 = simulate_random_walks(world, &config);
+
+    // Then
+    CuAssertIntEquals(tc, 1000, report1->num_finished);
+    CuAssertDblEquals(tc, report1->mean_steps, report2->mean_steps, 0.0);
+    CuAssertIntEquals(tc, report1->p95_steps, report2->p95_steps);
+
+    size_t i;
+    for (i = 0; i < 30; ++i) {
+        CuAssertTrue(tc, report1->visits[i] == report2->visits[i]);
+    }
+
+    CuAssertTrue(tc, report1->median_steps <= report1->p95_steps);
+    CuAssertTrue(tc, report1->p95_steps <= report1->max_steps);
+
+    // Clean up
+    del_walk_report(report1);
+    del_walk_report(report2);
+    del_world(world);
+}
+
+void simulate_random_walks_when_step_limit_reached_should_not_finish(CuTest *tc) {
+    // Given the END_ROOM is 15 rooms away on a ring
+    struct RoomList *world = new_circulant_world(30, 2);
+    struct WalkConfig config = { 50, 10, 1, 1 };
+
+    // When
+    struct WalkReport *report = simulate_random_walks(world, &config);
+
+    // Then
+    CuAssertIntEquals(tc, 0, report->num_finished);
+    CuAssertIntEquals(tc, 50, report->num_walks);
+
+    // Clean up
+    del_walk_report(report);
+    del_world(world);
+}
+
+void simulate_random_walks_when_no_end_room_should_return_null(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 2);
+    struct WalkConfig config = { 10, 10, 1, 1 };
+    world->head->next->next->next->next->next->room->type = MID_ROOM;
+
+    // When
+    struct WalkReport *report = simulate_random_walks(world, &config);
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, report);
+
+    // Clean up
+    del_world(world);
+}
+
+CuSuite *get_random_walk_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, simulate_random_walks_when_end_next_to_start_should_take_one_step);
+    SUITE_ADD_TEST(suite, simulate_random_walks_should_be_deterministic);
+    SUITE_ADD_TEST(suite, simulate_random_walks_when_step_limit_reached_should_not_finish);
+    SUITE_ADD_TEST(suite, simulate_random_walks_when_no_end_room_should_return_null);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+void run_random_walk_benchmark() {
+    struct RoomList *world = new_circulant_world(100, 6);
+    struct WalkConfig config = { 1000000, 1000000, 2016, 0 };
+    struct WalkReport *report = simulate_random_walks(world, &config);
+
+    printf("random_walk: %zu walks over %zu rooms in %.3f s\n",
+            report->num_walks, report->num_rooms, report->seconds);
+    print_walk_report(report);
+
+    del_walk_report(report);
+    del_world(world);
+}
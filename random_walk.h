@@ -0,0 +1,46 @@
+#ifndef RANDOM_WALK_H
+#define RANDOM_WALK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "room.h"
+#include "room_list.h"
+
+/*
+ * A structure that stores the parameters of a random walk simulation. Walks
+ * that have not reached the END_ROOM after max_steps steps, or UINT32_MAX - 1
+ * if that is fewer, are abandoned.
+ */
+struct WalkConfig {
+    size_t num_walks;
+    size_t max_steps;
+    uint64_t seed;
+    size_t num_threads;
+};
+
+/*
+ * A structure that stores the outcome of a random walk simulation. The step
+ * statistics only cover finished walks. visits[i] counts how many times the
+ * i-th room of the world was entered, including the starting room.
+ */
+struct WalkReport {
+    size_t num_walks;
+    size_t num_finished;
+    double mean_steps;
+    size_t median_steps;
+    size_t p95_steps;
+    size_t max_steps;
+    size_t num_rooms;
+    uint64_t *visits;
+    double seconds;
+    double walks_per_second;
+};
+
+struct WalkReport *simulate_random_walks(const struct RoomList *world,
+        const struct WalkConfig *config);
+
+void del_walk_report(struct WalkReport *report);
+
+void print_walk_report(const struct WalkReport *report);
+
+#endif
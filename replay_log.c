@@ -0,0 +1,710 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "replay_log.h"
+#include "room_index.h"
+#include "world.h"
+#include "CuTest.h"
+
+static const char REPLAY_MAGIC[4] = { 'Z', 'R', 'P', 'L' };
+static const uint32_t REPLAY_VERSION = 1;
+
+/*
+ * The header at the start of a replay log file.
+ */
+struct ReplayHeader {
+    char magic[4];
+    uint32_t version;
+};
+
+/*
+ * A structure that stores an open replay log. Appenders fill the active buffer
+ * under the lock; the writer thread swaps it with the spare one and writes it
+ * out without holding the lock, so appends never wait for the disk.
+ */
+struct ReplayLog {
+    int fd;
+    double interval;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t durable;
+    pthread_t writer;
+    struct ReplayRecord *active;
+    size_t active_size;
+    size_t active_capacity;
+    double active_append_sum;
+    double active_oldest;
+    struct ReplayRecord *spare;
+    size_t spare_capacity;
+    uint64_t next_sequence;
+    uint64_t durable_sequence;
+    bool closing;
+    bool failed;
+    struct ReplayLogStats stats;
+};
+
+static uint64_t realtime_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static bool write_all(const int fd, const void *buffer, const size_t size) {
+    size_t done = 0;
+
+    while (done < size) {
+        const ssize_t n = write(fd, (const char*) buffer + done, size - done);
+
+        if (n <= 0) {
+            return false;
+        }
+
+        done += (size_t) n;
+    }
+
+    return true;
+}
+
+/*
+ * Commits whatever has been appended once per interval, or right away when
+ * the log is being closed. Once a commit fails nothing more is written, so
+ * that no record lands after a torn one, and later appends are dropped.
+ */
+static void *run_writer(void *arg) {
+    struct ReplayLog *log = (struct ReplayLog*) arg;
+
+    pthread_mutex_lock(&log->lock);
+
+    while (true) {
+        if (!log->closing) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            const double seconds = deadline.tv_nsec / 1e9 + log->interval;
+            deadline.tv_sec += (time_t) seconds;
+            deadline.tv_nsec = (long) ((seconds - (time_t) seconds) * 1e9);
+            pthread_cond_timedwait(&log->wake, &log->lock, &deadline);
+        }
+
+        if (log->failed) {
+            log->active_size = 0;
+        }
+
+        if (log->active_size == 0) {
+            if (log->closing) {
+                break;
+            }
+
+            continue;
+        }
+
+        // Swap the buffers so appends can go on while this batch is written
+        struct ReplayRecord *batch = log->active;
+        const size_t batch_size = log->active_size;
+        const size_t batch_capacity = log->active_capacity;
+        const double append_sum = log->active_append_sum;
+        const double oldest = log->active_oldest;
+        const uint64_t sequence = log->next_sequence;
+
+        log->active = log->spare;
+        log->active_capacity = log->spare_capacity;
+        log->active_size = 0;
+        log->active_append_sum = 0;
+        pthread_mutex_unlock(&log->lock);
+
+        const bool ok = write_all(log->fd, batch,
+                batch_size * sizeof(struct ReplayRecord))
+            && fdatasync(log->fd) == 0;
+        const double committed_at = now_seconds();
+
+        pthread_mutex_lock(&log->lock);
+        log->spare = batch;
+        log->spare_capacity = batch_capacity;
+        log->failed = !ok;
+
+        if (ok) {
+            log->durable_sequence = sequence;
+            log->stats.records += batch_size;
+            log->stats.commits++;
+            log->stats.mean_durability_ms += (batch_size * committed_at
+                    - append_sum) * 1e3;
+
+            if ((committed_at - oldest) * 1e3
+                    > log->stats.max_durability_ms) {
+                log->stats.max_durability_ms = (committed_at - oldest) * 1e3;
+            }
+        }
+
+        pthread_cond_broadcast(&log->durable);
+    }
+
+    pthread_mutex_unlock(&log->lock);
+
+    return NULL;
+}
+
+/*
+ * Opens a replay log for appending, creating it if needed. A partial record
+ * left at the end by a crash is cut off so new records stay aligned.
+ *
+ * @param path The path of the log file.
+ * @param interval_seconds How often appended records are committed.
+ * @return A pointer to a new ReplayLog or NULL if the file is not a log.
+ */
+struct ReplayLog *open_replay_log(const char *path,
+        const double interval_seconds) {
+    const int fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct ReplayHeader header;
+    struct stat st;
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    if (st.st_size == 0) {
+        memcpy(header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+        header.version = REPLAY_VERSION;
+
+        if (!write_all(fd, &header, sizeof(header))) {
+            close(fd);
+            return NULL;
+        }
+    } else {
+        const off_t records_size = st.st_size - (off_t) sizeof(header);
+
+        if (pread(fd, &header, sizeof(header), 0) != sizeof(header)
+                || memcmp(header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0
+                || header.version != REPLAY_VERSION
+                || ftruncate(fd, st.st_size - records_size
+                    % (off_t) sizeof(struct ReplayRecord)) != 0) {
+            close(fd);
+            return NULL;
+        }
+    }
+
+    lseek(fd, 0, SEEK_END);
+
+    struct ReplayLog *log = (struct ReplayLog*) calloc(1,
+            sizeof(struct ReplayLog));
+
+    log->fd = fd;
+    log->interval = interval_seconds;
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->wake, NULL);
+    pthread_cond_init(&log->durable, NULL);
+    log->active_capacity = 1024;
+    log->active = (struct ReplayRecord*) malloc(log->active_capacity *
+            sizeof(struct ReplayRecord));
+    log->spare_capacity = 1024;
+    log->spare = (struct ReplayRecord*) malloc(log->spare_capacity *
+            sizeof(struct ReplayRecord));
+    pthread_create(&log->writer, NULL, run_writer, log);
+
+    return log;
+}
+
+/*
+ * Appends a move to the log. The move is durable once a later call to
+ * replay_log_wait_durable with the returned sequence number returns.
+ * Safe to call from any number of threads.
+ *
+ * @param log A pointer to a ReplayLog.
+ * @param session_id The id of the session that moved.
+ * @param step The index of the move within the session, starting from 0 for
+ * the room the session starts in.
+ * @param room_id The id of the room moved to.
+ * @return The sequence number of the record.
+ */
+uint64_t replay_log_append(struct ReplayLog *log, const uint64_t session_id,
+        const uint32_t step, const uint32_t room_id) {
+    const double appended_at = now_seconds();
+    struct ReplayRecord record;
+
+    record.session_id = session_id;
+    record.step = step;
+    record.room_id = room_id;
+    record.timestamp_ns = realtime_ns();
+
+    pthread_mutex_lock(&log->lock);
+
+    if (log->active_size == log->active_capacity) {
+        log->active_capacity *= 2;
+        log->active = (struct ReplayRecord*) realloc(log->active,
+                log->active_capacity * sizeof(struct ReplayRecord));
+    }
+
+    if (log->active_size == 0) {
+        log->active_oldest = appended_at;
+    }
+
+    log->active[log->active_size++] = record;
+    log->active_append_sum += appended_at;
+    const uint64_t sequence = ++log->next_sequence;
+
+    pthread_mutex_unlock(&log->lock);
+
+    return sequence;
+}
+
+/*
+ * Blocks until the record with the given sequence number has been synced to
+ * disk, or the writer has failed.
+ *
+ * @param log A pointer to a ReplayLog.
+ * @param sequence The sequence number replay_log_append returned.
+ * @return Whether the record is durable.
+ */
+bool replay_log_wait_durable(struct ReplayLog *log, const uint64_t sequence) {
+    pthread_mutex_lock(&log->lock);
+
+    while (log->durable_sequence < sequence && !log->failed) {
+        pthread_cond_wait(&log->durable, &log->lock);
+    }
+
+    const bool durable = log->durable_sequence >= sequence;
+
+    pthread_mutex_unlock(&log->lock);
+
+    return durable;
+}
+
+/*
+ * Commits every appended record, stops the writer and deletes the log.
+ *
+ * @param log A pointer to a ReplayLog.
+ * @param stats A pointer to the ReplayLogStats to fill in, or NULL.
+ * @return Whether every record was written and synced.
+ */
+bool close_replay_log(struct ReplayLog *log, struct ReplayLogStats *stats) {
+    pthread_mutex_lock(&log->lock);
+    log->closing = true;
+    pthread_cond_signal(&log->wake);
+    pthread_mutex_unlock(&log->lock);
+    pthread_join(log->writer, NULL);
+
+    const bool closed = close(log->fd) == 0;
+    const bool ok = !log->failed && closed;
+
+    if (stats != NULL) {
+        *stats = log->stats;
+
+        if (stats->records > 0) {
+            stats->mean_durability_ms /= stats->records;
+        }
+    }
+
+    pthread_cond_destroy(&log->durable);
+    pthread_cond_destroy(&log->wake);
+    pthread_mutex_destroy(&log->lock);
+    free(log->active);
+    free(log->spare);
+    free(log);
+
+    return ok;
+}
+
+static int compare_records(const void *a, const void *b) {
+    const struct ReplayRecord *record1 = (const struct ReplayRecord*) a;
+    const struct ReplayRecord *record2 = (const struct ReplayRecord*) b;
+
+    if (record1->session_id != record2->session_id) {
+        return record1->session_id < record2->session_id ? -1 : 1;
+    }
+
+    return record1->step < record2->step ? -1 : (record1->step > record2->step);
+}
+
+/*
+ * Reconstructs every session recorded in a replay log against the world it
+ * was played in. A partial record at the end of the log is ignored.
+ *
+ * @param path The path of the log file.
+ * @param world A pointer to the RoomList the room ids refer to.
+ * @return A pointer to new ReplaySessions or NULL if the file is not a log.
+ */
+struct ReplaySessions *replay_sessions(const char *path,
+        const struct RoomList *world) {
+    FILE *file = fopen(path, "rb");
+    struct ReplayHeader header;
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (fread(&header, sizeof(header), 1, file) != 1
+            || memcmp(header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0
+            || header.version != REPLAY_VERSION) {
+        fclose(file);
+        return NULL;
+    }
+
+    size_t capacity = 1024;
+    size_t num_records = 0;
+    struct ReplayRecord *records = (struct ReplayRecord*) malloc(capacity *
+            sizeof(struct ReplayRecord));
+    size_t n;
+
+    while ((n = fread(records + num_records, sizeof(struct ReplayRecord),
+                    capacity - num_records, file)) > 0) {
+        num_records += n;
+
+        if (num_records == capacity) {
+            capacity *= 2;
+            records = (struct ReplayRecord*) realloc(records, capacity *
+                    sizeof(struct ReplayRecord));
+        }
+    }
+
+    fclose(file);
+    qsort(records, num_records, sizeof(struct ReplayRecord), compare_records);
+
+    struct RoomIndex *index = new_room_index(world, 1);
+    struct ReplaySessions *sessions = (struct ReplaySessions*) calloc(1,
+            sizeof(struct ReplaySessions));
+    size_t i;
+    size_t j;
+
+    sessions->num_records = num_records;
+    sessions->sessions = (struct ReplaySession*) calloc(num_records + 1,
+            sizeof(struct ReplaySession));
+
+    for (i = 0; i < num_records; i = j) {
+        struct ReplaySession *session =
+            &sessions->sessions[sessions->num_sessions++];
+
+        for (j = i; j < num_records
+                && records[j].session_id == records[i].session_id; ++j) {
+        }
+
+        session->session_id = records[i].session_id;
+        session->num_steps = j - i;
+        session->rooms = (struct Room**) calloc(j - i, sizeof(struct Room*));
+        session->valid = true;
+
+        for (n = 0; n < j - i; ++n) {
+            const struct ReplayRecord *record = &records[i + n];
+
+            if (record->step != n || record->room_id >= index->size) {
+                session->valid = false;
+                continue;
+            }
+
+            session->rooms[n] = index->rooms[record->room_id];
+
+            if (n > 0 && (session->rooms[n - 1] == NULL
+                        || !has_connection(session->rooms[n - 1],
+                            session->rooms[n]))) {
+                session->valid = false;
+            }
+        }
+
+        sessions->num_invalid += !session->valid;
+    }
+
+    del_room_index(index);
+    free(records);
+
+    return sessions;
+}
+
+/*
+ * Deletes the given ReplaySessions. The Rooms they point to are left
+ * untouched.
+ */
+void del_replay_sessions(struct ReplaySessions *sessions) {
+    size_t i;
+
+    for (i = 0; i < sessions->num_sessions; ++i) {
+        free(sessions->sessions[i].rooms);
+    }
+
+    free(sessions->sessions);
+    free(sessions);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void replay_sessions_should_reconstruct_interleaved_sessions(CuTest *tc) {
+    // Given two sessions walking around a ring at the same time
+    char path[64];
+    struct RoomList *world = new_circulant_world(10, 2);
+    struct ReplayLogStats stats;
+    test_path(path, sizeof(path), "replay_log_test", ".log");
+    struct ReplayLog *log = open_replay_log(path, 0.001);
+
+    uint32_t step;
+    for (step = 0; step < 5; ++step) {
+        replay_log_append(log, 7, step, step);
+        replay_log_append(log, 3, step, (10 - step) % 10);
+    }
+
+    CuAssertIntEquals(tc, true, close_replay_log(log, &stats));
+
+    // When
+    struct ReplaySessions *sessions = replay_sessions(path, world);
+
+    // Then
+    CuAssertIntEquals(tc, 10, stats.records);
+    CuAssertIntEquals(tc, 10, sessions->num_records);
+    CuAssertIntEquals(tc, 2, sessions->num_sessions);
+    CuAssertIntEquals(tc, 0, sessions->num_invalid);
+    CuAssertTrue(tc, sessions->sessions[0].session_id == 3);
+    CuAssertIntEquals(tc, 5, sessions->sessions[0].num_steps);
+    CuAssertStrEquals(tc, "Room 9", sessions->sessions[0].rooms[1]->name);
+    CuAssertStrEquals(tc, "Room 4", sessions->sessions[1].rooms[4]->name);
+
+    // Clean up
+    del_replay_sessions(sessions);
+    del_world(world);
+    unlink(path);
+}
+
+void replay_log_append_should_commit_in_groups(CuTest *tc) {
+    // Given
+    char path[64];
+    struct ReplayLogStats stats;
+    test_path(path, sizeof(path), "replay_log_test", ".log");
+    struct ReplayLog *log = open_replay_log(path, 3600);
+    uint64_t sequence = 0;
+    uint32_t step;
+
+    // When an interval far longer than the test only commits on close
+    for (step = 0; step < 1000; ++step) {
+        sequence = replay_log_append(log, 1, step, 0);
+    }
+
+    CuAssertIntEquals(tc, true, close_replay_log(log, &stats));
+
+    // Then
+    CuAssertTrue(tc, sequence == 1000);
+    CuAssertIntEquals(tc, 1000, stats.records);
+    CuAssertIntEquals(tc, 1, stats.commits);
+
+    // Clean up
+    unlink(path);
+}
+
+void replay_log_wait_durable_should_return_after_commit(CuTest *tc) {
+    // Given
+    char path[64];
+    struct stat st;
+    test_path(path, sizeof(path), "replay_log_test", ".log");
+    struct ReplayLog *log = open_replay_log(path, 0.001);
+
+    // When
+    const bool durable = replay_log_wait_durable(log,
+            replay_log_append(log, 1, 0, 0));
+
+    // Then
+    stat(path, &st);
+    CuAssertIntEquals(tc, true, durable);
+    CuAssertIntEquals(tc, sizeof(struct ReplayHeader)
+            + sizeof(struct ReplayRecord), st.st_size);
+
+    // Clean up
+    close_replay_log(log, NULL);
+    unlink(path);
+}
+
+void replay_log_wait_durable_when_write_fails_should_return_false(CuTest *tc) {
+    // Given a log whose file can no longer be written to
+    char path[64];
+    struct ReplayLogStats stats;
+    struct stat st;
+    test_path(path, sizeof(path), "replay_log_test", ".log");
+    struct ReplayLog *log = open_replay_log(path, 0.001);
+
+    pthread_mutex_lock(&log->lock);
+    close(log->fd);
+    log->fd = open(path, O_RDONLY);
+    pthread_mutex_unlock(&log->lock);
+
+    // When
+    const bool first = replay_log_wait_durable(log,
+            replay_log_append(log, 1, 0, 0));
+    const bool second = replay_log_wait_durable(log,
+            replay_log_append(log, 1, 1, 0));
+
+    // Then
+    CuAssertIntEquals(tc, false, first);
+    CuAssertIntEquals(tc, false, second);
+    CuAssertIntEquals(tc, false, close_replay_log(log, &stats));
+    CuAssertIntEquals(tc, 0, stats.records);
+    stat(path, &st);
+    CuAssertIntEquals(tc, sizeof(struct ReplayHeader), st.st_size);
+
+    // Clean up
+    unlink(path);
+}
+
+void open_replay_log_when_tail_torn_should_drop_partial_record(CuTest *tc) {
+    // Given a log whose last record was only partly written
+    char path[64];
+    struct RoomList *world = new_circulant_world(10, 2);
+    test_path(path, sizeof(path), "replay_log_test", ".log");
+    struct ReplayLog *log = open_replay_log(path, 0.001);
+    replay_log_append(log, 1, 0, 0);
+    close_replay_log(log, NULL);
+
+    FILE *file = fopen(path, "ab");
+    fwrite("torn", 1, 4, file);
+    fclose(file);
+
+    // When
+    log = open_replay_log(path, 0.001);
+    replay_log_append(log, 1, 1, 1);
+    close_replay_log(log, NULL);
+    struct ReplaySessions *sessions = replay_sessions(path, world);
+
+    // Then
+    CuAssertIntEquals(tc, 2, sessions->num_records);
+    CuAssertIntEquals(tc, 1, sessions->num_sessions);
+    CuAssertIntEquals(tc, 0, sessions->num_invalid);
+
+    // Clean up
+    del_replay_sessions(sessions);
+    del_world(world);
+    unlink(path);
+}
+
+void replay_sessions_when_move_not_a_connection_should_be_invalid(CuTest *tc) {
+    // Given
+    char path[64];
+    struct RoomList *world = new_circulant_world(10, 2);
+    test_path(path, sizeof(path), "replay_log_test", ".log");
+    struct ReplayLog *log = open_replay_log(path, 0.001);
+    replay_log_append(log, 1, 0, 0);
+    replay_log_append(log, 1, 1, 5);
+    replay_log_append(log, 2, 0, 0);
+    replay_log_append(log, 2, 2, 1);
+    close_replay_log(log, NULL);
+
+    // When
+    struct ReplaySessions *sessions = replay_sessions(path, world);
+
+    // Then
+    CuAssertIntEquals(tc, 2, sessions->num_sessions);
+    CuAssertIntEquals(tc, 2, sessions->num_invalid);
+
+    // Clean up
+    del_replay_sessions(sessions);
+    del_world(world);
+    unlink(path);
+}
+
+CuSuite *get_replay_log_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, replay_sessions_should_reconstruct_interleaved_sessions);
+    SUITE_ADD_TEST(suite, replay_log_append_should_commit_in_groups);
+    SUITE_ADD_TEST(suite, replay_log_wait_durable_should_return_after_commit);
+    SUITE_ADD_TEST(suite, replay_log_wait_durable_when_write_fails_should_return_false);
+    SUITE_ADD_TEST(suite, open_replay_log_when_tail_torn_should_drop_partial_record);
+    SUITE_ADD_TEST(suite, replay_sessions_when_move_not_a_connection_should_be_invalid);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * The state of one benchmark thread playing many sessions.
+ */
+struct ReplayBenchmarkTask {
+    struct ReplayLog *log;
+    const struct RoomIndex *index;
+    size_t thread;
+    size_t moves;
+};
+
+static void *play_sessions(void *arg) {
+    struct ReplayBenchmarkTask *task = (struct ReplayBenchmarkTask*) arg;
+    const size_t num_sessions = 1000;
+    const struct RoomIndex *index = task->index;
+    size_t rooms[1000] = { 0 };
+    uint32_t steps[1000] = { 0 };
+    struct Xoshiro256 rng;
+    size_t i;
+
+    seed_xoshiro(&rng, task->thread);
+
+    for (i = 0; i < task->moves; ++i) {
+        const size_t session = xoshiro_below(&rng, num_sessions);
+        const size_t room = rooms[session];
+
+        if (steps[session] > 0) {
+            rooms[session] = index->neighbors[index->offsets[room]
+                + xoshiro_below(&rng, index->offsets[room + 1]
+                        - index->offsets[room])];
+        }
+
+        replay_log_append(task->log, task->thread * num_sessions + session,
+                steps[session]++, (uint32_t) rooms[session]);
+    }
+
+    return NULL;
+}
+
+void run_replay_log_benchmark() {
+    const char *path = "/tmp/replay_log_benchmark.log";
+    const size_t num_threads = 4;
+    const size_t moves_per_thread = 1000000;
+    struct RoomList *world = new_circulant_world(10000, 6);
+    struct RoomIndex *index = new_room_index(world, 0);
+    struct ReplayBenchmarkTask tasks[4];
+    pthread_t threads[4];
+    struct ReplayLogStats stats;
+    double interval;
+    size_t i;
+
+    for (interval = 0.001; interval <= 0.1; interval *= 10) {
+        unlink(path);
+        struct ReplayLog *log = open_replay_log(path, interval);
+        const double start = now_seconds();
+
+        for (i = 0; i < num_threads; ++i) {
+            tasks[i].log = log;
+            tasks[i].index = index;
+            tasks[i].thread = i;
+            tasks[i].moves = moves_per_thread;
+            pthread_create(&threads[i], NULL, play_sessions, &tasks[i]);
+        }
+
+        for (i = 0; i < num_threads; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+
+        close_replay_log(log, &stats);
+        const double seconds = now_seconds() - start;
+
+        printf("replay_log: interval %.0f ms: %.0f records/s in %zu commits, "
+                "durability window mean %.2f ms, max %.2f ms\n",
+                interval * 1e3, stats.records / seconds, stats.commits,
+                stats.mean_durability_ms, stats.max_durability_ms);
+    }
+
+    const double start = now_seconds();
+    struct ReplaySessions *sessions = replay_sessions(path, world);
+
+    printf("replay_log: replayed %zu records of %zu sessions in %.3f s "
+            "(%zu invalid)\n", sessions->num_records, sessions->num_sessions,
+            now_seconds() - start, sessions->num_invalid);
+
+    del_replay_sessions(sessions);
+    del_room_index(index);
+    del_world(world);
+    unlink(path);
+}
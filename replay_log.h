@@ -0,0 +1,75 @@
+#ifndef REPLAY_LOG_H
+#define REPLAY_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "room.h"
+#include "room_list.h"
+
+/*
+ * A replay log is an append-only binary file of the moves of every session.
+ * Appends from any number of threads are buffered in memory and a background
+ * writer commits them as a group with one write and one fdatasync per
+ * interval, so durability costs one sync per interval rather than per move.
+ * Room ids are positions in the RoomList of the world being played.
+ */
+
+/*
+ * A single move as stored in the log, in host byte order.
+ */
+struct ReplayRecord {
+    uint64_t session_id;
+    uint32_t step;
+    uint32_t room_id;
+    uint64_t timestamp_ns;
+};
+
+/*
+ * A structure that stores the counters of a ReplayLog. The durability window
+ * of a record is the time from its append until the sync that covered it.
+ */
+struct ReplayLogStats {
+    size_t records;
+    size_t commits;
+    double mean_durability_ms;
+    double max_durability_ms;
+};
+
+/*
+ * A structure that stores a session reconstructed from a log. The session is
+ * valid if its steps are numbered 0, 1, 2, ... and every room after the first
+ * is a connection of the room before it.
+ */
+struct ReplaySession {
+    uint64_t session_id;
+    size_t num_steps;
+    struct Room **rooms;
+    bool valid;
+};
+
+/*
+ * A structure that stores every session of a log, ordered by session id.
+ */
+struct ReplaySessions {
+    size_t num_records;
+    size_t num_sessions;
+    size_t num_invalid;
+    struct ReplaySession *sessions;
+};
+
+struct ReplayLog *open_replay_log(const char *path,
+        const double interval_seconds);
+
+uint64_t replay_log_append(struct ReplayLog *log, const uint64_t session_id,
+        const uint32_t step, const uint32_t room_id);
+
+bool replay_log_wait_durable(struct ReplayLog *log, const uint64_t sequence);
+
+bool close_replay_log(struct ReplayLog *log, struct ReplayLogStats *stats);
+
+struct ReplaySessions *replay_sessions(const char *path,
+        const struct RoomList *world);
+
+void del_replay_sessions(struct ReplaySessions *sessions);
+
+#endif
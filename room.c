@@ -1,10 +1,35 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "room.h"
+#include "room_index.h"
+#include "world.h"
 #include "CuTest.h"
 
-const size_t MAX_CONNECTIONS = 6;
+const size_t MAX_CONNECTIONS = ROOM_MAX_CONNECTIONS;
+
+/*
+ * Rooms with more connections than this index them in a hash table rather than
+ * a sorted array. A hash table only goes back to a sorted array once the room
+ * is down to half of this, so that a room hovering around the threshold does
+ * not rebuild its index on every change.
+ */
+#define ROOM_SORTED_CONNECTIONS 64
+
+/*
+ * Sets up the connections of a new Room: none yet, room for
+ * ROOM_MAX_CONNECTIONS inside the struct and nothing to index.
+ */
+static void init_connections(struct Room *room) {
+    room->num_connections = 0;
+    room->max_connections = MAX_CONNECTIONS;
+    room->capacity = ROOM_MAX_CONNECTIONS;
+    room->connections = room->inline_connections;
+    room->lookup_type = CONNECTIONS_SCANNED;
+    room->lookup_capacity = 0;
+    room->lookup = NULL;
+}
 
 /*
  * Constructs a new Room structure with the given name and type.
@@ -16,22 +41,55 @@ struct Room *new_room(const char *name, const room_t type) {
     // Copy the provided name and type into the struct
     room->name = new_str_from(name);
     room->type = type;
+    room->owns_name = true;
+    room->dirty = true;
 
-    // Since there is a maximum number of outgoing connections from a room go
-    // and create an array of pointers to Room structs of size MAX_CONNECTIONS.
-    room->num_connections = 0;
-    room->connections = (struct Room**) malloc(MAX_CONNECTIONS *
-            sizeof(struct Room*));
+    // Ordinary rooms keep their connections in the array inside the struct,
+    // which saves an allocation and a pointer chase
+    init_connections(room);
 
     return room;
 }
 
+/*
+ * Constructs a new Room structure with the given type that refers to a name
+ * with static storage duration, such as a room catalog entry, instead of
+ * copying it.
+ */
+struct Room *new_static_room(const char *name, const room_t type) {
+    struct Room *room = (struct Room*) malloc(sizeof(struct Room));
+
+    init_room(room, name, type);
+
+    return room;
+}
+
+/*
+ * Sets up a Room in memory owned by the caller, such as an arena, that refers
+ * to the given name instead of copying it. Such a Room is never passed to
+ * del_room; as long as it is not made a hub it owns no memory of its own.
+ */
+void init_room(struct Room *room, const char *name, const room_t type) {
+    room->name = (char*) name;
+    room->type = type;
+    room->owns_name = false;
+    room->dirty = true;
+    init_connections(room);
+}
+
 /*
  * Deletes the given Room structure.
  */
 void del_room(struct Room *room) {
-    free(room->name);
-    free(room->connections);
+    if (room->owns_name) {
+        free(room->name);
+    }
+
+    if (room->connections != room->inline_connections) {
+        free(room->connections);
+    }
+
+    free(room->lookup);
     free(room);
 }
 
@@ -39,36 +97,297 @@ void del_room(struct Room *room) {
  * Prints the given Room structure.
  */
 void print_room(const struct Room *room) {
-    printf("ROOM NAME: %s\n", room->name);
+    fprint_room(stdout, room);
+}
+
+/*
+ * Prints the given Room structure to the given stream. Hubs also print their
+ * maximum number of connections, so that reading them back keeps them hubs.
+ */
+void fprint_room(FILE *out, const struct Room *room) {
+    fprintf(out, "ROOM NAME: %s\n", room->name);
 
     size_t i;
 
+    if (room->max_connections > MAX_CONNECTIONS) {
+        fprintf(out, "MAX CONNECTIONS: %zu\n", room->max_connections);
+    }
+
     for (i = 0; i < room->num_connections; ++i) {
-        printf("CONNECTION %zu: %s\n", i + 1, room->connections[i]->name);
+        fprintf(out, "CONNECTION %zu: %s\n", i + 1,
+                room->connections[i]->name);
     }
 
     switch (room->type) {
         case START_ROOM:
-            printf("ROOM TYPE: START_ROOM\n");
+            fprintf(out, "ROOM TYPE: START_ROOM\n");
             break;
         case MID_ROOM:
-            printf("ROOM TYPE: MID_ROOM\n");
+            fprintf(out, "ROOM TYPE: MID_ROOM\n");
             break;
         case END_ROOM:
-            printf("ROOM TYPE: END_ROOM\n");
+            fprintf(out, "ROOM TYPE: END_ROOM\n");
             break;
         default:
-            printf("ROOM TYPE: UNKNOWN\n");
+            fprintf(out, "ROOM TYPE: UNKNOWN\n");
             break;
     }
 }
 
+/*
+ * Changes how many connections the given Room may have, which makes it a hub
+ * if the new maximum is above MAX_CONNECTIONS. Fails if the room already has
+ * more connections than that. The room is dirty if its maximum changed, since
+ * a hub's maximum is saved with it.
+ */
+bool set_max_connections(struct Room *room, const size_t max_connections) {
+    if (max_connections < room->num_connections) {
+        return false;
+    }
+
+    room->dirty = room->dirty || room->max_connections != max_connections;
+    room->max_connections = max_connections;
+
+    return true;
+}
+
 /*
  * Returns whether or not the given Room structure has any connections
  * available.
  */
 bool has_connection_available(const struct Room *room) {
-    return room->num_connections < MAX_CONNECTIONS;
+    return room->num_connections < room->max_connections;
+}
+
+static size_t hash_name(const char *name) {
+    uint64_t h = 14695981039346656037ULL;
+
+    while (*name != '\0') {
+        h = (h ^ (uint8_t) *name++) * 1099511628211ULL;
+    }
+
+    return (size_t) (h ^ (h >> 29));
+}
+
+/*
+ * Returns the first entry of the sorted lookup, among its first n, whose
+ * connection's name is not less than name.
+ */
+static size_t lower_bound(const struct Room *room, const char *name,
+        const size_t n) {
+    size_t low = 0;
+    size_t high = n;
+
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+
+        if (strcmp(room->connections[room->lookup[middle]]->name, name) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/*
+ * Returns the entry of the sorted lookup that holds the given position.
+ */
+static size_t sorted_entry(const struct Room *room, const size_t position) {
+    size_t k = lower_bound(room, room->connections[position]->name,
+            room->num_connections);
+
+    while (room->lookup[k] != position) {
+        ++k;
+    }
+
+    return k;
+}
+
+/*
+ * Returns the slot of the hash table that holds the given position.
+ */
+static size_t hashed_slot(const struct Room *room, const size_t position) {
+    const size_t mask = room->lookup_capacity - 1;
+    size_t slot = hash_name(room->connections[position]->name) & mask;
+
+    while (room->lookup[slot] != position + 1) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+static void insert_hashed(struct Room *room, const size_t position) {
+    const size_t mask = room->lookup_capacity - 1;
+    size_t slot = hash_name(room->connections[position]->name) & mask;
+
+    while (room->lookup[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+
+    room->lookup[slot] = (uint32_t) position + 1;
+}
+
+/*
+ * Empties a slot of the hash table and shifts the entries after it back so
+ * that every entry stays reachable from its home slot.
+ */
+static void delete_hashed(struct Room *room, size_t slot) {
+    const size_t mask = room->lookup_capacity - 1;
+    size_t next = (slot + 1) & mask;
+
+    while (room->lookup[next] != 0) {
+        const size_t home = hash_name(
+                room->connections[room->lookup[next] - 1]->name) & mask;
+
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            room->lookup[slot] = room->lookup[next];
+            slot = next;
+        }
+
+        next = (next + 1) & mask;
+    }
+
+    room->lookup[slot] = 0;
+}
+
+/*
+ * Indexes every connection of the given Room in a sorted array.
+ */
+static void build_sorted_lookup(struct Room *room) {
+    size_t i;
+    size_t k;
+
+    room->lookup_capacity = ROOM_SORTED_CONNECTIONS + 1;
+    room->lookup = (uint32_t*) realloc(room->lookup, room->lookup_capacity *
+            sizeof(uint32_t));
+    room->lookup_type = CONNECTIONS_SORTED;
+
+    for (i = 0; i < room->num_connections; ++i) {
+        k = lower_bound(room, room->connections[i]->name, i);
+        memmove(room->lookup + k + 1, room->lookup + k,
+                (i - k) * sizeof(uint32_t));
+        room->lookup[k] = (uint32_t) i;
+    }
+}
+
+/*
+ * Indexes every connection of the given Room in a hash table that stays at
+ * most half full until the room doubles in degree.
+ */
+static void build_hashed_lookup(struct Room *room) {
+    size_t i;
+
+    room->lookup_capacity = 16;
+
+    while (room->lookup_capacity < 4 * room->num_connections) {
+        room->lookup_capacity *= 2;
+    }
+
+    free(room->lookup);
+    room->lookup = (uint32_t*) calloc(room->lookup_capacity, sizeof(uint32_t));
+    room->lookup_type = CONNECTIONS_HASHED;
+
+    for (i = 0; i < room->num_connections; ++i) {
+        insert_hashed(room, i);
+    }
+}
+
+/*
+ * Adds other to the end of the connections of room and to its index,
+ * growing either as needed.
+ */
+static void append_connection(struct Room *room, struct Room *other) {
+    const size_t position = room->num_connections;
+
+    if (position == room->capacity) {
+        room->capacity *= 2;
+
+        if (room->connections == room->inline_connections) {
+            room->connections = (struct Room**) malloc(room->capacity *
+                    sizeof(struct Room*));
+            memcpy(room->connections, room->inline_connections,
+                    sizeof(room->inline_connections));
+        } else {
+            room->connections = (struct Room**) realloc(room->connections,
+                    room->capacity * sizeof(struct Room*));
+        }
+    }
+
+    room->connections[room->num_connections++] = other;
+    room->dirty = true;
+
+    if (room->lookup_type == CONNECTIONS_SCANNED) {
+        if (room->num_connections > ROOM_MAX_CONNECTIONS) {
+            build_sorted_lookup(room);
+        }
+    } else if (room->lookup_type == CONNECTIONS_SORTED) {
+        if (room->num_connections > ROOM_SORTED_CONNECTIONS) {
+            build_hashed_lookup(room);
+        } else {
+            const size_t k = lower_bound(room, other->name, position);
+
+            memmove(room->lookup + k + 1, room->lookup + k,
+                    (position - k) * sizeof(uint32_t));
+            room->lookup[k] = (uint32_t) position;
+        }
+    } else if (2 * room->num_connections > room->lookup_capacity) {
+        build_hashed_lookup(room);
+    } else {
+        insert_hashed(room, position);
+    }
+}
+
+/*
+ * Returns the position of other among the connections of room, or
+ * num_connections if it is not one of them.
+ */
+static size_t connection_position(const struct Room *room,
+        const struct Room *other) {
+    size_t i;
+
+    if (room->lookup_type == CONNECTIONS_SORTED) {
+        for (i = lower_bound(room, other->name, room->num_connections);
+                i < room->num_connections; ++i) {
+            const struct Room *candidate = room->connections[room->lookup[i]];
+
+            if (candidate == other) {
+                return room->lookup[i];
+            } else if (strcmp(candidate->name, other->name) != 0) {
+                break;
+            }
+        }
+
+        return room->num_connections;
+    } else if (room->lookup_type == CONNECTIONS_HASHED) {
+        const size_t mask = room->lookup_capacity - 1;
+
+        for (i = hash_name(other->name) & mask; room->lookup[i] != 0;
+                i = (i + 1) & mask) {
+            if (room->connections[room->lookup[i] - 1] == other) {
+                return room->lookup[i] - 1;
+            }
+        }
+
+        return room->num_connections;
+    }
+
+    for (i = 0; i < room->num_connections; ++i) {
+        if (room->connections[i] == other) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/*
+ * Returns whether other is one of the connections of the given Room.
+ */
+bool has_connection(const struct Room *room, const struct Room *other) {
+    return connection_position(room, other) < room->num_connections;
 }
 
 /*
@@ -82,11 +401,8 @@ bool add_connection(struct Room *room1, struct Room *room2) {
         return false;
     } else if (has_connection_available(room1) && has_connection_available(room2)) {
         // If both rooms have connections available then connect them
-        size_t last_index = room1->num_connections++;
-        room1->connections[last_index] = room2;
-
-        last_index = room2->num_connections++;
-        room2->connections[last_index] = room1;
+        append_connection(room1, room2);
+        append_connection(room2, room1);
 
         return true;
     } else {
@@ -95,6 +411,98 @@ bool add_connection(struct Room *room1, struct Room *room2) {
     }
 }
 
+/*
+ * Removes one occurrence of other from the connections of room by moving the
+ * last connection into its place, keeping the index in step. Returns whether
+ * other was found.
+ */
+static bool remove_one_side(struct Room *room, const struct Room *other) {
+    const size_t i = connection_position(room, other);
+    const size_t last = room->num_connections - 1;
+
+    if (i == room->num_connections) {
+        return false;
+    }
+
+    // Drop the entry of position i and point the entry of the last position
+    // at i, where the last connection moves to
+    if (room->lookup_type == CONNECTIONS_SORTED) {
+        const size_t k = sorted_entry(room, i);
+
+        memmove(room->lookup + k, room->lookup + k + 1,
+                (last - k) * sizeof(uint32_t));
+        room->num_connections--;
+
+        if (i != last) {
+            room->lookup[sorted_entry(room, last)] = (uint32_t) i;
+        }
+    } else if (room->lookup_type == CONNECTIONS_HASHED) {
+        delete_hashed(room, hashed_slot(room, i));
+
+        if (i != last) {
+            room->lookup[hashed_slot(room, last)] = (uint32_t) i + 1;
+        }
+
+        room->num_connections--;
+    } else {
+        room->num_connections--;
+    }
+
+    room->connections[i] = room->connections[last];
+    room->dirty = true;
+
+    if (room->lookup_type == CONNECTIONS_HASHED
+            && room->num_connections <= ROOM_SORTED_CONNECTIONS / 2) {
+        build_sorted_lookup(room);
+    } else if (room->lookup_type == CONNECTIONS_SORTED
+            && room->num_connections <= ROOM_MAX_CONNECTIONS) {
+        room->lookup_type = CONNECTIONS_SCANNED;
+    }
+
+    return true;
+}
+
+/*
+ * Tries to remove the connection between two Room structures in O(degree)
+ * time, or O(log degree) and O(1) for rooms with sorted and hashed lookups.
+ * Note that the order of the remaining connections of both rooms may change.
+ * If the connection was removed then true is returned. Otherwise, false is
+ * returned.
+ */
+bool remove_connection(struct Room *room1, struct Room *room2) {
+    if (room1 == room2 || !remove_one_side(room1, room2)) {
+        return false;
+    }
+
+    remove_one_side(room2, room1);
+
+    return true;
+}
+
+/*
+ * Removes every connection of the given Room, from both ends.
+ */
+void remove_all_connections(struct Room *room) {
+    while (room->num_connections > 0) {
+        struct Room *other = room->connections[room->num_connections - 1];
+
+        remove_one_side(room, other);
+
+        if (other != room) {
+            remove_one_side(other, room);
+        }
+    }
+}
+
+/*
+ * Deletes the given Room after removing it from the connections of its
+ * neighbours, so that none of them is left pointing at freed memory.
+ */
+void del_connected_room(struct Room *room) {
+    remove_all_connections(room);
+    del_room(room);
+}
+
 /*
  * Finds the connection of a given room by name. If the connection cannot bei
  * found NULL is returned.
@@ -102,6 +510,31 @@ bool add_connection(struct Room *room1, struct Room *room2) {
 struct Room *find_connection(const struct Room *room, const char *name) {
     int i = 0;
 
+    if (room->lookup_type == CONNECTIONS_SORTED) {
+        const size_t k = lower_bound(room, name, room->num_connections);
+
+        if (k < room->num_connections
+                && strcmp(name, room->connections[room->lookup[k]]->name) == 0) {
+            return room->connections[room->lookup[k]];
+        }
+
+        return NULL;
+    } else if (room->lookup_type == CONNECTIONS_HASHED) {
+        const size_t mask = room->lookup_capacity - 1;
+        size_t slot;
+
+        for (slot = hash_name(name) & mask; room->lookup[slot] != 0;
+                slot = (slot + 1) & mask) {
+            struct Room *other = room->connections[room->lookup[slot] - 1];
+
+            if (strcmp(name, other->name) == 0) {
+                return other;
+            }
+        }
+
+        return NULL;
+    }
+
     for (i = 0; i < room->num_connections; ++i) {
         if (strcmp(name, room->connections[i]->name) == 0) {
             return room->connections[i];
@@ -111,6 +544,77 @@ struct Room *find_connection(const struct Room *room, const char *name) {
     return NULL;
 }
 
+/*
+ * How many queries ahead find_connections starts prefetching. Each query
+ * chases four dependent pointers (room, connections array, neighbour rooms and
+ * neighbour names) so each level is prefetched one stage closer to its use.
+ */
+#define FIND_PREFETCH_DISTANCE 4
+
+/*
+ * Issues the prefetches for the given level of the query at index i.
+ */
+static void prefetch_query(const struct Room *const *rooms, const size_t i,
+        const int level) {
+    const struct Room *room = rooms[i];
+    size_t j;
+
+    switch (level) {
+        case 0:
+            __builtin_prefetch(room);
+            break;
+        case 1:
+            __builtin_prefetch(room->connections);
+            break;
+        case 2:
+            // Hubs look their connections up instead of scanning them all
+            if (room->lookup_type != CONNECTIONS_SCANNED) {
+                break;
+            }
+
+            for (j = 0; j < room->num_connections; ++j) {
+                __builtin_prefetch(room->connections[j]);
+            }
+            break;
+        default:
+            if (room->lookup_type != CONNECTIONS_SCANNED) {
+                break;
+            }
+
+            for (j = 0; j < room->num_connections; ++j) {
+                __builtin_prefetch(room->connections[j]->name);
+            }
+            break;
+    }
+}
+
+/*
+ * Resolves a batch of queries at once: results[i] is set to
+ * find_connection(rooms[i], names[i]). Lookups are interleaved with prefetches
+ * for the queries after them so that the cache misses of many queries overlap
+ * instead of stalling one at a time.
+ */
+void find_connections(const struct Room *const *rooms,
+        const char *const *names, struct Room **results, const size_t n) {
+    const size_t d = FIND_PREFETCH_DISTANCE;
+    size_t i;
+    int level;
+
+    for (i = 0; i < n; ++i) {
+        // The room of query i + 4d is prefetched, the connections array of
+        // i + 3d, the neighbours of i + 2d and the neighbour names of i + d
+        for (level = 0; level < 4; ++level) {
+            const size_t ahead = i + (4 - level) * d;
+
+            if (ahead < n) {
+                prefetch_query(rooms, ahead, level);
+            }
+        }
+
+        results[i] = find_connection(rooms[i], names[i]);
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Unit tests
 ////////////////////////////////////////////////////////////////////////////////
@@ -134,6 +638,24 @@ void new_room_should_create_new_room(CuTest *tc) {
     del_room(room);
 }
 
+void new_static_room_should_not_copy_name(CuTest *tc) {
+    // Given
+    static const char name[] = "Eastern Palace";
+    const room_t type = START_ROOM;
+
+    // When
+    struct Room *room = new_static_room(name, type);
+
+    // Then
+    CuAssertPtrEquals(tc, (void*) name, room->name);
+    CuAssertIntEquals(tc, type, room->type);
+    CuAssertIntEquals(tc, false, room->owns_name);
+    CuAssertIntEquals(tc, 0, room->num_connections);
+
+    // Clean up
+    del_room(room);
+}
+
 void has_connection_available_when_num_connections_less_than_max_should_return_true(CuTest *tc) {
     // Given
     const char *name = "name";
@@ -318,10 +840,218 @@ void find_connection_when_connection_exists_should_return_connection(CuTest *tc)
     del_room(room2);
 }
 
+void find_connections_should_resolve_every_query(CuTest *tc) {
+    // Given
+    struct Room *rooms[3];
+    const struct Room *queries[100];
+    const char *names[100];
+    struct Room *results[100];
+    size_t i;
+
+    rooms[0] = new_room("name1", START_ROOM);
+    rooms[1] = new_room("name2", MID_ROOM);
+    rooms[2] = new_room("name3", END_ROOM);
+    add_connection(rooms[0], rooms[1]);
+    add_connection(rooms[1], rooms[2]);
+
+    for (i = 0; i < 100; ++i) {
+        queries[i] = rooms[i % 3];
+        names[i] = rooms[(i / 3) % 3]->name;
+    }
+
+    // When
+    find_connections(queries, names, results, 100);
+
+    // Then
+    for (i = 0; i < 100; ++i) {
+        CuAssertPtrEquals(tc, find_connection(queries[i], names[i]), results[i]);
+    }
+
+    CuAssertPtrEquals(tc, rooms[1], results[3]);
+    CuAssertPtrEquals(tc, NULL, results[0]);
+
+    // Clean up
+    del_room(rooms[0]);
+    del_room(rooms[1]);
+    del_room(rooms[2]);
+}
+
+void remove_connection_when_connected_should_remove_from_both_rooms(CuTest *tc) {
+    // Given
+    struct Room *room1 = new_room("name1", START_ROOM);
+    struct Room *room2 = new_room("name2", MID_ROOM);
+    struct Room *room3 = new_room("name3", END_ROOM);
+    add_connection(room1, room2);
+    add_connection(room1, room3);
+
+    // When
+    const bool actual = remove_connection(room2, room1);
+
+    // Then
+    CuAssertIntEquals(tc, true, actual);
+    CuAssertIntEquals(tc, 1, room1->num_connections);
+    CuAssertIntEquals(tc, 0, room2->num_connections);
+    CuAssertPtrEquals(tc, room3, room1->connections[0]);
+
+    // Clean up
+    del_room(room1);
+    del_room(room2);
+    del_room(room3);
+}
+
+void remove_connection_when_not_connected_should_not_remove(CuTest *tc) {
+    // Given
+    struct Room *room1 = new_room("name1", START_ROOM);
+    struct Room *room2 = new_room("name2", MID_ROOM);
+    struct Room *room3 = new_room("name3", END_ROOM);
+    add_connection(room1, room2);
+
+    // When
+    const bool actual = remove_connection(room1, room3);
+
+    // Then
+    CuAssertIntEquals(tc, false, actual);
+    CuAssertIntEquals(tc, 1, room1->num_connections);
+    CuAssertIntEquals(tc, false, remove_connection(room1, room1));
+
+    // Clean up
+    del_room(room1);
+    del_room(room2);
+    del_room(room3);
+}
+
+void add_and_remove_connection_should_mark_only_changed_rooms_dirty(CuTest *tc) {
+    // Given
+    struct Room *room1 = new_room("name1", START_ROOM);
+    struct Room *room2 = new_room("name2", MID_ROOM);
+    struct Room *room3 = new_room("name3", END_ROOM);
+    CuAssertIntEquals(tc, true, room1->dirty);
+    add_connection(room1, room2);
+    add_connection(room1, room3);
+    room1->dirty = false;
+    room2->dirty = false;
+    room3->dirty = false;
+
+    // When
+    remove_connection(room1, room2);
+
+    // Then
+    CuAssertIntEquals(tc, true, room1->dirty);
+    CuAssertIntEquals(tc, true, room2->dirty);
+    CuAssertIntEquals(tc, false, room3->dirty);
+
+    // Clean up
+    del_room(room1);
+    del_room(room2);
+    del_room(room3);
+}
+
+void set_max_connections_when_below_degree_should_fail(CuTest *tc) {
+    // Given
+    struct Room *room1 = new_room("name1", START_ROOM);
+    struct Room *room2 = new_room("name2", END_ROOM);
+    add_connection(room1, room2);
+
+    // When
+    const bool actual = set_max_connections(room1, 0);
+
+    // Then
+    CuAssertIntEquals(tc, false, actual);
+    CuAssertIntEquals(tc, true, set_max_connections(room1, 1));
+    CuAssertIntEquals(tc, false, has_connection_available(room1));
+
+    // Clean up
+    del_connected_room(room1);
+    del_room(room2);
+}
+
+void hub_room_should_find_connections_as_it_grows_and_shrinks(CuTest *tc) {
+    // Given
+    struct Room *hub = new_room("hub", MID_ROOM);
+    struct Room *rooms[300];
+    char name[32];
+    size_t i;
+    size_t j;
+
+    set_max_connections(hub, 300);
+
+    for (i = 0; i < 300; ++i) {
+        snprintf(name, sizeof(name), "name%zu", i);
+        rooms[i] = new_room(name, MID_ROOM);
+    }
+
+    // When
+    for (i = 0; i < 300; ++i) {
+        CuAssertIntEquals(tc, true, add_connection(hub, rooms[i]));
+
+        // Then
+        CuAssertPtrEquals(tc, rooms[i], find_connection(hub, rooms[i]->name));
+        CuAssertPtrEquals(tc, rooms[i / 2], find_connection(hub,
+                    rooms[i / 2]->name));
+        CuAssertPtrEquals(tc, NULL, find_connection(hub, "missing"));
+    }
+
+    CuAssertIntEquals(tc, CONNECTIONS_HASHED, hub->lookup_type);
+    CuAssertIntEquals(tc, false, has_connection_available(hub));
+
+    // When removing them again in a scrambled order
+    for (i = 0; i < 300; ++i) {
+        struct Room *removed = rooms[i * 7 % 300];
+
+        CuAssertIntEquals(tc, true, remove_connection(removed, hub));
+
+        // Then
+        CuAssertPtrEquals(tc, NULL, find_connection(hub, removed->name));
+        CuAssertIntEquals(tc, false, has_connection(hub, removed));
+
+        for (j = 0; j < hub->num_connections; ++j) {
+            CuAssertPtrEquals(tc, hub->connections[j], find_connection(hub,
+                        hub->connections[j]->name));
+        }
+
+        if (hub->num_connections == 20) {
+            CuAssertIntEquals(tc, CONNECTIONS_SORTED, hub->lookup_type);
+        }
+    }
+
+    CuAssertIntEquals(tc, CONNECTIONS_SCANNED, hub->lookup_type);
+
+    // Clean up
+    for (i = 0; i < 300; ++i) {
+        del_room(rooms[i]);
+    }
+
+    del_room(hub);
+}
+
+void del_connected_room_should_unlink_neighbours(CuTest *tc) {
+    // Given
+    struct Room *hub = new_room("hub", MID_ROOM);
+    struct Room *room1 = new_room("name1", START_ROOM);
+    struct Room *room2 = new_room("name2", END_ROOM);
+    add_connection(room1, room2);
+    add_connection(hub, room1);
+    add_connection(hub, room2);
+
+    // When
+    del_connected_room(hub);
+
+    // Then
+    CuAssertIntEquals(tc, 1, room1->num_connections);
+    CuAssertIntEquals(tc, 1, room2->num_connections);
+    CuAssertPtrEquals(tc, room2, room1->connections[0]);
+    CuAssertPtrEquals(tc, room1, room2->connections[0]);
+
+    // Clean up
+    del_room(room1);
+    del_room(room2);
+}
+
 CuSuite *get_room_suite() {
     CuSuite *suite = CuSuiteNew();
 
     SUITE_ADD_TEST(suite, new_room_should_create_new_room);
+    SUITE_ADD_TEST(suite, new_static_room_should_not_copy_name);
     SUITE_ADD_TEST(suite, has_connection_available_when_num_connections_less_than_max_should_return_true);
     SUITE_ADD_TEST(suite, has_connection_available_when_num_connections_equals_max_should_return_false);
     SUITE_ADD_TEST(suite, has_connection_available_when_num_connections_greater_than_max_should_return_false);
@@ -331,6 +1061,253 @@ CuSuite *get_room_suite() {
     SUITE_ADD_TEST(suite, add_connection_when_room2_has_connections_but_room1_doesnt_should_not_add_connection);
     SUITE_ADD_TEST(suite, find_connection_when_connection_doesnt_exist_should_return_null);
     SUITE_ADD_TEST(suite, find_connection_when_connection_exists_should_return_connection);
+    SUITE_ADD_TEST(suite, find_connections_should_resolve_every_query);
+    SUITE_ADD_TEST(suite, remove_connection_when_connected_should_remove_from_both_rooms);
+    SUITE_ADD_TEST(suite, remove_connection_when_not_connected_should_not_remove);
+    SUITE_ADD_TEST(suite, add_and_remove_connection_should_mark_only_changed_rooms_dirty);
+    SUITE_ADD_TEST(suite, set_max_connections_when_below_degree_should_fail);
+    SUITE_ADD_TEST(suite, hub_room_should_find_connections_as_it_grows_and_shrinks);
+    SUITE_ADD_TEST(suite, del_connected_room_should_unlink_neighbours);
 
     return suite;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+void run_find_connections_benchmark() {
+    const size_t num_rooms = 2000000;
+    const size_t num_queries = 1000000;
+    const size_t batch_size = 256;
+    struct RoomList *world = new_circulant_world(num_rooms, 6);
+    struct RoomIndex *index = new_room_index(world, 0);
+    const struct Room **rooms = (const struct Room**) malloc(num_queries *
+            sizeof(struct Room*));
+    const char **names = (const char**) malloc(num_queries * sizeof(char*));
+    struct Room **results = (struct Room**) malloc(num_queries *
+            sizeof(struct Room*));
+    uint64_t rng = 42;
+    size_t found = 0;
+    size_t i;
+
+    // Queries from random rooms towards one of their neighbours
+    for (i = 0; i < num_queries; ++i) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        rooms[i] = index->rooms[(rng >> 20) % num_rooms];
+        names[i] = rooms[i]->connections[(rng >> 8) % 6]->name;
+    }
+
+    double start = now_seconds();
+
+    for (i = 0; i < num_queries; ++i) {
+        results[i] = find_connection(rooms[i], names[i]);
+        found += results[i] != NULL;
+    }
+
+    const double scalar_seconds = now_seconds() - start;
+    start = now_seconds();
+
+    for (i = 0; i < num_queries; i += batch_size) {
+        const size_t n = num_queries - i < batch_size ? num_queries - i
+            : batch_size;
+        find_connections(rooms + i, names + i, results + i, n);
+    }
+
+    const double batch_seconds = now_seconds() - start;
+
+    for (i = 0; i < num_queries; ++i) {
+        found += results[i] != NULL;
+    }
+
+    printf("find_connections: %zu rooms, scalar: %.1f M lookups/s\n",
+            num_rooms, num_queries / scalar_seconds / 1e6);
+    printf("find_connections: %zu rooms, batches of %zu: %.1f M lookups/s "
+            "(%zu found)\n", num_rooms, batch_size,
+            num_queries / batch_seconds / 1e6, found);
+
+    free(results);
+    free(names);
+    free(rooms);
+    del_room_index(index);
+    del_world(world);
+}
+
+void run_remove_connection_benchmark() {
+    const size_t num_rooms = 1000000;
+    const size_t num_edits = 10000000;
+    struct RoomList *world = new_circulant_world(num_rooms, 4);
+    struct RoomIndex *index = new_room_index(world, 0);
+    struct Xoshiro256 rng;
+    size_t removed = 0;
+    size_t i;
+
+    seed_xoshiro(&rng, 2016);
+
+    // Alternate between dropping a random edge and adding a random one, the
+    // way a generator undoes and retries connections
+    const double start = now_seconds();
+
+    for (i = 0; i < num_edits; ++i) {
+        struct Room *room = index->rooms[xoshiro_below(&rng, num_rooms)];
+
+        if (i % 2 == 0 && room->num_connections > 0) {
+            removed += remove_connection(room, room->connections[
+                    xoshiro_below(&rng, room->num_connections)]);
+        } else {
+            add_connection(room, index->rooms[xoshiro_below(&rng, num_rooms)]);
+        }
+    }
+
+    const double seconds = now_seconds() - start;
+
+    printf("remove_connection: %zu edits (%zu removals) in %.3f s: %.1f ns "
+            "per edit\n", num_edits, removed, seconds, seconds / num_edits * 1e9);
+
+    del_room_index(index);
+    del_world(world);
+}
+
+/*
+ * Looks a connection up by name the way every room did before hubs, scanning
+ * all of its connections.
+ */
+static struct Room *scan_connections(const struct Room *room, const char *name) {
+    size_t i;
+
+    for (i = 0; i < room->num_connections; ++i) {
+        if (strcmp(room->connections[i]->name, name) == 0) {
+            return room->connections[i];
+        }
+    }
+
+    return NULL;
+}
+
+void run_room_hub_benchmark() {
+    const size_t num_rooms = 100000;
+    const size_t max_degree = 4096;
+    const size_t num_queries = 2000000;
+    struct Room **rooms = (struct Room**) malloc(num_rooms *
+            sizeof(struct Room*));
+    size_t *stubs = NULL;
+    size_t num_stubs = 0;
+    size_t added = 0;
+    size_t found = 0;
+    struct Xoshiro256 rng;
+    char name[32];
+    size_t i;
+    size_t j;
+
+    seed_xoshiro(&rng, 40);
+
+    // Degrees follow a power law: a room has at least 2^k connections with
+    // probability 2^-k, so a few rooms end up with thousands of exits
+    for (i = 0; i < num_rooms; ++i) {
+        size_t degree = 2;
+        uint64_t coin = next_xoshiro(&rng);
+
+        while ((coin & 1) != 0 && degree < max_degree) {
+            degree *= 2;
+            coin >>= 1;
+        }
+
+        degree += xoshiro_below(&rng, degree);
+        snprintf(name, sizeof(name), "Room %zu", i);
+        rooms[i] = new_room(name, MID_ROOM);
+        set_max_connections(rooms[i], degree);
+
+        stubs = (size_t*) realloc(stubs, (num_stubs + degree) * sizeof(size_t));
+
+        for (j = 0; j < degree; ++j) {
+            stubs[num_stubs++] = i;
+        }
+    }
+
+    for (i = num_stubs - 1; i > 0; --i) {
+        j = xoshiro_below(&rng, i + 1);
+        const size_t stub = stubs[i];
+        stubs[i] = stubs[j];
+        stubs[j] = stub;
+    }
+
+    double start = now_seconds();
+
+    for (i = 0; i + 1 < num_stubs; i += 2) {
+        struct Room *room1 = rooms[stubs[i]];
+        struct Room *room2 = rooms[stubs[i + 1]];
+
+        if (!has_connection(room1, room2)) {
+            added += add_connection(room1, room2);
+        }
+    }
+
+    const double add_seconds = now_seconds() - start;
+    size_t max_seen = 0;
+
+    for (i = 0; i < num_rooms; ++i) {
+        if (rooms[i]->num_connections > max_seen) {
+            max_seen = rooms[i]->num_connections;
+        }
+    }
+
+    printf("room_hub: %zu rooms, %zu connections (max degree %zu) in %.3f s: "
+            "%.1f ns per add\n", num_rooms, added, max_seen, add_seconds,
+            add_seconds / added * 1e9);
+
+    // Queries start from the room of a random stub, so hubs are asked as often
+    // as their degree makes them visited
+    const struct Room **from = (const struct Room**) malloc(num_queries *
+            sizeof(struct Room*));
+    const char **hits = (const char**) malloc(num_queries * sizeof(char*));
+    const char **misses = (const char**) malloc(num_queries * sizeof(char*));
+
+    for (i = 0; i < num_queries; ++i) {
+        from[i] = rooms[stubs[xoshiro_below(&rng, num_stubs)]];
+
+        while (from[i]->num_connections == 0) {
+            from[i] = rooms[stubs[xoshiro_below(&rng, num_stubs)]];
+        }
+
+        hits[i] = from[i]->connections[xoshiro_below(&rng,
+                from[i]->num_connections)]->name;
+        misses[i] = rooms[xoshiro_below(&rng, num_rooms)]->name;
+    }
+
+    const char **queries[] = { hits, misses };
+    const char *labels[] = { "hits", "misses" };
+    size_t q;
+
+    for (q = 0; q < 2; ++q) {
+        start = now_seconds();
+
+        for (i = 0; i < num_queries; ++i) {
+            found += find_connection(from[i], queries[q][i]) != NULL;
+        }
+
+        const double adaptive_seconds = now_seconds() - start;
+        start = now_seconds();
+
+        for (i = 0; i < num_queries; ++i) {
+            found += scan_connections(from[i], queries[q][i]) != NULL;
+        }
+
+        const double scan_seconds = now_seconds() - start;
+
+        printf("room_hub: %s: adaptive %.1f ns, linear scan %.1f ns per "
+                "lookup\n", labels[q], adaptive_seconds / num_queries * 1e9,
+                scan_seconds / num_queries * 1e9);
+    }
+
+    printf("room_hub: %zu found\n", found);
+
+    for (i = 0; i < num_rooms; ++i) {
+        del_room(rooms[i]);
+    }
+
+    free(misses);
+    free(hits);
+    free(from);
+    free(stubs);
+    free(rooms);
+}
@@ -2,12 +2,19 @@
 #define ROOM_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include "utils.h"
 
 /*
- * The maximum number of rooms a single room can be connected to.
+ * The maximum number of rooms a single room can be connected to unless it is
+ * made a hub with set_max_connections. It is also the number of connections
+ * a room stores inline. The macro is for places that need a constant
+ * expression, such as array sizes.
  */
-extern const size_t MAX_CONNECTIONS; 
+#define ROOM_MAX_CONNECTIONS 6
+
+extern const size_t MAX_CONNECTIONS;
 
 /*
  * An enumeration for room types.
@@ -15,23 +22,71 @@ extern const size_t MAX_CONNECTIONS;
 typedef enum { START_ROOM, MID_ROOM, END_ROOM } room_t;
 
 /*
- * A structure that stores the data associated with a room.
+ * An enumeration for the ways a room finds its connections: by scanning them,
+ * by binary search in an array of their positions sorted by name, or through
+ * a hash table of their positions keyed by name.
+ */
+typedef enum {
+    CONNECTIONS_SCANNED,
+    CONNECTIONS_SORTED,
+    CONNECTIONS_HASHED
+} connection_lookup_t;
+
+/*
+ * A structure that stores the data associated with a room. The name is freed
+ * with the room unless it was borrowed from static storage. A room is dirty
+ * from when it is created or its connections change until it is saved; code
+ * that changes a room's fields directly must set dirty itself.
+ *
+ * connections[0 .. num_connections - 1] are the connected rooms. Up to
+ * ROOM_MAX_CONNECTIONS of them live in inline_connections; hubs move them to
+ * a growing array and index them for lookup by name as they get more,
+ * switching from scanning to a sorted index to a hash table.
  */
 struct Room {
     char *name;
     room_t type;
+    bool owns_name;
+    bool dirty;
     size_t num_connections;
+    size_t max_connections;
+    size_t capacity;
     struct Room **connections;
+    connection_lookup_t lookup_type;
+    size_t lookup_capacity;
+    uint32_t *lookup;
+    struct Room *inline_connections[ROOM_MAX_CONNECTIONS];
 };
 
 struct Room *new_room(const char *name, const room_t type);
 
+struct Room *new_static_room(const char *name, const room_t type);
+
+void init_room(struct Room *room, const char *name, const room_t type);
+
 void del_room(struct Room *room);
 
 void print_room(const struct Room *room);
 
+void fprint_room(FILE *out, const struct Room *room);
+
+bool set_max_connections(struct Room *room, const size_t max_connections);
+
 bool has_connection_available(const struct Room *room);
 
+bool has_connection(const struct Room *room, const struct Room *other);
+
 bool add_connection(struct Room *room1, struct Room *room2);
 
+bool remove_connection(struct Room *room1, struct Room *room2);
+
+void remove_all_connections(struct Room *room);
+
+void del_connected_room(struct Room *room);
+
+struct Room *find_connection(const struct Room *room, const char *name);
+
+void find_connections(const struct Room *const *rooms,
+        const char *const *names, struct Room **results, const size_t n);
+
 #endif
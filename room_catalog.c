@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "room_catalog.h"
+#include "CuTest.h"
+
+/*
+ * Finds the index of a name in the room catalog with one hash and one compare.
+ *
+ * @param name The name to look up.
+ * @return The index of the name or ROOM_CATALOG_NONE if it is not in the
+ * catalog.
+ */
+size_t find_catalog_name(const char *name) {
+    const uint64_t h = catalog_hash(name);
+    const int32_t d = ROOM_CATALOG_DISPLACEMENTS[catalog_bucket(h,
+            ROOM_CATALOG_SIZE)];
+    const size_t index = d < 0 ? (size_t) (-d - 1)
+        : catalog_slot(h, (uint32_t) d, ROOM_CATALOG_SIZE);
+
+    return strcmp(ROOM_CATALOG_NAMES[index], name) == 0 ? index
+        : ROOM_CATALOG_NONE;
+}
+
+/*
+ * Returns the name of the catalog entry with the given index.
+ */
+const char *catalog_name(const size_t index) {
+    return ROOM_CATALOG_NAMES[index];
+}
+
+/*
+ * Constructs a new Room named after the catalog entry with the given index.
+ * The name is shared with the catalog rather than copied.
+ */
+struct Room *new_catalog_room(const size_t index, const room_t type) {
+    return new_static_room(ROOM_CATALOG_NAMES[index], type);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void find_catalog_name_should_find_every_catalog_name(CuTest *tc) {
+    size_t i;
+
+    for (i = 0; i < ROOM_CATALOG_SIZE; ++i) {
+        // Given a copy so that pointer equality cannot help
+        char *name = new_str_from(catalog_name(i));
+
+        // When / Then
+        CuAssertIntEquals(tc, i, find_catalog_name(name));
+
+        // Clean up
+        free(name);
+    }
+}
+
+void find_catalog_name_when_name_unknown_should_return_none(CuTest *tc) {
+    CuAssertTrue(tc, find_catalog_name("Ganon's Tower") == ROOM_CATALOG_NONE);
+    CuAssertTrue(tc, find_catalog_name("") == ROOM_CATALOG_NONE);
+    CuAssertTrue(tc, find_catalog_name("eastern palace") == ROOM_CATALOG_NONE);
+}
+
+void new_catalog_room_should_share_catalog_name(CuTest *tc) {
+    // Given
+    const size_t index = find_catalog_name("House of Gales");
+
+    // When
+    struct Room *room = new_catalog_room(index, END_ROOM);
+
+    // Then
+    CuAssertPtrEquals(tc, (void*) catalog_name(index), room->name);
+    CuAssertStrEquals(tc, "House of Gales", room->name);
+    CuAssertIntEquals(tc, END_ROOM, room->type);
+
+    // Clean up
+    del_room(room);
+}
+
+CuSuite *get_room_catalog_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, find_catalog_name_should_find_every_catalog_name);
+    SUITE_ADD_TEST(suite, find_catalog_name_when_name_unknown_should_return_none);
+    SUITE_ADD_TEST(suite, new_catalog_room_should_share_catalog_name);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * A generic chained hash table from names to catalog indices, for comparison.
+ */
+struct CatalogEntry {
+    char *name;
+    size_t index;
+    struct CatalogEntry *next;
+};
+
+static size_t find_linear(const char *name) {
+    size_t i;
+
+    for (i = 0; i < ROOM_CATALOG_SIZE; ++i) {
+        if (strcmp(ROOM_CATALOG_NAMES[i], name) == 0) {
+            return i;
+        }
+    }
+
+    return ROOM_CATALOG_NONE;
+}
+
+static size_t find_chained(struct CatalogEntry **buckets, const size_t size,
+        const char *name) {
+    const struct CatalogEntry *entry;
+
+    for (entry = buckets[catalog_hash(name) % size]; entry != NULL;
+            entry = entry->next) {
+        if (strcmp(entry->name, name) == 0) {
+            return entry->index;
+        }
+    }
+
+    return ROOM_CATALOG_NONE;
+}
+
+void run_room_catalog_benchmark() {
+    const size_t num_lookups = 10000000;
+    const size_t num_queries = 64;
+    const size_t num_buckets = 2 * ROOM_CATALOG_SIZE;
+    struct CatalogEntry **buckets = (struct CatalogEntry**) calloc(num_buckets,
+            sizeof(struct CatalogEntry*));
+    char *queries[64];
+    size_t found;
+    size_t i;
+
+    for (i = 0; i < ROOM_CATALOG_SIZE; ++i) {
+        struct CatalogEntry *entry = (struct CatalogEntry*) malloc(
+                sizeof(struct CatalogEntry));
+        const size_t bucket = catalog_hash(catalog_name(i)) % num_buckets;
+
+        entry->name = new_str_from(catalog_name(i));
+        entry->index = i;
+        entry->next = buckets[bucket];
+        buckets[bucket] = entry;
+    }
+
+    // Three quarters of the queries are catalog names, the rest are typos
+    for (i = 0; i < num_queries; ++i) {
+        queries[i] = new_str_from(i % 4 == 3 ? "Eastern Palac"
+                : catalog_name(i % ROOM_CATALOG_SIZE));
+    }
+
+    double start = now_seconds();
+    for (i = 0, found = 0; i < num_lookups; ++i) {
+        found += find_linear(queries[i % num_queries]) != ROOM_CATALOG_NONE;
+    }
+    printf("room_catalog: linear strcmp: %.1f ns per lookup (%zu found)\n",
+            (now_seconds() - start) / num_lookups * 1e9, found);
+
+    start = now_seconds();
+    for (i = 0, found = 0; i < num_lookups; ++i) {
+        found += find_chained(buckets, num_buckets, queries[i % num_queries])
+            != ROOM_CATALOG_NONE;
+    }
+    printf("room_catalog: chained hash table: %.1f ns per lookup (%zu found)\n",
+            (now_seconds() - start) / num_lookups * 1e9, found);
+
+    start = now_seconds();
+    for (i = 0, found = 0; i < num_lookups; ++i) {
+        found += find_catalog_name(queries[i % num_queries]) != ROOM_CATALOG_NONE;
+    }
+    printf("room_catalog: perfect hash: %.1f ns per lookup (%zu found)\n",
+            (now_seconds() - start) / num_lookups * 1e9, found);
+
+    for (i = 0; i < num_queries; ++i) {
+        free(queries[i]);
+    }
+
+    for (i = 0; i < num_buckets; ++i) {
+        while (buckets[i] != NULL) {
+            struct CatalogEntry *next = buckets[i]->next;
+            free(buckets[i]->name);
+            free(buckets[i]);
+            buckets[i] = next;
+        }
+    }
+
+    free(buckets);
+}
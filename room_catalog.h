@@ -0,0 +1,71 @@
+#ifndef ROOM_CATALOG_H
+#define ROOM_CATALOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "room.h"
+
+/*
+ * The built-in catalog of room names. The tables behind it are generated from
+ * room_catalog.txt at build time by gen_room_catalog into a minimal perfect
+ * hash: every catalog name hashes to its own slot, so resolving a name takes
+ * one hash and one compare.
+ */
+
+/*
+ * The index returned for names that are not in the catalog.
+ */
+#define ROOM_CATALOG_NONE ((size_t) -1)
+
+/*
+ * The generated tables. Names are stored in slot order. A negative
+ * displacement d places the only name of its bucket in slot -d - 1; any other
+ * displacement spreads the names of its bucket over free slots through
+ * catalog_slot.
+ */
+extern const size_t ROOM_CATALOG_SIZE;
+extern const char *const ROOM_CATALOG_NAMES[];
+extern const int32_t ROOM_CATALOG_DISPLACEMENTS[];
+
+/*
+ * Hashes a name into 64 bits. The generator and the lookup share this and the
+ * two helpers below so that both agree on every slot. Each name is hashed
+ * once; buckets and slots are derived from the two halves of the hash.
+ */
+static inline uint64_t catalog_hash(const char *name) {
+    uint64_t h = 14695981039346656037ULL;
+
+    while (*name != '\0') {
+        h = (h ^ (uint8_t) *name++) * 1099511628211ULL;
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+
+    return h;
+}
+
+/*
+ * Maps a hash to its bucket in [0, n) with a multiply and shift.
+ */
+static inline size_t catalog_bucket(const uint64_t h, const size_t n) {
+    return (size_t) (((h >> 32) * n) >> 32);
+}
+
+/*
+ * Maps a hash to a slot in [0, n) for the given displacement.
+ */
+static inline size_t catalog_slot(const uint64_t h, const uint32_t d,
+        const size_t n) {
+    const uint32_t mixed = (uint32_t) h + d * ((uint32_t) (h >> 32) | 1);
+    return (size_t) (((uint64_t) (mixed ^ (mixed >> 15)) * n) >> 32);
+}
+
+size_t find_catalog_name(const char *name);
+
+const char *catalog_name(const size_t index);
+
+struct Room *new_catalog_room(const size_t index, const room_t type);
+
+#endif
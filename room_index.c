@@ -0,0 +1,237 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "room_index.h"
+#include "world.h"
+#include "CuTest.h"
+
+/*
+ * A slot of the open addressing table that maps Room pointers to ids.
+ */
+struct RoomIndexSlot {
+    const struct Room *room;
+    size_t id;
+};
+
+/*
+ * Hashes a Room pointer. The low bits of heap pointers are mostly zero so they
+ * are mixed in with a multiplicative hash.
+ */
+static size_t hash_room(const struct Room *room) {
+    uint64_t h = (uint64_t) (uintptr_t) room;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t) h;
+}
+
+/*
+ * Inserts a Room into the table unless it is already there, in which case the
+ * first id it was given is kept.
+ */
+static void insert_room(struct RoomIndex *index, const struct Room *room,
+        size_t id) {
+    const size_t mask = index->table_capacity - 1;
+    size_t slot = hash_room(room) & mask;
+
+    while (index->table[slot].room != NULL) {
+        if (index->table[slot].room == room) {
+            return;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    index->table[slot].room = room;
+    index->table[slot].id = id;
+}
+
+/*
+ * How many rooms ahead fill_neighbors prefetches the table slots of.
+ */
+#define PREFETCH_DISTANCE 8
+
+/*
+ * Translates the connections of the rooms in [begin, end) into ids. Every
+ * lookup is a cache miss on large worlds, so the table slots of the rooms a
+ * few iterations ahead are prefetched to overlap those misses.
+ */
+static void fill_neighbors(void *ctx, size_t begin, size_t end, size_t thread) {
+    struct RoomIndex *index = (struct RoomIndex*) ctx;
+    const size_t mask = index->table_capacity - 1;
+    size_t i;
+    size_t j;
+
+    for (i = begin; i < end; ++i) {
+        const struct Room *room = index->rooms[i];
+        size_t *neighbors = index->neighbors + index->offsets[i];
+
+        if (i + PREFETCH_DISTANCE < end) {
+            const struct Room *ahead = index->rooms[i + PREFETCH_DISTANCE];
+
+            for (j = 0; j < ahead->num_connections; ++j) {
+                __builtin_prefetch(&index->table[
+                        hash_room(ahead->connections[j]) & mask]);
+            }
+        }
+
+        for (j = 0; j < room->num_connections; ++j) {
+            neighbors[j] = room_index_find(index, room->connections[j]);
+        }
+    }
+}
+
+/*
+ * Constructor. Translating connections into ids is the expensive part for
+ * large worlds so it is spread across num_threads threads (0 means one per
+ * online processor).
+ *
+ * @param room_list A pointer to a RoomList.
+ * @param num_threads The number of threads to build the index with.
+ * @return A pointer to a new RoomIndex.
+ */
+struct RoomIndex *new_room_index(const struct RoomList *room_list,
+        size_t num_threads) {
+    struct RoomIndex *index = (struct RoomIndex*) malloc(
+            sizeof(struct RoomIndex));
+    const struct RoomLink *curr;
+    size_t i;
+
+    index->size = room_list->size;
+    index->rooms = (struct Room**) malloc((index->size + 1) *
+            sizeof(struct Room*));
+    index->offsets = (size_t*) malloc((index->size + 1) * sizeof(size_t));
+
+    // Keep the table at most half full so probe sequences stay short
+    index->table_capacity = 16;
+    while (index->table_capacity < 2 * index->size) {
+        index->table_capacity *= 2;
+    }
+
+    index->table = (struct RoomIndexSlot*) calloc(index->table_capacity,
+            sizeof(struct RoomIndexSlot));
+
+    index->offsets[0] = 0;
+
+    for (i = 0, curr = room_list->head; curr != NULL; ++i, curr = curr->next) {
+        index->rooms[i] = curr->room;
+        index->offsets[i + 1] = index->offsets[i] + curr->room->num_connections;
+        insert_room(index, curr->room, i);
+    }
+
+    index->neighbors = (size_t*) malloc((index->offsets[index->size] + 1) *
+            sizeof(size_t));
+
+    parallel_for(index->size, num_threads, fill_neighbors, index);
+
+    return index;
+}
+
+/*
+ * Deletes the given RoomIndex. The indexed Rooms are left untouched.
+ *
+ * @param index A pointer to a RoomIndex.
+ */
+void del_room_index(struct RoomIndex *index) {
+    free(index->rooms);
+    free(index->offsets);
+    free(index->neighbors);
+    free(index->table);
+    free(index);
+}
+
+/*
+ * Finds the id of a Room. If a Room appears more than once in the list the id
+ * of its first appearance is returned.
+ *
+ * @param index A pointer to a RoomIndex.
+ * @param room A pointer to a Room.
+ * @return The id of the Room or ROOM_INDEX_NONE if it is not indexed.
+ */
+size_t room_index_find(const struct RoomIndex *index, const struct Room *room) {
+    const size_t mask = index->table_capacity - 1;
+    size_t slot = hash_room(room) & mask;
+
+    while (index->table[slot].room != NULL) {
+        if (index->table[slot].room == room) {
+            return index->table[slot].id;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return ROOM_INDEX_NONE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void new_room_index_should_number_rooms_in_list_order(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(100, 4);
+
+    // When
+    struct RoomIndex *index = new_room_index(world, 3);
+
+    // Then
+    CuAssertIntEquals(tc, 100, index->size);
+
+    size_t i;
+    struct RoomLink *curr;
+    for (i = 0, curr = world->head; curr != NULL; ++i, curr = curr->next) {
+        CuAssertPtrEquals(tc, curr->room, index->rooms[i]);
+        CuAssertIntEquals(tc, i, room_index_find(index, curr->room));
+    }
+
+    // Clean up
+    del_room_index(index);
+    del_world(world);
+}
+
+void new_room_index_should_store_connections_as_ids(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 2);
+
+    // When
+    struct RoomIndex *index = new_room_index(world, 2);
+
+    // Then
+    CuAssertIntEquals(tc, 0, index->offsets[0]);
+    CuAssertIntEquals(tc, 2, index->offsets[1]);
+    CuAssertIntEquals(tc, 20, index->offsets[10]);
+    CuAssertIntEquals(tc, 1, index->neighbors[0]);
+    CuAssertIntEquals(tc, 9, index->neighbors[1]);
+
+    // Clean up
+    del_room_index(index);
+    del_world(world);
+}
+
+void room_index_find_when_room_not_indexed_should_return_none(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 2);
+    struct Room *stranger = new_room("stranger", MID_ROOM);
+    add_connection(world->head->room, stranger);
+
+    // When
+    struct RoomIndex *index = new_room_index(world, 1);
+
+    // Then
+    CuAssertTrue(tc, room_index_find(index, stranger) == ROOM_INDEX_NONE);
+    CuAssertTrue(tc, index->neighbors[2] == ROOM_INDEX_NONE);
+
+    // Clean up
+    del_room_index(index);
+    del_world(world);
+    del_room(stranger);
+}
+
+CuSuite *get_room_index_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, new_room_index_should_number_rooms_in_list_order);
+    SUITE_ADD_TEST(suite, new_room_index_should_store_connections_as_ids);
+    SUITE_ADD_TEST(suite, room_index_find_when_room_not_indexed_should_return_none);
+
+    return suite;
+}
@@ -0,0 +1,36 @@
+#ifndef ROOM_INDEX_H
+#define ROOM_INDEX_H
+
+#include <stddef.h>
+#include "room.h"
+#include "room_list.h"
+
+/*
+ * The id returned for Rooms that are not part of an index.
+ */
+#define ROOM_INDEX_NONE ((size_t) -1)
+
+/*
+ * A structure that numbers the Rooms of a RoomList 0..size-1 in list order and
+ * stores their connections as ids in compressed sparse row form: the ids of
+ * the connections of room i are neighbors[offsets[i]] ..
+ * neighbors[offsets[i + 1] - 1], in the same order as room->connections.
+ * Connections to Rooms outside of the list are stored as ROOM_INDEX_NONE.
+ */
+struct RoomIndex {
+    size_t size;
+    struct Room **rooms;
+    size_t *offsets;
+    size_t *neighbors;
+    size_t table_capacity;
+    struct RoomIndexSlot *table;
+};
+
+struct RoomIndex *new_room_index(const struct RoomList *room_list,
+        size_t num_threads);
+
+void del_room_index(struct RoomIndex *index);
+
+size_t room_index_find(const struct RoomIndex *index, const struct Room *room);
+
+#endif
@@ -1,16 +1,10 @@
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include "room_list.h"
+#include "utils.h"
 #include "CuTest.h"
 
-/*
- * A structure that stores a pointer to a Room and a pointer to the next
- * RoomLink.
- */
-struct RoomLink {
-    struct Room *room;
-    struct RoomLink *next;
-};
-
 /*
  * Constructor.
  *
@@ -21,6 +15,7 @@ struct RoomLink *new_room_link(struct Room *room) {
     struct RoomLink *link = (struct RoomLink*) malloc(sizeof(struct RoomLink));
 
     link->room = room;
+    link->prev = NULL;
     link->next = NULL;
 
     return link;
@@ -74,8 +69,10 @@ void del_room_list(struct RoomList *room_list) {
  *
  * @param room_list A pointer to a RoomList.
  * @param room A pointer to a Room.
+ * @return A pointer to the new RoomLink, which can be handed to
+ * remove_room_link later.
  */
-void add_room(struct RoomList *room_list, struct Room *room) {
+struct RoomLink *add_room(struct RoomList *room_list, struct Room *room) {
     struct RoomLink *link = new_room_link(room);
    
     if (room_list->head == NULL && room_list->tail == NULL) {
@@ -84,11 +81,99 @@ void add_room(struct RoomList *room_list, struct Room *room) {
         room_list->tail = link;
     } else {
         // Else set the current tail's next to link and update tail to link
+        link->prev = room_list->tail;
         room_list->tail->next = link;
         room_list->tail = link;
     }
 
     room_list->size++;
+
+    return link;
+}
+
+/*
+ * Adds a Room to the given RoomList without a lock, so that any number of
+ * threads can append at once. Each append swaps itself in as the new tail with
+ * one atomic exchange, which orders it among the others, and only then links
+ * the old tail to it. Until that link is stored the list briefly ends at the
+ * old tail; snapshot_room_list stops there.
+ *
+ * Concurrent appends must not be mixed with add_room or remove_room_link.
+ * Once every appending thread has been joined the list is an ordinary
+ * RoomList again.
+ *
+ * @param room_list A pointer to a RoomList.
+ * @param room A pointer to a Room.
+ * @return A pointer to the new RoomLink.
+ */
+struct RoomLink *add_room_concurrent(struct RoomList *room_list,
+        struct Room *room) {
+    struct RoomLink *link = new_room_link(room);
+    struct RoomLink *prev = __atomic_exchange_n(&room_list->tail, link,
+            __ATOMIC_ACQ_REL);
+
+    // prev is written before link is published, so whoever reaches link
+    // through next also sees its prev
+    link->prev = prev;
+
+    if (prev == NULL) {
+        __atomic_store_n(&room_list->head, link, __ATOMIC_RELEASE);
+    } else {
+        __atomic_store_n(&prev->next, link, __ATOMIC_RELEASE);
+    }
+
+    __atomic_fetch_add(&room_list->size, 1, __ATOMIC_RELAXED);
+
+    return link;
+}
+
+/*
+ * Takes a snapshot of the links of the given RoomList that are fully linked
+ * in, which is safe while other threads call add_room_concurrent. The
+ * snapshot walks the list once.
+ *
+ * @param room_list A pointer to a RoomList.
+ * @param snapshot The RoomListSnapshot to fill in.
+ */
+void snapshot_room_list(const struct RoomList *room_list,
+        struct RoomListSnapshot *snapshot) {
+    struct RoomLink *curr = __atomic_load_n(&room_list->head,
+            __ATOMIC_ACQUIRE);
+
+    snapshot->head = curr;
+    snapshot->size = 0;
+
+    while (curr != NULL) {
+        snapshot->size++;
+        curr = __atomic_load_n(&curr->next, __ATOMIC_ACQUIRE);
+    }
+}
+
+/*
+ * Removes a RoomLink from the given RoomList in constant time and deletes it.
+ * The Room it points to is left untouched.
+ *
+ * @param room_list A pointer to a RoomList.
+ * @param link A pointer to a RoomLink of room_list.
+ * @return A pointer to the RoomLink that followed the removed one.
+ */
+struct RoomLink *remove_room_link(struct RoomList *room_list,
+        struct RoomLink *link) {
+    if (link->prev != NULL) {
+        link->prev->next = link->next;
+    } else {
+        room_list->head = link->next;
+    }
+
+    if (link->next != NULL) {
+        link->next->prev = link->prev;
+    } else {
+        room_list->tail = link->prev;
+    }
+
+    room_list->size--;
+
+    return del_room_link(link);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -107,6 +192,7 @@ void new_room_link_should_create_new_room_link(CuTest *tc) {
     // Then
     CuAssertPtrNotNull(tc, link);
     CuAssertPtrEquals(tc, room, link->room);
+    CuAssertPtrEquals(tc, NULL, link->prev);
     CuAssertPtrEquals(tc, NULL, link->next);
 
     // Clean up
@@ -175,11 +261,156 @@ void add_room_should_add_to_list(CuTest *tc) {
     CuAssertPtrEquals(tc, room1, list->head->room);
     CuAssertPtrEquals(tc, room2, list->tail->room);
     CuAssertPtrEquals(tc, list->tail, list->head->next);
+    CuAssertPtrEquals(tc, list->head, list->tail->prev);
+
+    // Clean up
+    del_room_list(list);
+    del_room(room1);
+    del_room(room2);
+}
+
+void remove_room_link_when_middle_should_relink_neighbours(CuTest *tc) {
+    // Given
+    struct Room *room1 = new_room("name1", START_ROOM);
+    struct Room *room2 = new_room("name2", MID_ROOM);
+    struct Room *room3 = new_room("name3", END_ROOM);
+    struct RoomList *list = new_room_list();
+    struct RoomLink *link1 = add_room(list, room1);
+    struct RoomLink *link2 = add_room(list, room2);
+    struct RoomLink *link3 = add_room(list, room3);
+
+    // When
+    struct RoomLink *next = remove_room_link(list, link2);
+
+    // Then
+    CuAssertPtrEquals(tc, link3, next);
+    CuAssertIntEquals(tc, 2, list->size);
+    CuAssertPtrEquals(tc, link3, link1->next);
+    CuAssertPtrEquals(tc, link1, link3->prev);
 
     // Clean up
     del_room_list(list);
     del_room(room1);
     del_room(room2);
+    del_room(room3);
+}
+
+void remove_room_link_when_head_and_tail_should_update_list(CuTest *tc) {
+    // Given
+    struct Room *room1 = new_room("name1", START_ROOM);
+    struct Room *room2 = new_room("name2", END_ROOM);
+    struct RoomList *list = new_room_list();
+    struct RoomLink *link1 = add_room(list, room1);
+    struct RoomLink *link2 = add_room(list, room2);
+
+    // When
+    remove_room_link(list, link1);
+
+    // Then
+    CuAssertIntEquals(tc, 1, list->size);
+    CuAssertPtrEquals(tc, link2, list->head);
+    CuAssertPtrEquals(tc, link2, list->tail);
+    CuAssertPtrEquals(tc, NULL, link2->prev);
+
+    // When
+    remove_room_link(list, link2);
+
+    // Then
+    CuAssertIntEquals(tc, 0, list->size);
+    CuAssertPtrEquals(tc, NULL, list->head);
+    CuAssertPtrEquals(tc, NULL, list->tail);
+
+    // Clean up
+    del_room_list(list);
+    del_room(room1);
+    del_room(room2);
+}
+
+/*
+ * The state shared by threads appending the rooms of one array to a list.
+ */
+struct AppendTask {
+    struct RoomList *list;
+    struct Room **rooms;
+    struct RoomListSnapshot *snapshots;
+};
+
+static void append_range(void *ctx, size_t begin, size_t end, size_t thread) {
+    struct AppendTask *task = (struct AppendTask*) ctx;
+    size_t i;
+
+    for (i = begin; i < end; ++i) {
+        add_room_concurrent(task->list, task->rooms[i]);
+
+        // One thread keeps taking snapshots while the others append
+        if (thread == 0 && task->snapshots != NULL) {
+            snapshot_room_list(task->list, &task->snapshots[i - begin]);
+        }
+    }
+}
+
+static int compare_rooms(const void *a, const void *b) {
+    const struct Room *room1 = *(struct Room *const*) a;
+    const struct Room *room2 = *(struct Room *const*) b;
+
+    return room1 < room2 ? -1 : (room1 > room2);
+}
+
+void add_room_concurrent_should_add_every_room_once(CuTest *tc) {
+    // Given
+    const size_t num_rooms = 8000;
+    struct Room **rooms = (struct Room**) malloc(num_rooms *
+            sizeof(struct Room*));
+    struct Room **listed = (struct Room**) malloc(num_rooms *
+            sizeof(struct Room*));
+    struct RoomListSnapshot *snapshots = (struct RoomListSnapshot*) malloc(
+            num_rooms * sizeof(struct RoomListSnapshot));
+    struct RoomList *list = new_room_list();
+    struct AppendTask task = { list, rooms, snapshots };
+    struct RoomLink *curr;
+    size_t i;
+
+    for (i = 0; i < num_rooms; ++i) {
+        rooms[i] = new_static_room("name", MID_ROOM);
+    }
+
+    // When
+    parallel_for(num_rooms, 8, append_range, &task);
+
+    // Then every room is listed once, with prev and next agreeing
+    CuAssertIntEquals(tc, num_rooms, list->size);
+
+    for (i = 0, curr = list->head; curr != NULL; curr = curr->next, ++i) {
+        CuAssertPtrEquals(tc, i == 0 ? NULL : listed[i - 1],
+                curr->prev == NULL ? NULL : curr->prev->room);
+        listed[i] = curr->room;
+    }
+
+    CuAssertIntEquals(tc, num_rooms, i);
+    CuAssertPtrEquals(tc, listed[num_rooms - 1], list->tail->room);
+    qsort(listed, num_rooms, sizeof(struct Room*), compare_rooms);
+    qsort(rooms, num_rooms, sizeof(struct Room*), compare_rooms);
+
+    for (i = 0; i < num_rooms; ++i) {
+        CuAssertPtrEquals(tc, rooms[i], listed[i]);
+    }
+
+    // And every snapshot was a prefix of the final list that only grew
+    for (i = 0; i < num_rooms / 8; ++i) {
+        CuAssertPtrEquals(tc, list->head, snapshots[i].head);
+        CuAssertTrue(tc, i == 0 || snapshots[i].size >= snapshots[i - 1].size);
+        CuAssertTrue(tc, snapshots[i].size <= num_rooms);
+    }
+
+    // Clean up
+    for (i = 0; i < num_rooms; ++i) {
+        del_room(rooms[i]);
+    }
+
+    del_room_list(list);
+    free(snapshots);
+    free(listed);
+    free(rooms);
 }
 
 CuSuite *get_room_list_suite() {
@@ -189,6 +420,84 @@ CuSuite *get_room_list_suite() {
     SUITE_ADD_TEST(suite, del_room_link_should_return_next);
     SUITE_ADD_TEST(suite, new_room_list_should_return_new_room_list);
     SUITE_ADD_TEST(suite, add_room_should_add_to_list);
+    SUITE_ADD_TEST(suite, remove_room_link_when_middle_should_relink_neighbours);
+    SUITE_ADD_TEST(suite, remove_room_link_when_head_and_tail_should_update_list);
+    SUITE_ADD_TEST(suite, add_room_concurrent_should_add_every_room_once);
 
     return suite;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * The state shared by threads appending through add_room under one mutex, the
+ * way concurrent loaders had to before add_room_concurrent.
+ */
+struct LockedAppendTask {
+    struct RoomList *list;
+    struct Room **rooms;
+    pthread_mutex_t lock;
+};
+
+static void locked_append_range(void *ctx, size_t begin, size_t end,
+        size_t thread) {
+    struct LockedAppendTask *task = (struct LockedAppendTask*) ctx;
+    size_t i;
+
+    for (i = begin; i < end; ++i) {
+        pthread_mutex_lock(&task->lock);
+        add_room(task->list, task->rooms[i]);
+        pthread_mutex_unlock(&task->lock);
+    }
+}
+
+void run_room_list_benchmark() {
+    const size_t num_rooms = 2000000;
+    const size_t thread_counts[] = { 1, 2, 4, 8, 16, 32 };
+    struct Room **rooms = (struct Room**) malloc(num_rooms *
+            sizeof(struct Room*));
+    struct RoomListSnapshot snapshot;
+    size_t i;
+    size_t t;
+
+    for (i = 0; i < num_rooms; ++i) {
+        rooms[i] = new_static_room("name", MID_ROOM);
+    }
+
+    for (t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t) {
+        struct LockedAppendTask locked = { new_room_list(), rooms };
+        struct AppendTask task = { new_room_list(), rooms, NULL };
+
+        pthread_mutex_init(&locked.lock, NULL);
+
+        double start = now_seconds();
+        parallel_for(num_rooms, thread_counts[t], locked_append_range, &locked);
+        const double locked_seconds = now_seconds() - start;
+
+        start = now_seconds();
+        parallel_for(num_rooms, thread_counts[t], append_range, &task);
+        const double concurrent_seconds = now_seconds() - start;
+
+        start = now_seconds();
+        snapshot_room_list(task.list, &snapshot);
+        const double snapshot_seconds = now_seconds() - start;
+
+        printf("room_list: %2zu threads: mutex %.1f M appends/s, lock-free "
+                "%.1f M appends/s, snapshot of %zu in %.1f ms\n",
+                thread_counts[t], num_rooms / locked_seconds / 1e6,
+                num_rooms / concurrent_seconds / 1e6, snapshot.size,
+                snapshot_seconds * 1e3);
+
+        pthread_mutex_destroy(&locked.lock);
+        del_room_list(locked.list);
+        del_room_list(task.list);
+    }
+
+    for (i = 0; i < num_rooms; ++i) {
+        del_room(rooms[i]);
+    }
+
+    free(rooms);
+}
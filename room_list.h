@@ -4,6 +4,16 @@
 #include <stddef.h>
 #include "room.h"
 
+/*
+ * A structure that stores a pointer to a Room and pointers to the previous and
+ * next RoomLinks.
+ */
+struct RoomLink {
+    struct Room *room;
+    struct RoomLink *prev;
+    struct RoomLink *next;
+};
+
 /*
  * A structure that stores a linked list of pointers to Rooms.
  */
@@ -13,8 +23,25 @@ struct RoomList {
     struct RoomLink *tail;
 };
 
+/*
+ * A structure that stores the first size links of a RoomList as they were
+ * when the snapshot was taken. Appends made after that, concurrent or not,
+ * never change those links, so they can be walked from head through next
+ * while other threads keep appending.
+ */
+struct RoomListSnapshot {
+    size_t size;
+    struct RoomLink *head;
+};
+
 struct RoomList *new_room_list();
 void del_room_list(struct RoomList *room_list);
-void add_room(struct RoomList *room_list, struct Room *room);
+struct RoomLink *add_room(struct RoomList *room_list, struct Room *room);
+struct RoomLink *add_room_concurrent(struct RoomList *room_list,
+        struct Room *room);
+void snapshot_room_list(const struct RoomList *room_list,
+        struct RoomListSnapshot *snapshot);
+struct RoomLink *remove_room_link(struct RoomList *room_list,
+        struct RoomLink *link);
 
 #endif
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <string.h>
+#include "utils.h"
+
+void run_room_list_benchmark();
+void run_world_verifier_benchmark();
+void run_lazy_world_benchmark();
+void run_packed_world_benchmark();
+void run_compact_world_benchmark();
+void run_find_connections_benchmark();
+void run_random_walk_benchmark();
+void run_remove_connection_benchmark();
+void run_room_hub_benchmark();
+void run_game_pipeline_benchmark();
+void run_room_catalog_benchmark();
+void run_replay_log_benchmark();
+void run_sharded_world_benchmark();
+void run_world_generator_benchmark();
+void run_world_codec_benchmark();
+void run_world_save_benchmark();
+void run_bitset_world_benchmark();
+void run_world_host_benchmark();
+void run_world_analytics_benchmark();
+void run_world_cache_benchmark();
+
+/*
+ * A named benchmark.
+ */
+struct Benchmark {
+    const char *name;
+    void (*run)();
+};
+
+static const struct Benchmark benchmarks[] = {
+    { "room_list", run_room_list_benchmark },
+    { "world_verifier", run_world_verifier_benchmark },
+    { "lazy_world", run_lazy_world_benchmark },
+    { "packed_world", run_packed_world_benchmark },
+    { "compact_world", run_compact_world_benchmark },
+    { "find_connections", run_find_connections_benchmark },
+    { "random_walk", run_random_walk_benchmark },
+    { "remove_connection", run_remove_connection_benchmark },
+    { "room_hub", run_room_hub_benchmark },
+    { "game_pipeline", run_game_pipeline_benchmark },
+    { "room_catalog", run_room_catalog_benchmark },
+    { "replay_log", run_replay_log_benchmark },
+    { "sharded_world", run_sharded_world_benchmark },
+    { "world_generator", run_world_generator_benchmark },
+    { "world_codec", run_world_codec_benchmark },
+    { "world_save", run_world_save_benchmark },
+    { "bitset_world", run_bitset_world_benchmark },
+    { "world_host", run_world_host_benchmark },
+    { "world_analytics", run_world_analytics_benchmark },
+    { "world_cache", run_world_cache_benchmark },
+};
+
+/*
+ * Runs every benchmark, or only the ones named on the command line.
+ */
+int main(int argc, char *argv[]) {
+    const size_t num_benchmarks = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    size_t i;
+    int j;
+
+    for (i = 0; i < num_benchmarks; ++i) {
+        bool selected = argc == 1;
+
+        for (j = 1; j < argc; ++j) {
+            if (strcmp(argv[j], benchmarks[i].name) == 0) {
+                selected = true;
+            }
+        }
+
+        if (selected) {
+            printf("== %s ==\n", benchmarks[i].name);
+            benchmarks[i].run();
+        }
+    }
+
+    return 0;
+}
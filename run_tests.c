@@ -4,6 +4,25 @@
 CuSuite *get_utils_suite();
 CuSuite *get_room_suite();
 CuSuite *get_room_list_suite();
+CuSuite *get_world_suite();
+CuSuite *get_room_index_suite();
+CuSuite *get_world_verifier_suite();
+CuSuite *get_lazy_world_suite();
+CuSuite *get_packed_world_suite();
+CuSuite *get_compact_world_suite();
+CuSuite *get_random_walk_suite();
+CuSuite *get_spsc_queue_suite();
+CuSuite *get_game_pipeline_suite();
+CuSuite *get_room_catalog_suite();
+CuSuite *get_replay_log_suite();
+CuSuite *get_sharded_world_suite();
+CuSuite *get_world_generator_suite();
+CuSuite *get_world_codec_suite();
+CuSuite *get_world_save_suite();
+CuSuite *get_bitset_world_suite();
+CuSuite *get_world_host_suite();
+CuSuite *get_world_analytics_suite();
+CuSuite *get_world_cache_suite();
 
 int main(int argc, char *argv[]) {
     CuString *output = CuStringNew();
@@ -12,6 +31,25 @@ int main(int argc, char *argv[]) {
     CuSuiteAddSuite(suite, get_utils_suite());
     CuSuiteAddSuite(suite, get_room_suite());
     CuSuiteAddSuite(suite, get_room_list_suite());
+    CuSuiteAddSuite(suite, get_world_suite());
+    CuSuiteAddSuite(suite, get_room_index_suite());
+    CuSuiteAddSuite(suite, get_world_verifier_suite());
+    CuSuiteAddSuite(suite, get_lazy_world_suite());
+    CuSuiteAddSuite(suite, get_packed_world_suite());
+    CuSuiteAddSuite(suite, get_compact_world_suite());
+    CuSuiteAddSuite(suite, get_random_walk_suite());
+    CuSuiteAddSuite(suite, get_spsc_queue_suite());
+    CuSuiteAddSuite(suite, get_game_pipeline_suite());
+    CuSuiteAddSuite(suite, get_room_catalog_suite());
+    CuSuiteAddSuite(suite, get_replay_log_suite());
+    CuSuiteAddSuite(suite, get_sharded_world_suite());
+    CuSuiteAddSuite(suite, get_world_generator_suite());
+    CuSuiteAddSuite(suite, get_world_codec_suite());
+    CuSuiteAddSuite(suite, get_world_save_suite());
+    CuSuiteAddSuite(suite, get_bitset_world_suite());
+    CuSuiteAddSuite(suite, get_world_host_suite());
+    CuSuiteAddSuite(suite, get_world_analytics_suite());
+    CuSuiteAddSuite(suite, get_world_cache_suite());
 
     CuSuiteRun(suite);
     CuSuiteSummary(suite, output);
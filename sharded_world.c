@@ -0,0 +1,838 @@
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "sharded_world.h"
+#include "utils.h"
+#include "world.h"
+#include "CuTest.h"
+
+/*
+ * Marks an entry of Shard.neighbors as an index into the ghost table rather
+ * than a local room.
+ */
+#define SHARD_GHOST ((size_t) 1 << (sizeof(size_t) * 8 - 1))
+
+/*
+ * The part of the world held by one worker. Rooms are numbered locally in
+ * increasing global id order; the connections of local room i are
+ * neighbors[offsets[i]] .. neighbors[offsets[i + 1] - 1]. Ghosts are sorted by
+ * global id.
+ */
+struct Shard {
+    size_t shard;
+    size_t num_rooms;
+    size_t *global_ids;
+    size_t *offsets;
+    size_t *neighbors;
+    size_t num_ghosts;
+    size_t *ghost_ids;
+    size_t *ghost_owners;
+};
+
+typedef enum {
+    SHARD_START,
+    SHARD_HANDOFF,
+    SHARD_DONE,
+    SHARD_STATS,
+    SHARD_QUIT
+} shard_message_t;
+
+/*
+ * The counters a worker keeps between two SHARD_STATS requests.
+ */
+struct ShardCounters {
+    uint64_t moves;
+    uint64_t handoffs;
+    uint64_t latency_sum_ns;
+    uint64_t latency_max_ns;
+};
+
+/*
+ * The single fixed-size message exchanged between the coordinator and the
+ * workers. A session travels in full, random number generator included, so a
+ * walk takes the same path however the world is sharded.
+ */
+struct ShardMessage {
+    uint32_t type;
+    uint32_t shard;
+    uint64_t session;
+    uint64_t room;
+    uint64_t steps_left;
+    uint64_t sent_ns;
+    struct Xoshiro256 rng;
+    struct ShardCounters counters;
+};
+
+/*
+ * A queue of messages waiting for a worker's socket to drain.
+ */
+struct ShardQueue {
+    struct ShardMessage *messages;
+    size_t head;
+    size_t size;
+    size_t capacity;
+};
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static int compare_ids(const void *a, const void *b) {
+    const size_t id1 = *(const size_t*) a;
+    const size_t id2 = *(const size_t*) b;
+
+    return id1 < id2 ? -1 : (id1 > id2);
+}
+
+/*
+ * Returns the position of id in the sorted array ids, which must hold it.
+ */
+static size_t find_sorted(const size_t *ids, size_t size, const size_t id) {
+    size_t low = 0;
+
+    while (size > 1) {
+        const size_t half = size / 2;
+
+        if (ids[low + half] <= id) {
+            low += half;
+        }
+
+        size -= half;
+    }
+
+    return low;
+}
+
+/*
+ * Partitions the rooms of an index into num_shards shards of nearly equal
+ * size. Shards are grown one at a time by breadth first search from the
+ * lowest unassigned room, which keeps them connected, and then a few greedy
+ * passes move boundary rooms to the shard most of their connections are in
+ * while sizes stay within about 3% of even.
+ *
+ * @param index A pointer to the RoomIndex of the world.
+ * @param num_shards The number of shards.
+ * @return A new array with the shard of every room or NULL if there are no
+ * shards or no rooms.
+ */
+size_t *partition_world(const struct RoomIndex *index,
+        const size_t num_shards) {
+    if (num_shards == 0 || index->size == 0) {
+        return NULL;
+    }
+
+    const size_t n = index->size;
+    const size_t even = (n + num_shards - 1) / num_shards;
+    const size_t capacity = even + even / 32;
+    size_t *owner = (size_t*) malloc(n * sizeof(size_t));
+    size_t *queue = (size_t*) malloc(n * sizeof(size_t));
+    size_t *sizes = (size_t*) calloc(num_shards, sizeof(size_t));
+    size_t *counts = (size_t*) calloc(num_shards, sizeof(size_t));
+    size_t next_seed = 0;
+    size_t assigned = 0;
+    size_t pass;
+    size_t i;
+    size_t s;
+
+    for (i = 0; i < n; ++i) {
+        owner[i] = ROOM_INDEX_NONE;
+    }
+
+    for (s = 0; s < num_shards; ++s) {
+        const size_t target = (n - assigned + num_shards - s - 1)
+            / (num_shards - s);
+        size_t head = 0;
+        size_t tail = 0;
+
+        while (sizes[s] < target) {
+            if (head == tail) {
+                while (owner[next_seed] != ROOM_INDEX_NONE) {
+                    ++next_seed;
+                }
+
+                owner[next_seed] = s;
+                sizes[s]++;
+                queue[tail++] = next_seed;
+                continue;
+            }
+
+            const size_t room = queue[head++];
+
+            for (i = index->offsets[room]; i < index->offsets[room + 1]
+                    && sizes[s] < target; ++i) {
+                const size_t neighbor = index->neighbors[i];
+
+                if (neighbor != ROOM_INDEX_NONE
+                        && owner[neighbor] == ROOM_INDEX_NONE) {
+                    owner[neighbor] = s;
+                    sizes[s]++;
+                    queue[tail++] = neighbor;
+                }
+            }
+        }
+
+        assigned += sizes[s];
+    }
+
+    for (pass = 0; pass < 4; ++pass) {
+        size_t moved = 0;
+        size_t room;
+
+        for (room = 0; room < n; ++room) {
+            const size_t current = owner[room];
+            size_t best = current;
+
+            for (i = index->offsets[room]; i < index->offsets[room + 1]; ++i) {
+                if (index->neighbors[i] != ROOM_INDEX_NONE) {
+                    counts[owner[index->neighbors[i]]]++;
+                }
+            }
+
+            for (i = index->offsets[room]; i < index->offsets[room + 1]; ++i) {
+                if (index->neighbors[i] != ROOM_INDEX_NONE) {
+                    const size_t shard = owner[index->neighbors[i]];
+
+                    if (counts[shard] > counts[best]) {
+                        best = shard;
+                    }
+                }
+            }
+
+            for (i = index->offsets[room]; i < index->offsets[room + 1]; ++i) {
+                if (index->neighbors[i] != ROOM_INDEX_NONE) {
+                    counts[owner[index->neighbors[i]]] = 0;
+                }
+            }
+
+            if (best != current && sizes[best] < capacity
+                    && sizes[current] > 1) {
+                owner[room] = best;
+                sizes[best]++;
+                sizes[current]--;
+                moved++;
+            }
+        }
+
+        if (moved == 0) {
+            break;
+        }
+    }
+
+    free(counts);
+    free(sizes);
+    free(queue);
+
+    return owner;
+}
+
+/*
+ * Returns the number of connections between rooms in different shards. Each
+ * connection is assumed to be mutual and is counted once.
+ */
+size_t count_cut_edges(const struct RoomIndex *index, const size_t *owner) {
+    size_t cut = 0;
+    size_t room;
+    size_t i;
+
+    for (room = 0; room < index->size; ++room) {
+        for (i = index->offsets[room]; i < index->offsets[room + 1]; ++i) {
+            const size_t neighbor = index->neighbors[i];
+
+            if (neighbor != ROOM_INDEX_NONE && owner[neighbor] != owner[room]) {
+                cut++;
+            }
+        }
+    }
+
+    return cut / 2;
+}
+
+/*
+ * Builds the part of the world owned by the given shard. Connections to rooms
+ * outside of the index are dropped.
+ */
+static struct Shard *new_shard(const struct RoomIndex *index,
+        const size_t *owner, const size_t shard_id) {
+    struct Shard *shard = (struct Shard*) calloc(1, sizeof(struct Shard));
+    size_t num_neighbors = 0;
+    size_t num_cut = 0;
+    size_t room;
+    size_t i;
+
+    shard->shard = shard_id;
+
+    for (room = 0; room < index->size; ++room) {
+        if (owner[room] == shard_id) {
+            shard->num_rooms++;
+            num_neighbors += index->offsets[room + 1] - index->offsets[room];
+        }
+    }
+
+    shard->global_ids = (size_t*) malloc((shard->num_rooms + 1)
+            * sizeof(size_t));
+    shard->offsets = (size_t*) malloc((shard->num_rooms + 1) * sizeof(size_t));
+    shard->neighbors = (size_t*) malloc((num_neighbors + 1) * sizeof(size_t));
+    shard->ghost_ids = (size_t*) malloc((num_neighbors + 1) * sizeof(size_t));
+    shard->num_rooms = 0;
+
+    for (room = 0; room < index->size; ++room) {
+        if (owner[room] != shard_id) {
+            continue;
+        }
+
+        shard->global_ids[shard->num_rooms++] = room;
+
+        for (i = index->offsets[room]; i < index->offsets[room + 1]; ++i) {
+            const size_t neighbor = index->neighbors[i];
+
+            if (neighbor != ROOM_INDEX_NONE && owner[neighbor] != shard_id) {
+                shard->ghost_ids[num_cut++] = neighbor;
+            }
+        }
+    }
+
+    qsort(shard->ghost_ids, num_cut, sizeof(size_t), compare_ids);
+
+    for (i = 0; i < num_cut; ++i) {
+        if (i == 0 || shard->ghost_ids[i] != shard->ghost_ids[i - 1]) {
+            shard->ghost_ids[shard->num_ghosts++] = shard->ghost_ids[i];
+        }
+    }
+
+    shard->ghost_owners = (size_t*) malloc((shard->num_ghosts + 1)
+            * sizeof(size_t));
+
+    for (i = 0; i < shard->num_ghosts; ++i) {
+        shard->ghost_owners[i] = owner[shard->ghost_ids[i]];
+    }
+
+    num_neighbors = 0;
+
+    for (room = 0; room < shard->num_rooms; ++room) {
+        const size_t global_id = shard->global_ids[room];
+
+        shard->offsets[room] = num_neighbors;
+
+        for (i = index->offsets[global_id]; i < index->offsets[global_id + 1];
+                ++i) {
+            const size_t neighbor = index->neighbors[i];
+
+            if (neighbor == ROOM_INDEX_NONE) {
+                continue;
+            }
+
+            shard->neighbors[num_neighbors++] = owner[neighbor] == shard_id
+                ? find_sorted(shard->global_ids, shard->num_rooms, neighbor)
+                : SHARD_GHOST | find_sorted(shard->ghost_ids,
+                        shard->num_ghosts, neighbor);
+        }
+    }
+
+    shard->offsets[shard->num_rooms] = num_neighbors;
+
+    return shard;
+}
+
+static void del_shard(struct Shard *shard) {
+    free(shard->ghost_owners);
+    free(shard->ghost_ids);
+    free(shard->neighbors);
+    free(shard->offsets);
+    free(shard->global_ids);
+    free(shard);
+}
+
+/*
+ * Walks a session through the shard until it runs out of steps or steps into
+ * a ghost, and turns the message into the matching SHARD_DONE or
+ * SHARD_HANDOFF reply.
+ */
+static void play_session(const struct Shard *shard, struct ShardMessage *msg,
+        struct ShardCounters *counters) {
+    size_t room = find_sorted(shard->global_ids, shard->num_rooms, msg->room);
+
+    while (msg->steps_left > 0) {
+        const size_t degree = shard->offsets[room + 1] - shard->offsets[room];
+
+        msg->steps_left--;
+        counters->moves++;
+
+        if (degree == 0) {
+            continue;
+        }
+
+        const size_t next = shard->neighbors[shard->offsets[room]
+            + xoshiro_below(&msg->rng, degree)];
+
+        if (next & SHARD_GHOST) {
+            msg->type = SHARD_HANDOFF;
+            msg->room = shard->ghost_ids[next & ~SHARD_GHOST];
+            msg->shard = (uint32_t) shard->ghost_owners[next & ~SHARD_GHOST];
+            msg->sent_ns = monotonic_ns();
+            return;
+        }
+
+        room = next;
+    }
+
+    msg->type = SHARD_DONE;
+    msg->room = shard->global_ids[room];
+}
+
+/*
+ * The main loop of a worker process. Every session message is answered by
+ * exactly one reply, so the coordinator always knows where a session is.
+ */
+static void run_shard(const struct Shard *shard, const int fd) {
+    struct ShardCounters counters;
+    struct ShardMessage msg;
+
+    memset(&counters, 0, sizeof(counters));
+
+    while (recv(fd, &msg, sizeof(msg), 0) == sizeof(msg)
+            && msg.type != SHARD_QUIT) {
+        if (msg.type == SHARD_STATS) {
+            msg.counters = counters;
+            memset(&counters, 0, sizeof(counters));
+        } else {
+            if (msg.type == SHARD_HANDOFF) {
+                const uint64_t latency = monotonic_ns() - msg.sent_ns;
+
+                counters.handoffs++;
+                counters.latency_sum_ns += latency;
+
+                if (latency > counters.latency_max_ns) {
+                    counters.latency_max_ns = latency;
+                }
+            }
+
+            play_session(shard, &msg, &counters);
+        }
+
+        if (send(fd, &msg, sizeof(msg), MSG_NOSIGNAL) != sizeof(msg)) {
+            break;
+        }
+    }
+}
+
+/*
+ * Partitions a world and starts one worker process per shard. The workers
+ * are forked, so each builds its shard from the parent's index and from then
+ * on touches nothing but its own rooms and ghosts.
+ *
+ * @param world A pointer to the RoomList of the world.
+ * @param num_shards The number of worker processes.
+ * @return A pointer to a new ShardedWorld or NULL if there are no shards or no
+ * rooms or a worker could not be started.
+ */
+struct ShardedWorld *new_sharded_world(const struct RoomList *world,
+        const size_t num_shards) {
+    if (num_shards == 0 || world->size == 0) {
+        return NULL;
+    }
+
+    struct RoomIndex *index = new_room_index(world, 0);
+    struct ShardedWorld *sharded = (struct ShardedWorld*) calloc(1,
+            sizeof(struct ShardedWorld));
+    size_t s;
+
+    sharded->num_rooms = index->size;
+    sharded->owner = partition_world(index, num_shards);
+    sharded->cut_edges = count_cut_edges(index, sharded->owner);
+    sharded->workers = (pid_t*) malloc(num_shards * sizeof(pid_t));
+    sharded->sockets = (int*) malloc(num_shards * sizeof(int));
+
+    for (s = 0; s < num_shards; ++s) {
+        int pair[2];
+
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair) != 0) {
+            break;
+        }
+
+        const pid_t pid = fork();
+
+        if (pid == 0) {
+            size_t other;
+
+            for (other = 0; other < s; ++other) {
+                close(sharded->sockets[other]);
+            }
+
+            close(pair[0]);
+
+            struct Shard *shard = new_shard(index, sharded->owner, s);
+            run_shard(shard, pair[1]);
+            del_shard(shard);
+            _exit(0);
+        }
+
+        close(pair[1]);
+
+        if (pid < 0) {
+            close(pair[0]);
+            break;
+        }
+
+        sharded->workers[s] = pid;
+        sharded->sockets[s] = pair[0];
+        sharded->num_shards++;
+    }
+
+    del_room_index(index);
+
+    if (sharded->num_shards < num_shards) {
+        del_sharded_world(sharded);
+        return NULL;
+    }
+
+    return sharded;
+}
+
+/*
+ * Stops the workers of a sharded world and deletes it.
+ */
+void del_sharded_world(struct ShardedWorld *sharded) {
+    struct ShardMessage msg;
+    size_t s;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = SHARD_QUIT;
+
+    for (s = 0; s < sharded->num_shards; ++s) {
+        send(sharded->sockets[s], &msg, sizeof(msg), MSG_NOSIGNAL);
+        close(sharded->sockets[s]);
+        waitpid(sharded->workers[s], NULL, 0);
+    }
+
+    free(sharded->sockets);
+    free(sharded->workers);
+    free(sharded->owner);
+    free(sharded);
+}
+
+static void push_shard_message(struct ShardQueue *queue,
+        const struct ShardMessage *msg) {
+    if (queue->size == queue->capacity) {
+        queue->capacity = queue->capacity == 0 ? 64 : queue->capacity * 2;
+        queue->messages = (struct ShardMessage*) realloc(queue->messages,
+                queue->capacity * sizeof(struct ShardMessage));
+    }
+
+    queue->messages[queue->size++] = *msg;
+}
+
+/*
+ * Sends queued messages until the queue is empty or the socket is full.
+ */
+static void flush_shard_queue(struct ShardQueue *queue, const int fd) {
+    while (queue->head < queue->size && send(fd,
+                &queue->messages[queue->head], sizeof(struct ShardMessage),
+                MSG_DONTWAIT | MSG_NOSIGNAL) == sizeof(struct ShardMessage)) {
+        queue->head++;
+    }
+
+    if (queue->head == queue->size) {
+        queue->head = 0;
+        queue->size = 0;
+    }
+}
+
+/*
+ * Collects and resets the counters of every worker.
+ */
+static bool collect_shard_counters(struct ShardedWorld *sharded,
+        struct ShardCounters *total) {
+    struct ShardMessage msg;
+    size_t s;
+
+    memset(total, 0, sizeof(struct ShardCounters));
+
+    for (s = 0; s < sharded->num_shards; ++s) {
+        memset(&msg, 0, sizeof(msg));
+        msg.type = SHARD_STATS;
+
+        if (send(sharded->sockets[s], &msg, sizeof(msg), MSG_NOSIGNAL)
+                != sizeof(msg)
+                || recv(sharded->sockets[s], &msg, sizeof(msg), 0)
+                != sizeof(msg)) {
+            return false;
+        }
+
+        total->moves += msg.counters.moves;
+        total->handoffs += msg.counters.handoffs;
+        total->latency_sum_ns += msg.counters.latency_sum_ns;
+
+        if (msg.counters.latency_max_ns > total->latency_max_ns) {
+            total->latency_max_ns = msg.counters.latency_max_ns;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Plays num_sessions random walks of num_steps moves each across the shards.
+ * Session i starts in room i * num_rooms / num_sessions and draws its moves
+ * from a generator seeded with seed + i, so the final rooms do not depend on
+ * the number of shards. The coordinator never blocks on a worker: replies
+ * are read as they arrive and handoffs wait in per-worker queues until the
+ * owner's socket has room.
+ *
+ * @param sharded A pointer to a ShardedWorld.
+ * @param num_sessions The number of sessions to play.
+ * @param num_steps The number of moves of each session.
+ * @param seed The seed of the walks.
+ * @return A pointer to a new ShardedWalkReport or NULL if a worker failed.
+ */
+struct ShardedWalkReport *sharded_world_walk(struct ShardedWorld *sharded,
+        const size_t num_sessions, const size_t num_steps,
+        const uint64_t seed) {
+    struct ShardQueue *queues = (struct ShardQueue*) calloc(
+            sharded->num_shards, sizeof(struct ShardQueue));
+    struct pollfd *fds = (struct pollfd*) calloc(sharded->num_shards,
+            sizeof(struct pollfd));
+    struct ShardedWalkReport *report = (struct ShardedWalkReport*) calloc(1,
+            sizeof(struct ShardedWalkReport));
+    struct ShardCounters counters;
+    struct ShardMessage msg;
+    size_t remaining = num_sessions;
+    bool failed = false;
+    size_t i;
+    size_t s;
+
+    report->num_sessions = num_sessions;
+    report->final_rooms = (size_t*) malloc((num_sessions + 1)
+            * sizeof(size_t));
+
+    const double start = now_seconds();
+
+    for (i = 0; i < num_sessions; ++i) {
+        memset(&msg, 0, sizeof(msg));
+        msg.type = SHARD_START;
+        msg.session = i;
+        msg.room = i * sharded->num_rooms / num_sessions;
+        msg.steps_left = num_steps;
+        seed_xoshiro(&msg.rng, seed + i);
+        push_shard_message(&queues[sharded->owner[msg.room]], &msg);
+    }
+
+    while (remaining > 0 && !failed) {
+        for (s = 0; s < sharded->num_shards; ++s) {
+            fds[s].fd = sharded->sockets[s];
+            fds[s].events = POLLIN
+                | (queues[s].head < queues[s].size ? POLLOUT : 0);
+        }
+
+        if (poll(fds, sharded->num_shards, -1) < 0) {
+            failed = true;
+            break;
+        }
+
+        for (s = 0; s < sharded->num_shards; ++s) {
+            if (fds[s].revents & POLLOUT) {
+                flush_shard_queue(&queues[s], sharded->sockets[s]);
+            }
+
+            if (fds[s].revents & (POLLERR | POLLHUP)) {
+                failed = true;
+            }
+
+            if (!(fds[s].revents & POLLIN)) {
+                continue;
+            }
+
+            while (recv(sharded->sockets[s], &msg, sizeof(msg), MSG_DONTWAIT)
+                    == sizeof(msg)) {
+                if (msg.type == SHARD_HANDOFF) {
+                    push_shard_message(&queues[msg.shard], &msg);
+                } else {
+                    report->final_rooms[msg.session] = msg.room;
+                    remaining--;
+                }
+            }
+        }
+    }
+
+    report->seconds = now_seconds() - start;
+
+    for (s = 0; s < sharded->num_shards; ++s) {
+        free(queues[s].messages);
+    }
+
+    free(fds);
+    free(queues);
+
+    if (failed || !collect_shard_counters(sharded, &counters)) {
+        del_sharded_walk_report(report);
+        return NULL;
+    }
+
+    report->moves = counters.moves;
+    report->handoffs = counters.handoffs;
+    report->moves_per_second = report->moves / report->seconds;
+    report->mean_handoff_us = counters.handoffs == 0 ? 0
+        : counters.latency_sum_ns / 1e3 / counters.handoffs;
+    report->max_handoff_us = counters.latency_max_ns / 1e3;
+
+    return report;
+}
+
+void del_sharded_walk_report(struct ShardedWalkReport *report) {
+    free(report->final_rooms);
+    free(report);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void partition_world_when_ring_should_cut_once_per_shard(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(100, 2);
+    struct RoomIndex *index = new_room_index(world, 1);
+    size_t sizes[4] = { 0 };
+    size_t i;
+
+    // When
+    size_t *owner = partition_world(index, 4);
+
+    // Then
+    for (i = 0; i < index->size; ++i) {
+        sizes[owner[i]]++;
+    }
+
+    CuAssertIntEquals(tc, 25, sizes[0]);
+    CuAssertIntEquals(tc, 25, sizes[3]);
+    CuAssertIntEquals(tc, 4, count_cut_edges(index, owner));
+
+    // Clean up
+    free(owner);
+    del_room_index(index);
+    del_world(world);
+}
+
+void partition_world_should_keep_shards_balanced(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(1000, 6);
+    struct RoomIndex *index = new_room_index(world, 1);
+    size_t sizes[7] = { 0 };
+    size_t i;
+
+    // When
+    size_t *owner = partition_world(index, 7);
+
+    // Then
+    for (i = 0; i < index->size; ++i) {
+        CuAssertTrue(tc, owner[i] < 7);
+        sizes[owner[i]]++;
+    }
+
+    for (i = 0; i < 7; ++i) {
+        CuAssertTrue(tc, sizes[i] > 0 && sizes[i] <= 143 + 143 / 32);
+    }
+
+    CuAssertTrue(tc, count_cut_edges(index, owner) <= 7 * 6);
+
+    // Clean up
+    free(owner);
+    del_room_index(index);
+    del_world(world);
+}
+
+void sharded_world_walk_should_not_depend_on_number_of_shards(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(200, 4);
+    struct ShardedWorld *single = new_sharded_world(world, 1);
+    struct ShardedWorld *sharded = new_sharded_world(world, 4);
+    size_t i;
+
+    // When
+    struct ShardedWalkReport *expected = sharded_world_walk(single, 50, 200, 7);
+    struct ShardedWalkReport *actual = sharded_world_walk(sharded, 50, 200, 7);
+
+    // Then
+    CuAssertIntEquals(tc, 10000, expected->moves);
+    CuAssertIntEquals(tc, 10000, actual->moves);
+    CuAssertIntEquals(tc, 0, expected->handoffs);
+    CuAssertTrue(tc, actual->handoffs > 0);
+
+    for (i = 0; i < 50; ++i) {
+        CuAssertIntEquals(tc, expected->final_rooms[i], actual->final_rooms[i]);
+    }
+
+    // Clean up
+    del_sharded_walk_report(actual);
+    del_sharded_walk_report(expected);
+    del_sharded_world(sharded);
+    del_sharded_world(single);
+    del_world(world);
+}
+
+void new_sharded_world_when_no_shards_or_rooms_should_return_null(
+        CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 2);
+    struct RoomList *empty = new_room_list();
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, new_sharded_world(world, 0));
+    CuAssertPtrEquals(tc, NULL, new_sharded_world(empty, 2));
+
+    // Clean up
+    del_world(empty);
+    del_world(world);
+}
+
+CuSuite *get_sharded_world_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, partition_world_when_ring_should_cut_once_per_shard);
+    SUITE_ADD_TEST(suite, partition_world_should_keep_shards_balanced);
+    SUITE_ADD_TEST(suite, sharded_world_walk_should_not_depend_on_number_of_shards);
+    SUITE_ADD_TEST(suite, new_sharded_world_when_no_shards_or_rooms_should_return_null);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+void run_sharded_world_benchmark() {
+    const size_t world_sizes[] = { 100000, 1000 };
+    const size_t num_sessions = 1000;
+    const size_t num_steps = 10000;
+    size_t w;
+
+    for (w = 0; w < sizeof(world_sizes) / sizeof(world_sizes[0]); ++w) {
+        struct RoomList *world = new_circulant_world(world_sizes[w], 6);
+        size_t num_shards;
+
+        for (num_shards = 1; num_shards <= 8; num_shards *= 2) {
+            struct ShardedWorld *sharded = new_sharded_world(world,
+                    num_shards);
+            struct ShardedWalkReport *report = sharded_world_walk(sharded,
+                    num_sessions, num_steps, 1);
+
+            printf("sharded_world: %zu rooms, %zu shards, %zu cut edges: "
+                    "%.0f moves/s, %zu handoffs, handoff latency mean %.1f us, "
+                    "max %.1f us\n", world_sizes[w], num_shards,
+                    sharded->cut_edges, report->moves_per_second,
+                    report->handoffs, report->mean_handoff_us,
+                    report->max_handoff_us);
+
+            del_sharded_walk_report(report);
+            del_sharded_world(sharded);
+        }
+
+        del_world(world);
+    }
+}
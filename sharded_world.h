@@ -0,0 +1,62 @@
+#ifndef SHARDED_WORLD_H
+#define SHARDED_WORLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "room_index.h"
+#include "room_list.h"
+
+/*
+ * A sharded world splits the rooms of a world between worker processes that
+ * talk to a coordinator over Unix domain sockets. Each worker keeps only the
+ * connections of the rooms it owns plus a ghost entry, naming the owning
+ * shard, for every neighbour owned by another worker. A session that moves
+ * through a cut edge is handed off to the owner of the room it enters by way
+ * of the coordinator. Room ids are positions in the RoomList of the world.
+ */
+
+/*
+ * A structure that stores the coordinator's side of a sharded world.
+ * owner[i] is the shard that owns room i.
+ */
+struct ShardedWorld {
+    size_t num_shards;
+    size_t num_rooms;
+    size_t *owner;
+    size_t cut_edges;
+    pid_t *workers;
+    int *sockets;
+};
+
+/*
+ * A structure that stores the outcome of sharded_world_walk. final_rooms[i]
+ * is the room session i ended in. Handoff latency is measured from the send
+ * on the old shard to the receive on the new one.
+ */
+struct ShardedWalkReport {
+    size_t num_sessions;
+    size_t moves;
+    size_t handoffs;
+    double seconds;
+    double moves_per_second;
+    double mean_handoff_us;
+    double max_handoff_us;
+    size_t *final_rooms;
+};
+
+size_t *partition_world(const struct RoomIndex *index, size_t num_shards);
+
+size_t count_cut_edges(const struct RoomIndex *index, const size_t *owner);
+
+struct ShardedWorld *new_sharded_world(const struct RoomList *world,
+        size_t num_shards);
+
+void del_sharded_world(struct ShardedWorld *sharded);
+
+struct ShardedWalkReport *sharded_world_walk(struct ShardedWorld *sharded,
+        size_t num_sessions, size_t num_steps, uint64_t seed);
+
+void del_sharded_walk_report(struct ShardedWalkReport *report);
+
+#endif
@@ -0,0 +1,193 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spsc_queue.h"
+#include "CuTest.h"
+
+/*
+ * Constructor. The capacity is rounded up to a power of two.
+ *
+ * @param capacity The minimum number of elements the queue can hold.
+ * @param element_size The size of every element in bytes.
+ * @return A pointer to a new SpscQueue.
+ */
+struct SpscQueue *new_spsc_queue(const size_t capacity,
+        const size_t element_size) {
+    struct SpscQueue *queue = (struct SpscQueue*) aligned_alloc(64,
+            (sizeof(struct SpscQueue) + 63) / 64 * 64);
+    size_t size = 2;
+
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    queue->head = 0;
+    queue->cached_tail = 0;
+    queue->tail = 0;
+    queue->cached_head = 0;
+    queue->mask = size - 1;
+    queue->element_size = element_size;
+    queue->elements = (char*) malloc(size * element_size);
+
+    return queue;
+}
+
+/*
+ * Deletes the given SpscQueue.
+ */
+void del_spsc_queue(struct SpscQueue *queue) {
+    free(queue->elements);
+    free(queue);
+}
+
+/*
+ * Tries to append an element. Must only be called by the producer thread.
+ * Returns false if the queue is full.
+ */
+bool spsc_push(struct SpscQueue *queue, const void *element) {
+    const size_t tail = queue->tail;
+
+    // Only reload the consumer's head when the cached copy says we are full
+    if (tail - queue->cached_head > queue->mask) {
+        queue->cached_head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+        if (tail - queue->cached_head > queue->mask) {
+            return false;
+        }
+    }
+
+    memcpy(queue->elements + (tail & queue->mask) * queue->element_size,
+            element, queue->element_size);
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/*
+ * Tries to remove the oldest element. Must only be called by the consumer
+ * thread. Returns false if the queue is empty.
+ */
+bool spsc_pop(struct SpscQueue *queue, void *element) {
+    const size_t head = queue->head;
+
+    if (head == queue->cached_tail) {
+        queue->cached_tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+        if (head == queue->cached_tail) {
+            return false;
+        }
+    }
+
+    memcpy(element, queue->elements + (head & queue->mask) * queue->element_size,
+            queue->element_size);
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/*
+ * Appends an element, yielding the processor while the queue is full.
+ */
+void spsc_push_wait(struct SpscQueue *queue, const void *element) {
+    while (!spsc_push(queue, element)) {
+        sched_yield();
+    }
+}
+
+/*
+ * Removes the oldest element, yielding the processor while the queue is empty.
+ */
+void spsc_pop_wait(struct SpscQueue *queue, void *element) {
+    while (!spsc_pop(queue, element)) {
+        sched_yield();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void spsc_queue_should_pop_in_push_order(CuTest *tc) {
+    // Given
+    struct SpscQueue *queue = new_spsc_queue(4, sizeof(int));
+    int i;
+    int value;
+
+    // When
+    for (i = 0; i < 3; ++i) {
+        CuAssertIntEquals(tc, true, spsc_push(queue, &i));
+    }
+
+    // Then
+    for (i = 0; i < 3; ++i) {
+        CuAssertIntEquals(tc, true, spsc_pop(queue, &value));
+        CuAssertIntEquals(tc, i, value);
+    }
+
+    CuAssertIntEquals(tc, false, spsc_pop(queue, &value));
+
+    // Clean up
+    del_spsc_queue(queue);
+}
+
+void spsc_push_when_full_should_fail(CuTest *tc) {
+    // Given
+    struct SpscQueue *queue = new_spsc_queue(4, sizeof(int));
+    int i;
+    int value;
+
+    for (i = 0; i < 4; ++i) {
+        CuAssertIntEquals(tc, true, spsc_push(queue, &i));
+    }
+
+    // When / Then
+    CuAssertIntEquals(tc, false, spsc_push(queue, &i));
+    CuAssertIntEquals(tc, true, spsc_pop(queue, &value));
+    CuAssertIntEquals(tc, true, spsc_push(queue, &i));
+
+    // Clean up
+    del_spsc_queue(queue);
+}
+
+static void *produce_numbers(void *arg) {
+    struct SpscQueue *queue = (struct SpscQueue*) arg;
+    size_t i;
+
+    for (i = 1; i <= 100000; ++i) {
+        spsc_push_wait(queue, &i);
+    }
+
+    return NULL;
+}
+
+void spsc_queue_across_threads_should_deliver_every_element_in_order(CuTest *tc) {
+    // Given
+    struct SpscQueue *queue = new_spsc_queue(64, sizeof(size_t));
+    pthread_t producer;
+    size_t expected;
+    size_t value;
+
+    // When
+    pthread_create(&producer, NULL, produce_numbers, queue);
+
+    // Then
+    for (expected = 1; expected <= 100000; ++expected) {
+        spsc_pop_wait(queue, &value);
+        CuAssertTrue(tc, value == expected);
+    }
+
+    // Clean up
+    pthread_join(producer, NULL);
+    del_spsc_queue(queue);
+}
+
+CuSuite *get_spsc_queue_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, spsc_queue_should_pop_in_push_order);
+    SUITE_ADD_TEST(suite, spsc_push_when_full_should_fail);
+    SUITE_ADD_TEST(suite, spsc_queue_across_threads_should_deliver_every_element_in_order);
+
+    return suite;
+}
@@ -0,0 +1,35 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include "utils.h"
+
+/*
+ * A structure that stores a lock-free bounded queue of fixed-size elements for
+ * exactly one producer thread and one consumer thread. The producer only
+ * writes tail and the consumer only writes head, each on its own cache line.
+ */
+struct SpscQueue {
+    size_t head __attribute__((aligned(64)));
+    size_t cached_tail;
+    size_t tail __attribute__((aligned(64)));
+    size_t cached_head;
+    size_t mask __attribute__((aligned(64)));
+    size_t element_size;
+    char *elements;
+};
+
+struct SpscQueue *new_spsc_queue(const size_t capacity,
+        const size_t element_size);
+
+void del_spsc_queue(struct SpscQueue *queue);
+
+bool spsc_push(struct SpscQueue *queue, const void *element);
+
+bool spsc_pop(struct SpscQueue *queue, void *element);
+
+void spsc_push_wait(struct SpscQueue *queue, const void *element);
+
+void spsc_pop_wait(struct SpscQueue *queue, void *element);
+
+#endif
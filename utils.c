@@ -1,5 +1,10 @@
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "utils.h"
 #include "CuTest.h"
 
@@ -13,6 +18,169 @@ char *new_str_from(const char *src) {
     return strcpy(dst, src);
 }
 
+/*
+ * Returns the number of online processors, or 1 if that cannot be determined.
+ */
+size_t default_num_threads() {
+    const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return num_cpus > 0 ? (size_t) num_cpus : 1;
+}
+
+/*
+ * The arguments handed to a single parallel_for worker.
+ */
+struct RangeTask {
+    range_fn fn;
+    void *ctx;
+    size_t begin;
+    size_t end;
+    size_t thread;
+    bool started;
+};
+
+static void *run_range_task(void *arg) {
+    struct RangeTask *task = (struct RangeTask*) arg;
+    task->fn(task->ctx, task->begin, task->end, task->thread);
+    return NULL;
+}
+
+/*
+ * Splits [0, n) into num_threads contiguous ranges and runs fn over each of
+ * them on its own thread, returning once every range is done. The calling
+ * thread runs the first range itself, as well as any range whose thread could
+ * not be created. If num_threads is 0 the number of online processors is
+ * used.
+ */
+void parallel_for(size_t n, size_t num_threads, range_fn fn, void *ctx) {
+    if (num_threads == 0) {
+        num_threads = default_num_threads();
+    }
+
+    if (num_threads > n) {
+        num_threads = n > 0 ? n : 1;
+    }
+
+    struct RangeTask *tasks = (struct RangeTask*) malloc(num_threads *
+            sizeof(struct RangeTask));
+    pthread_t *threads = (pthread_t*) malloc(num_threads * sizeof(pthread_t));
+    size_t i;
+
+    for (i = 0; i < num_threads; ++i) {
+        tasks[i].fn = fn;
+        tasks[i].ctx = ctx;
+        tasks[i].begin = n / num_threads * i + (i < n % num_threads ? i : n % num_threads);
+        tasks[i].end = tasks[i].begin + n / num_threads + (i < n % num_threads ? 1 : 0);
+        tasks[i].thread = i;
+    }
+
+    for (i = 1; i < num_threads; ++i) {
+        tasks[i].started = pthread_create(&threads[i], NULL, run_range_task,
+                &tasks[i]) == 0;
+
+        if (!tasks[i].started) {
+            run_range_task(&tasks[i]);
+        }
+    }
+
+    run_range_task(&tasks[0]);
+
+    for (i = 1; i < num_threads; ++i) {
+        if (tasks[i].started) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    free(threads);
+    free(tasks);
+}
+
+/*
+ * Returns a monotonic timestamp in seconds, for timing benchmarks.
+ */
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Seeds a xoshiro256** generator by expanding seed with splitmix64, which
+ * guarantees the state is not all zeros.
+ */
+void seed_xoshiro(struct Xoshiro256 *rng, uint64_t seed) {
+    size_t i;
+
+    for (i = 0; i < 4; ++i) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        rng->s[i] = z ^ (z >> 31);
+    }
+}
+
+static uint64_t rotl(const uint64_t x, const int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/*
+ * Returns the next 64 pseudo-random bits of a xoshiro256** generator.
+ */
+uint64_t next_xoshiro(struct Xoshiro256 *rng) {
+    uint64_t *s = rng->s;
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+/*
+ * Returns a pseudo-random number in [0, bound) using a multiply and shift
+ * instead of a division. The bias is negligible for small bounds.
+ */
+uint64_t xoshiro_below(struct Xoshiro256 *rng, const uint64_t bound) {
+    return (uint64_t) (((unsigned __int128) next_xoshiro(rng) * bound) >> 64);
+}
+
+/*
+ * Builds the path /tmp/<name>_<pid><suffix>, for tests that need a file or
+ * directory of their own, and deletes any file a previous run left there.
+ */
+void test_path(char *path, size_t size, const char *name,
+        const char *suffix) {
+    snprintf(path, size, "/tmp/%s_%d%s", name, (int) getpid(), suffix);
+    unlink(path);
+}
+
+/*
+ * Deletes a directory and the files in it.
+ */
+void remove_dir(const char *dir) {
+    DIR *handle = opendir(dir);
+    const struct dirent *entry;
+    char path[4096];
+
+    while (handle != NULL && (entry = readdir(handle)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0
+                && strcmp(entry->d_name, "..") != 0) {
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            unlink(path);
+        }
+    }
+
+    if (handle != NULL) {
+        closedir(handle);
+    }
+
+    rmdir(dir);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Unit tests
 ////////////////////////////////////////////////////////////////////////////////
@@ -30,8 +198,82 @@ void new_str_from_should_create_new_copy(CuTest *tc) {
     free(actual);
 }
 
+static void sum_range(void *ctx, size_t begin, size_t end, size_t thread) {
+    size_t *values = (size_t*) ctx;
+    size_t i;
+
+    for (i = begin; i < end; ++i) {
+        values[i] = i + 1;
+    }
+}
+
+void parallel_for_should_cover_every_index_once(CuTest *tc) {
+    // Given
+    size_t values[1000] = { 0 };
+
+    // When
+    parallel_for(1000, 7, sum_range, values);
+
+    // Then
+    size_t i;
+    for (i = 0; i < 1000; ++i) {
+        CuAssertIntEquals(tc, i + 1, values[i]);
+    }
+}
+
+void parallel_for_when_more_threads_than_items_should_cover_every_index(CuTest *tc) {
+    // Given
+    size_t values[3] = { 0 };
+
+    // When
+    parallel_for(3, 16, sum_range, values);
+
+    // Then
+    CuAssertIntEquals(tc, 1, values[0]);
+    CuAssertIntEquals(tc, 2, values[1]);
+    CuAssertIntEquals(tc, 3, values[2]);
+}
+
+void xoshiro_should_repeat_sequence_for_same_seed(CuTest *tc) {
+    // Given
+    struct Xoshiro256 rng1;
+    struct Xoshiro256 rng2;
+    seed_xoshiro(&rng1, 2016);
+    seed_xoshiro(&rng2, 2016);
+
+    // When / Then
+    size_t i;
+    for (i = 0; i < 100; ++i) {
+        CuAssertTrue(tc, next_xoshiro(&rng1) == next_xoshiro(&rng2));
+    }
+}
+
+void xoshiro_below_should_stay_below_bound(CuTest *tc) {
+    // Given
+    struct Xoshiro256 rng;
+    size_t counts[6] = { 0 };
+    seed_xoshiro(&rng, 7);
+
+    // When
+    size_t i;
+    for (i = 0; i < 6000; ++i) {
+        const uint64_t value = xoshiro_below(&rng, 6);
+        CuAssertTrue(tc, value < 6);
+        counts[value]++;
+    }
+
+    // Then every value should come up roughly a sixth of the time
+    for (i = 0; i < 6; ++i) {
+        CuAssertTrue(tc, counts[i] > 800 && counts[i] < 1200);
+    }
+}
+
 CuSuite *get_utils_suite() {
     CuSuite *suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, new_str_from_should_create_new_copy);
+    SUITE_ADD_TEST(suite, parallel_for_should_cover_every_index_once);
+    SUITE_ADD_TEST(suite, parallel_for_when_more_threads_than_items_should_cover_every_index);
+    SUITE_ADD_TEST(suite, xoshiro_should_repeat_sequence_for_same_seed);
+    SUITE_ADD_TEST(suite, xoshiro_below_should_stay_below_bound);
     return suite;
 }
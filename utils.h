@@ -1,11 +1,45 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 /*
  * A boolean type since C doesn't have one.
  */
 typedef enum { false, true } bool;
 
+/*
+ * A function run by parallel_for over the half-open range [begin, end). The
+ * thread argument is the index of the worker running the range.
+ */
+typedef void (*range_fn)(void *ctx, size_t begin, size_t end, size_t thread);
+
+/*
+ * The state of a xoshiro256** pseudo-random number generator. It is small and
+ * fast enough to give every thread its own.
+ */
+struct Xoshiro256 {
+    uint64_t s[4];
+};
+
 char *new_str_from(const char *src);
 
+size_t default_num_threads();
+
+void parallel_for(size_t n, size_t num_threads, range_fn fn, void *ctx);
+
+double now_seconds();
+
+void seed_xoshiro(struct Xoshiro256 *rng, uint64_t seed);
+
+uint64_t next_xoshiro(struct Xoshiro256 *rng);
+
+uint64_t xoshiro_below(struct Xoshiro256 *rng, const uint64_t bound);
+
+void test_path(char *path, size_t size, const char *name,
+        const char *suffix);
+
+void remove_dir(const char *dir);
+
 #endif
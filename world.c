@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "world.h"
+#include "CuTest.h"
+
+/*
+ * Constructs a world of num_rooms rooms named "Room <n>" where room i is
+ * connected to rooms i +/- 1 .. i +/- degree / 2 (mod num_rooms). The first
+ * room is the START_ROOM and the middle room is the END_ROOM. Such a world is
+ * connected, regular and symmetric, which makes it a handy fixture for tests
+ * and benchmarks. Note that num_rooms must be greater than degree and degree
+ * must be even and no greater than MAX_CONNECTIONS.
+ *
+ * @param num_rooms The number of rooms in the world.
+ * @param degree The number of connections of every room.
+ * @return A pointer to a new world.
+ */
+struct RoomList *new_circulant_world(size_t num_rooms, size_t degree) {
+    struct RoomList *world = new_room_list();
+    struct Room **rooms = (struct Room**) malloc(num_rooms * sizeof(struct Room*));
+    char name[32];
+    size_t i;
+    size_t k;
+
+    for (i = 0; i < num_rooms; ++i) {
+        room_t type = MID_ROOM;
+
+        if (i == 0) {
+            type = START_ROOM;
+        } else if (i == num_rooms / 2) {
+            type = END_ROOM;
+        }
+
+        snprintf(name, sizeof(name), "Room %zu", i);
+        rooms[i] = new_room(name, type);
+        add_room(world, rooms[i]);
+    }
+
+    for (k = 1; k <= degree / 2; ++k) {
+        for (i = 0; i < num_rooms; ++i) {
+            add_connection(rooms[i], rooms[(i + k) % num_rooms]);
+        }
+    }
+
+    free(rooms);
+
+    return world;
+}
+
+/*
+ * Deletes the given world along with every Room in it.
+ *
+ * @param world A pointer to a RoomList that owns its Rooms.
+ */
+void del_world(struct RoomList *world) {
+    struct RoomLink *curr = world->head;
+
+    while (curr != NULL) {
+        del_room(curr->room);
+        curr = curr->next;
+    }
+
+    del_room_list(world);
+}
+
+/*
+ * Asserts that two worlds have the same rooms, in the same order, with the
+ * same connections in any order.
+ */
+void assert_same_world(CuTest *tc, const struct RoomList *expected,
+        const struct RoomList *actual) {
+    const struct RoomLink *link1 = expected->head;
+    const struct RoomLink *link2 = actual->head;
+    size_t i;
+
+    CuAssertIntEquals(tc, expected->size, actual->size);
+
+    for (; link1 != NULL; link1 = link1->next, link2 = link2->next) {
+        CuAssertStrEquals(tc, link1->room->name, link2->room->name);
+        CuAssertIntEquals(tc, link1->room->type, link2->room->type);
+        CuAssertIntEquals(tc, link1->room->num_connections,
+                link2->room->num_connections);
+
+        for (i = 0; i < link1->room->num_connections; ++i) {
+            CuAssertPtrNotNull(tc, find_connection(link2->room,
+                        link1->room->connections[i]->name));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void new_circulant_world_should_connect_every_room_to_its_neighbours(CuTest *tc) {
+    // When
+    struct RoomList *world = new_circulant_world(10, 4);
+
+    // Then
+    CuAssertIntEquals(tc, 10, world->size);
+    CuAssertIntEquals(tc, START_ROOM, world->head->room->type);
+    CuAssertStrEquals(tc, "Room 0", world->head->room->name);
+
+    struct RoomLink *curr;
+    for (curr = world->head; curr != NULL; curr = curr->next) {
+        CuAssertIntEquals(tc, 4, curr->room->num_connections);
+    }
+
+    CuAssertStrEquals(tc, "Room 1", world->head->room->connections[0]->name);
+    CuAssertStrEquals(tc, "Room 9", world->head->room->connections[1]->name);
+
+    // Clean up
+    del_world(world);
+}
+
+CuSuite *get_world_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, new_circulant_world_should_connect_every_room_to_its_neighbours);
+
+    return suite;
+}
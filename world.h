@@ -0,0 +1,21 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <stddef.h>
+#include "room.h"
+#include "room_list.h"
+#include "CuTest.h"
+
+/*
+ * A world is a RoomList that owns the Rooms it holds. These helpers build and
+ * tear down whole worlds at once.
+ */
+
+struct RoomList *new_circulant_world(size_t num_rooms, size_t degree);
+
+void del_world(struct RoomList *world);
+
+void assert_same_world(CuTest *tc, const struct RoomList *expected,
+        const struct RoomList *actual);
+
+#endif
@@ -0,0 +1,780 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "room_index.h"
+#include "world.h"
+#include "world_analytics.h"
+#include "world_generator.h"
+#include "CuTest.h"
+
+/*
+ * The distance of a room a search has not reached.
+ */
+#define UNREACHED UINT32_MAX
+
+/*
+ * The buffers one thread needs for a search with Brandes' dependency
+ * accumulation.
+ */
+struct SweepScratch {
+    uint32_t *distances;
+    double *paths;
+    double *dependencies;
+    size_t *order;
+};
+
+/*
+ * The state shared by the threads of a sweep. Each thread searches from its
+ * share of the sources, writes the outcome of each search into its own slot
+ * and adds betweenness into its own partial sums.
+ */
+struct SweepTask {
+    const struct RoomIndex *index;
+    const size_t *sources;
+    size_t *eccentricities;
+    size_t *farthest;
+    size_t *reached;
+    double *partials;
+    struct SweepScratch *scratch;
+};
+
+/*
+ * The clustering sums of one thread.
+ */
+struct ClusteringSums {
+    double local;
+    double links;
+    double triads;
+};
+
+/*
+ * The state shared by the threads computing clustering coefficients.
+ */
+struct ClusteringTask {
+    const struct RoomIndex *index;
+    size_t **stamps;
+    struct ClusteringSums *sums;
+};
+
+static void init_scratch(struct SweepScratch *scratch, const size_t n) {
+    scratch->distances = (uint32_t*) malloc(n * sizeof(uint32_t));
+    scratch->paths = (double*) malloc(n * sizeof(double));
+    scratch->dependencies = (double*) malloc(n * sizeof(double));
+    scratch->order = (size_t*) malloc(n * sizeof(size_t));
+}
+
+static void free_scratch(struct SweepScratch *scratch) {
+    free(scratch->order);
+    free(scratch->dependencies);
+    free(scratch->paths);
+    free(scratch->distances);
+}
+
+/*
+ * Runs a breadth-first search from source that also counts shortest paths.
+ * Returns the number of rooms reached; they are left in scratch->order in the
+ * order they were reached.
+ */
+static size_t search_from(const struct RoomIndex *index, const size_t source,
+        struct SweepScratch *scratch) {
+    uint32_t *distances = scratch->distances;
+    double *paths = scratch->paths;
+    size_t *order = scratch->order;
+    size_t head = 0;
+    size_t tail = 0;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < index->size; ++i) {
+        distances[i] = UNREACHED;
+    }
+
+    distances[source] = 0;
+    paths[source] = 1;
+    order[tail++] = source;
+
+    while (head < tail) {
+        const size_t u = order[head++];
+
+        for (j = index->offsets[u]; j < index->offsets[u + 1]; ++j) {
+            const size_t v = index->neighbors[j];
+
+            if (v == ROOM_INDEX_NONE) {
+                continue;
+            }
+
+            if (distances[v] == UNREACHED) {
+                distances[v] = distances[u] + 1;
+                paths[v] = 0;
+                order[tail++] = v;
+            }
+
+            if (distances[v] == distances[u] + 1) {
+                paths[v] += paths[u];
+            }
+        }
+    }
+
+    return tail;
+}
+
+/*
+ * Adds the dependencies of the rooms reached by the last search to the
+ * betweenness sums, walking them back from the farthest. Each room pulls from
+ * the rooms one step further away, so no predecessor lists are needed.
+ */
+static void accumulate_dependencies(const struct RoomIndex *index,
+        const size_t reached, struct SweepScratch *scratch,
+        double *betweenness) {
+    const uint32_t *distances = scratch->distances;
+    const double *paths = scratch->paths;
+    double *dependencies = scratch->dependencies;
+    size_t i;
+    size_t j;
+
+    for (i = reached; i-- > 0;) {
+        const size_t u = scratch->order[i];
+        double dependency = 0;
+
+        for (j = index->offsets[u]; j < index->offsets[u + 1]; ++j) {
+            const size_t v = index->neighbors[j];
+
+            if (v != ROOM_INDEX_NONE && distances[v] == distances[u] + 1) {
+                dependency += paths[u] / paths[v] * (1 + dependencies[v]);
+            }
+        }
+
+        dependencies[u] = dependency;
+
+        if (i > 0) {
+            betweenness[u] += dependency;
+        }
+    }
+}
+
+static void sweep_range(void *ctx, size_t begin, size_t end, size_t thread) {
+    struct SweepTask *task = (struct SweepTask*) ctx;
+    struct SweepScratch *scratch = &task->scratch[thread];
+    double *partial = task->partials + thread * task->index->size;
+    size_t s;
+
+    for (s = begin; s < end; ++s) {
+        const size_t reached = search_from(task->index, task->sources[s],
+                scratch);
+        const size_t last = scratch->order[reached - 1];
+
+        task->reached[s] = reached;
+        task->farthest[s] = last;
+        task->eccentricities[s] = scratch->distances[last];
+        accumulate_dependencies(task->index, reached, scratch, partial);
+    }
+}
+
+static void clustering_range(void *ctx, size_t begin, size_t end,
+        size_t thread) {
+    struct ClusteringTask *task = (struct ClusteringTask*) ctx;
+    const struct RoomIndex *index = task->index;
+    size_t *stamps = task->stamps[thread];
+    struct ClusteringSums *sums = &task->sums[thread];
+    size_t u;
+    size_t j;
+    size_t k;
+
+    for (u = begin; u < end; ++u) {
+        size_t degree = 0;
+        size_t links = 0;
+
+        // Stamp the neighbours of u, then count the connections of each
+        // neighbour that lead back into the stamped set
+        for (j = index->offsets[u]; j < index->offsets[u + 1]; ++j) {
+            if (index->neighbors[j] != ROOM_INDEX_NONE) {
+                stamps[index->neighbors[j]] = u + 1;
+                ++degree;
+            }
+        }
+
+        for (j = index->offsets[u]; j < index->offsets[u + 1]; ++j) {
+            const size_t v = index->neighbors[j];
+
+            if (v == ROOM_INDEX_NONE) {
+                continue;
+            }
+
+            for (k = index->offsets[v]; k < index->offsets[v + 1]; ++k) {
+                const size_t w = index->neighbors[k];
+                links += w != ROOM_INDEX_NONE && stamps[w] == u + 1;
+            }
+        }
+
+        // Every link among the neighbours was counted from both ends
+        links /= 2;
+
+        if (degree >= 2) {
+            const double triads = degree * (degree - 1) / 2.0;
+
+            sums->local += links / triads;
+            sums->triads += triads;
+            sums->links += links;
+        }
+    }
+}
+
+/*
+ * Returns an upper bound on the natural logarithm of x from its bit length,
+ * which is all the sample size needs.
+ */
+static double log_upper_bound(const uint64_t x) {
+    return (64 - __builtin_clzll(x | 1)) * 0.6931471805599453;
+}
+
+/*
+ * Returns the number of sources that estimate every normalised betweenness to
+ * within max_error with 90% confidence. By Hoeffding's inequality and a union
+ * bound over the rooms that is ln(2n / 0.1) / (2 max_error^2).
+ */
+static size_t sample_size(const size_t num_rooms, const double max_error) {
+    return (size_t) (log_upper_bound(20 * (uint64_t) num_rooms)
+            / (2 * max_error * max_error)) + 1;
+}
+
+/*
+ * Returns the eccentricity of the first room of the given type, or
+ * ANALYTICS_NONE if there is none.
+ */
+static size_t eccentricity_of(const struct RoomIndex *index, const room_t type,
+        struct SweepScratch *scratch) {
+    size_t i;
+
+    for (i = 0; i < index->size; ++i) {
+        if (index->rooms[i]->type == type) {
+            const size_t reached = search_from(index, i, scratch);
+            return scratch->distances[scratch->order[reached - 1]];
+        }
+    }
+
+    return ANALYTICS_NONE;
+}
+
+/*
+ * Picks the rooms with the highest betweenness.
+ */
+static void find_top_rooms(const struct RoomIndex *index,
+        struct WorldAnalytics *analytics) {
+    size_t i;
+    size_t j;
+
+    analytics->num_top_rooms = 0;
+
+    for (i = 0; i < index->size; ++i) {
+        const double value = analytics->betweenness[i];
+
+        j = analytics->num_top_rooms;
+
+        if (j == ANALYTICS_TOP_ROOMS) {
+            if (value <= analytics->betweenness[analytics->top_rooms[j - 1]]) {
+                continue;
+            }
+
+            --j;
+        } else {
+            analytics->num_top_rooms++;
+        }
+
+        for (; j > 0 && analytics->betweenness[analytics->top_rooms[j - 1]]
+                < value; --j) {
+            analytics->top_rooms[j] = analytics->top_rooms[j - 1];
+        }
+
+        analytics->top_rooms[j] = i;
+    }
+
+    for (i = 0; i < analytics->num_top_rooms; ++i) {
+        analytics->top_room_names[i] = index->rooms[analytics->top_rooms[i]]
+            ->name;
+    }
+}
+
+/*
+ * Fills in the default options: one thread per online processor, exact
+ * analyses up to 5000 rooms and sampled betweenness within 0.05.
+ *
+ * @param options The AnalyticsOptions to fill in.
+ */
+void default_analytics_options(struct AnalyticsOptions *options) {
+    options->num_threads = 0;
+    options->exact_limit = 5000;
+    options->max_error = 0.05;
+    options->seed = 1;
+}
+
+/*
+ * Analyses the given world. The searches from every source run in one sweep
+ * spread over the worker threads, which computes eccentricities and
+ * betweenness together; clustering coefficients are computed in a second
+ * parallel pass.
+ *
+ * @param world A pointer to a RoomList.
+ * @param options How to run the analysis, NULL for the defaults.
+ * @return A pointer to a new WorldAnalytics. The names of the top rooms are
+ * borrowed from the world.
+ */
+struct WorldAnalytics *analyze_world(const struct RoomList *world,
+        const struct AnalyticsOptions *options) {
+    struct AnalyticsOptions defaults;
+    struct WorldAnalytics *analytics = (struct WorldAnalytics*) calloc(1,
+            sizeof(struct WorldAnalytics));
+    const double start = now_seconds();
+    size_t i;
+    size_t t;
+
+    if (options == NULL) {
+        default_analytics_options(&defaults);
+        options = &defaults;
+    }
+
+    struct RoomIndex *index = new_room_index(world, options->num_threads);
+    const size_t n = index->size;
+    size_t num_threads = options->num_threads == 0 ? default_num_threads()
+        : options->num_threads;
+
+    num_threads = n == 0 ? 1 : (num_threads > n ? n : num_threads);
+    analytics->num_rooms = n;
+    analytics->num_threads = num_threads;
+    analytics->betweenness = (double*) calloc(n + 1, sizeof(double));
+
+    for (i = 0; i < n; ++i) {
+        for (t = index->offsets[i]; t < index->offsets[i + 1]; ++t) {
+            analytics->num_connections += index->neighbors[t] != ROOM_INDEX_NONE
+                && index->neighbors[t] > i;
+        }
+    }
+
+    analytics->index_seconds = now_seconds() - start;
+
+    if (n == 0) {
+        analytics->connected = true;
+        analytics->exact = true;
+        analytics->start_eccentricity = ANALYTICS_NONE;
+        analytics->end_eccentricity = ANALYTICS_NONE;
+        analytics->total_seconds = now_seconds() - start;
+        del_room_index(index);
+        return analytics;
+    }
+
+    struct SweepScratch *scratch = (struct SweepScratch*) malloc(num_threads
+            * sizeof(struct SweepScratch));
+
+    for (t = 0; t < num_threads; ++t) {
+        init_scratch(&scratch[t], n);
+    }
+
+    // The eccentricities the game cares about are always exact
+    double phase = now_seconds();
+
+    analytics->start_eccentricity = eccentricity_of(index, START_ROOM,
+            &scratch[0]);
+    analytics->end_eccentricity = eccentricity_of(index, END_ROOM,
+            &scratch[0]);
+    analytics->eccentricity_seconds = now_seconds() - phase;
+
+    // Search from every room, or from a random sample of them
+    const size_t wanted = sample_size(n, options->max_error);
+    size_t *sources = (size_t*) malloc(n * sizeof(size_t));
+    struct Xoshiro256 rng;
+
+    analytics->exact = n <= options->exact_limit || wanted >= n;
+    analytics->num_sources = analytics->exact ? n : wanted;
+    seed_xoshiro(&rng, options->seed);
+
+    for (i = 0; i < n; ++i) {
+        sources[i] = i;
+    }
+
+    for (i = 0; !analytics->exact && i < analytics->num_sources; ++i) {
+        const size_t j = i + xoshiro_below(&rng, n - i);
+        const size_t source = sources[j];
+
+        sources[j] = sources[i];
+        sources[i] = source;
+    }
+
+    // One extra slot for the double sweep below
+    const size_t k = analytics->num_sources;
+    struct SweepTask task;
+
+    task.index = index;
+    task.sources = sources;
+    task.eccentricities = (size_t*) malloc((k + 1) * sizeof(size_t));
+    task.farthest = (size_t*) malloc((k + 1) * sizeof(size_t));
+    task.reached = (size_t*) malloc((k + 1) * sizeof(size_t));
+    task.partials = (double*) calloc(num_threads * n, sizeof(double));
+    task.scratch = scratch;
+
+    phase = now_seconds();
+    parallel_for(k, num_threads, sweep_range, &task);
+
+    analytics->connected = true;
+    analytics->diameter = 0;
+    analytics->diameter_upper_bound = ANALYTICS_NONE;
+
+    size_t widest = 0;
+
+    for (i = 0; i < k; ++i) {
+        analytics->connected = analytics->connected && task.reached[i] == n;
+
+        if (task.eccentricities[i] > analytics->diameter) {
+            analytics->diameter = task.eccentricities[i];
+            widest = i;
+        }
+
+        if (2 * task.eccentricities[i] < analytics->diameter_upper_bound) {
+            analytics->diameter_upper_bound = 2 * task.eccentricities[i];
+        }
+    }
+
+    if (analytics->exact) {
+        analytics->diameter_upper_bound = analytics->diameter;
+    } else {
+        // Searching again from the room farthest from the widest source often
+        // finds a longer shortest path than any sampled source did
+        const size_t reached = search_from(index, task.farthest[widest],
+                &scratch[0]);
+        const size_t eccentricity = scratch[0].distances[
+            scratch[0].order[reached - 1]];
+
+        if (eccentricity > analytics->diameter) {
+            analytics->diameter = eccentricity;
+        }
+    }
+
+    // Each shortest path was counted from both of its ends
+    const double scale = n > 2 ? (double) n / k / ((double) (n - 1) * (n - 2))
+        : 0;
+
+    for (t = 0; t < num_threads; ++t) {
+        for (i = 0; i < n; ++i) {
+            analytics->betweenness[i] += task.partials[t * n + i];
+        }
+    }
+
+    for (i = 0; i < n; ++i) {
+        analytics->betweenness[i] *= scale;
+    }
+
+    find_top_rooms(index, analytics);
+    analytics->sweep_seconds = now_seconds() - phase;
+
+    // Clustering coefficients
+    struct ClusteringTask clustering;
+    double local = 0;
+    double links = 0;
+    double triads = 0;
+
+    phase = now_seconds();
+    clustering.index = index;
+    clustering.stamps = (size_t**) malloc(num_threads * sizeof(size_t*));
+    clustering.sums = (struct ClusteringSums*) calloc(num_threads,
+            sizeof(struct ClusteringSums));
+
+    for (t = 0; t < num_threads; ++t) {
+        clustering.stamps[t] = (size_t*) calloc(n, sizeof(size_t));
+    }
+
+    parallel_for(n, num_threads, clustering_range, &clustering);
+
+    for (t = 0; t < num_threads; ++t) {
+        local += clustering.sums[t].local;
+        links += clustering.sums[t].links;
+        triads += clustering.sums[t].triads;
+        free(clustering.stamps[t]);
+    }
+
+    analytics->mean_clustering = local / n;
+    analytics->transitivity = triads > 0 ? links / triads : 0;
+    analytics->clustering_seconds = now_seconds() - phase;
+    analytics->total_seconds = now_seconds() - start;
+
+    for (t = 0; t < num_threads; ++t) {
+        free_scratch(&scratch[t]);
+    }
+
+    free(clustering.sums);
+    free(clustering.stamps);
+    free(task.partials);
+    free(task.reached);
+    free(task.farthest);
+    free(task.eccentricities);
+    free(sources);
+    free(scratch);
+    del_room_index(index);
+
+    return analytics;
+}
+
+/*
+ * Deletes the given WorldAnalytics.
+ *
+ * @param analytics A pointer to a WorldAnalytics.
+ */
+void del_world_analytics(struct WorldAnalytics *analytics) {
+    free(analytics->betweenness);
+    free(analytics);
+}
+
+/*
+ * Writes a string as a JSON string literal.
+ */
+static void write_json_string(FILE *out, const char *value) {
+    fputc('"', out);
+
+    for (; *value != '\0'; ++value) {
+        if (*value == '"' || *value == '\\') {
+            fprintf(out, "\\%c", *value);
+        } else if ((unsigned char) *value < 0x20) {
+            fprintf(out, "\\u%04x", (unsigned char) *value);
+        } else {
+            fputc(*value, out);
+        }
+    }
+
+    fputc('"', out);
+}
+
+/*
+ * Writes a size as a JSON number, or null for ANALYTICS_NONE.
+ */
+static void write_json_size(FILE *out, const size_t value) {
+    if (value == ANALYTICS_NONE) {
+        fputs("null", out);
+    } else {
+        fprintf(out, "%zu", value);
+    }
+}
+
+/*
+ * Writes the given WorldAnalytics as one JSON object, followed by a newline,
+ * so that the reports of several worlds can be collected line by line.
+ *
+ * @param out The stream to write to.
+ * @param analytics A pointer to a WorldAnalytics.
+ */
+void write_analytics_json(FILE *out, const struct WorldAnalytics *analytics) {
+    size_t i;
+
+    fprintf(out, "{\"rooms\": %zu, \"connections\": %zu, \"connected\": %s, "
+            "\"exact\": %s, \"sources\": %zu, \"threads\": %zu, ",
+            analytics->num_rooms, analytics->num_connections,
+            analytics->connected ? "true" : "false",
+            analytics->exact ? "true" : "false", analytics->num_sources,
+            analytics->num_threads);
+    fputs("\"diameter\": ", out);
+    write_json_size(out, analytics->diameter);
+    fputs(", \"diameter_upper_bound\": ", out);
+    write_json_size(out, analytics->diameter_upper_bound);
+    fputs(", \"start_eccentricity\": ", out);
+    write_json_size(out, analytics->start_eccentricity);
+    fputs(", \"end_eccentricity\": ", out);
+    write_json_size(out, analytics->end_eccentricity);
+    fprintf(out, ", \"mean_clustering\": %.6f, \"transitivity\": %.6f, "
+            "\"chokepoints\": [", analytics->mean_clustering,
+            analytics->transitivity);
+
+    for (i = 0; i < analytics->num_top_rooms; ++i) {
+        fputs(i == 0 ? "{\"room\": " : ", {\"room\": ", out);
+        write_json_string(out, analytics->top_room_names[i]);
+        fprintf(out, ", \"betweenness\": %.6f}",
+                analytics->betweenness[analytics->top_rooms[i]]);
+    }
+
+    fprintf(out, "], \"seconds\": {\"index\": %.6f, \"eccentricity\": %.6f, "
+            "\"sweep\": %.6f, \"clustering\": %.6f, \"total\": %.6f}}\n",
+            analytics->index_seconds, analytics->eccentricity_seconds,
+            analytics->sweep_seconds, analytics->clustering_seconds,
+            analytics->total_seconds);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void analyze_world_when_cycle_should_find_exact_distances(CuTest *tc) {
+    // Given a cycle of 20 rooms, where START_ROOM and END_ROOM are opposite
+    struct RoomList *world = new_circulant_world(20, 2);
+    struct AnalyticsOptions options;
+    size_t i;
+
+    default_analytics_options(&options);
+    options.num_threads = 3;
+
+    // When
+    struct WorldAnalytics *analytics = analyze_world(world, &options);
+
+    // Then
+    CuAssertIntEquals(tc, true, analytics->exact);
+    CuAssertIntEquals(tc, true, analytics->connected);
+    CuAssertIntEquals(tc, 20, analytics->num_connections);
+    CuAssertIntEquals(tc, 10, analytics->diameter);
+    CuAssertIntEquals(tc, 10, analytics->start_eccentricity);
+    CuAssertIntEquals(tc, 10, analytics->end_eccentricity);
+    CuAssertDblEquals(tc, 0, analytics->mean_clustering, 1e-9);
+
+    // Every room of a cycle is as central as any other
+    for (i = 1; i < 20; ++i) {
+        CuAssertDblEquals(tc, analytics->betweenness[0],
+                analytics->betweenness[i], 1e-9);
+    }
+
+    // Clean up
+    del_world_analytics(analytics);
+    del_world(world);
+}
+
+void analyze_world_when_circulant_should_find_clustering(CuTest *tc) {
+    // Given rooms connected to the two rooms on either side, so that three of
+    // the six pairs of neighbours of every room are connected
+    struct RoomList *world = new_circulant_world(30, 4);
+
+    // When
+    struct WorldAnalytics *analytics = analyze_world(world, NULL);
+
+    // Then
+    CuAssertDblEquals(tc, 0.5, analytics->mean_clustering, 1e-9);
+    CuAssertDblEquals(tc, 0.5, analytics->transitivity, 1e-9);
+
+    // Clean up
+    del_world_analytics(analytics);
+    del_world(world);
+}
+
+void analyze_world_should_find_bridge_as_chokepoint(CuTest *tc) {
+    // Given two groups of four fully connected rooms joined through a bridge
+    struct RoomList *world = new_room_list();
+    struct Room *rooms[9];
+    char name[16];
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < 9; ++i) {
+        snprintf(name, sizeof(name), "Room %zu", i);
+        rooms[i] = new_room(name, i == 0 ? START_ROOM
+                : (i == 8 ? END_ROOM : MID_ROOM));
+        add_room(world, rooms[i]);
+    }
+
+    for (i = 0; i < 4; ++i) {
+        for (j = i + 1; j < 4; ++j) {
+            add_connection(rooms[i], rooms[j]);
+            add_connection(rooms[5 + i], rooms[5 + j]);
+        }
+    }
+
+    add_connection(rooms[3], rooms[4]);
+    add_connection(rooms[4], rooms[5]);
+
+    // When
+    struct WorldAnalytics *analytics = analyze_world(world, NULL);
+    FILE *file = tmpfile();
+    char json[1024];
+
+    write_analytics_json(file, analytics);
+    rewind(file);
+    CuAssertPtrNotNull(tc, fgets(json, sizeof(json), file));
+
+    // Then
+    CuAssertIntEquals(tc, 4, analytics->top_rooms[0]);
+    CuAssertStrEquals(tc, "Room 4", analytics->top_room_names[0]);
+    CuAssertIntEquals(tc, 4, analytics->diameter);
+    CuAssertIntEquals(tc, 4, analytics->start_eccentricity);
+    // 16 of the 28 pairs of other rooms have every shortest path through it
+    CuAssertDblEquals(tc, 16.0 / 28, analytics->betweenness[4], 1e-9);
+    CuAssertPtrNotNull(tc, strstr(json, "\"chokepoints\": [{\"room\": "
+                "\"Room 4\""));
+    CuAssertPtrNotNull(tc, strstr(json, "\"diameter\": 4,"));
+
+    // Clean up
+    fclose(file);
+    del_world_analytics(analytics);
+    del_world(world);
+}
+
+void analyze_world_when_sampled_should_estimate_betweenness(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_random_world(1500, 3, 44);
+    struct AnalyticsOptions options;
+
+    default_analytics_options(&options);
+    struct WorldAnalytics *exact = analyze_world(world, &options);
+    options.exact_limit = 0;
+    options.max_error = 0.1;
+
+    // When
+    struct WorldAnalytics *sampled = analyze_world(world, &options);
+
+    // Then
+    double max_difference = 0;
+    size_t i;
+
+    for (i = 0; i < 1500; ++i) {
+        const double difference = sampled->betweenness[i]
+            - exact->betweenness[i];
+
+        if (difference > max_difference || -difference > max_difference) {
+            max_difference = difference > 0 ? difference : -difference;
+        }
+    }
+
+    CuAssertIntEquals(tc, false, sampled->exact);
+    CuAssertTrue(tc, sampled->num_sources < 1500);
+    CuAssertTrue(tc, max_difference < 0.1);
+    CuAssertTrue(tc, sampled->diameter <= exact->diameter);
+    CuAssertTrue(tc, sampled->diameter_upper_bound >= exact->diameter);
+    CuAssertIntEquals(tc, exact->start_eccentricity,
+            sampled->start_eccentricity);
+
+    // Clean up
+    del_world_analytics(sampled);
+    del_world_analytics(exact);
+    del_world(world);
+}
+
+CuSuite *get_world_analytics_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, analyze_world_when_cycle_should_find_exact_distances);
+    SUITE_ADD_TEST(suite, analyze_world_when_circulant_should_find_clustering);
+    SUITE_ADD_TEST(suite, analyze_world_should_find_bridge_as_chokepoint);
+    SUITE_ADD_TEST(suite, analyze_world_when_sampled_should_estimate_betweenness);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+void run_world_analytics_benchmark() {
+    const size_t sizes[] = { 2000, 20000 };
+    struct AnalyticsOptions options;
+    size_t s;
+
+    default_analytics_options(&options);
+    options.max_error = 0.1;
+
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        struct RoomList *world = new_random_world(sizes[s], 3, sizes[s]);
+        const size_t thread_counts[] = { 1, 0 };
+        size_t t;
+
+        for (t = 0; t < 2; ++t) {
+            options.num_threads = thread_counts[t];
+
+            struct WorldAnalytics *analytics = analyze_world(world, &options);
+
+            printf("world_analytics: ");
+            write_analytics_json(stdout, analytics);
+            del_world_analytics(analytics);
+        }
+
+        del_world(world);
+    }
+}
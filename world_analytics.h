@@ -0,0 +1,81 @@
+#ifndef WORLD_ANALYTICS_H
+#define WORLD_ANALYTICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "room.h"
+#include "room_list.h"
+
+/*
+ * Graph analytics for grading generated worlds: diameter, the eccentricity of
+ * the START_ROOM and END_ROOM, betweenness centrality to find chokepoint rooms
+ * and clustering coefficients. Everything is computed over a RoomIndex with
+ * breadth-first searches spread over worker threads.
+ */
+
+/*
+ * The value reported for a room or eccentricity that does not exist.
+ */
+#define ANALYTICS_NONE ((size_t) -1)
+
+/*
+ * The number of chokepoint rooms an analysis reports.
+ */
+#define ANALYTICS_TOP_ROOMS 5
+
+/*
+ * A structure that stores how an analysis is run. Worlds of at most
+ * exact_limit rooms are analysed exactly, with a search from every room.
+ * Larger worlds search from a random sample of rooms, sized so that every
+ * normalised betweenness is within max_error of its exact value with 90%
+ * confidence; the diameter is then bracketed rather than exact.
+ */
+struct AnalyticsOptions {
+    size_t num_threads;
+    size_t exact_limit;
+    double max_error;
+    uint64_t seed;
+};
+
+/*
+ * A structure that stores the outcome of analyze_world.
+ *
+ * diameter is exact for exact analyses and otherwise a lower bound, with
+ * diameter_upper_bound an upper bound; both only cover connected worlds.
+ * betweenness[i] is the normalised betweenness of room i in RoomList order.
+ */
+struct WorldAnalytics {
+    size_t num_rooms;
+    size_t num_connections;
+    bool connected;
+    bool exact;
+    size_t num_sources;
+    size_t diameter;
+    size_t diameter_upper_bound;
+    size_t start_eccentricity;
+    size_t end_eccentricity;
+    double mean_clustering;
+    double transitivity;
+    double *betweenness;
+    size_t num_top_rooms;
+    size_t top_rooms[ANALYTICS_TOP_ROOMS];
+    const char *top_room_names[ANALYTICS_TOP_ROOMS];
+    size_t num_threads;
+    double index_seconds;
+    double eccentricity_seconds;
+    double sweep_seconds;
+    double clustering_seconds;
+    double total_seconds;
+};
+
+void default_analytics_options(struct AnalyticsOptions *options);
+
+struct WorldAnalytics *analyze_world(const struct RoomList *world,
+        const struct AnalyticsOptions *options);
+
+void del_world_analytics(struct WorldAnalytics *analytics);
+
+void write_analytics_json(FILE *out, const struct WorldAnalytics *analytics);
+
+#endif
@@ -0,0 +1,586 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "world.h"
+#include "world_cache.h"
+#include "world_codec.h"
+#include "world_generator.h"
+#include "CuTest.h"
+
+static const char WORLD_SUFFIX[] = ".world";
+
+/*
+ * How old, in seconds, a temporary file must be before trim_world_cache takes
+ * it for the leftover of a crashed writer and deletes it.
+ */
+#define STALE_TEMP_SECONDS 600
+
+struct WorldCache {
+    char *dir;
+    size_t max_bytes;
+    struct WorldCacheStats stats;
+};
+
+/*
+ * A file in the cache, as seen by trim_world_cache.
+ */
+struct CacheEntry {
+    char *path;
+    size_t size;
+    struct timespec used;
+};
+
+/*
+ * Builds the path of the cached world generated by new_random_world from the
+ * given parameters and seed.
+ */
+static void random_world_path(const char *dir, const size_t num_rooms,
+        const size_t min_connections, const uint64_t seed, char *path,
+        const size_t size) {
+    snprintf(path, size, "%s/random-v%d-%zu-%zu-%llu%s", dir,
+            WORLD_GENERATOR_VERSION, num_rooms, min_connections,
+            (unsigned long long) seed, WORLD_SUFFIX);
+}
+
+/*
+ * Reads the world at path and marks it used. Returns NULL if there is no such
+ * file or it is malformed.
+ */
+static struct RoomList *load_cached_world(const char *path) {
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    struct RoomList *world = read_compact_world(file);
+
+    if (world != NULL) {
+        futimens(fileno(file), NULL);
+    }
+
+    fclose(file);
+
+    return world;
+}
+
+/*
+ * Generates the world new_random_world builds from the given parameters and
+ * seed and encodes it into data. The world returned is the one read back from
+ * data, so it is identical to the world a later load of data returns, down to
+ * the order of the connections. Returns NULL, and leaves data NULL, if the
+ * world cannot be generated.
+ */
+static struct RoomList *new_encoded_world(const size_t num_rooms,
+        const size_t min_connections, const uint64_t seed, char **data,
+        size_t *size) {
+    struct RoomList *generated = new_random_world(num_rooms, min_connections,
+            seed);
+
+    if (generated == NULL) {
+        return NULL;
+    }
+
+    FILE *out = open_memstream(data, size);
+
+    write_compact_world(out, generated, false);
+    fclose(out);
+    del_world(generated);
+
+    FILE *in = fmemopen(*data, *size, "r");
+    struct RoomList *world = read_compact_world(in);
+
+    fclose(in);
+
+    return world;
+}
+
+/*
+ * Publishes an encoded world at path. It is written to a temporary file of
+ * this process, hidden from readers and trim_world_cache by its leading dot,
+ * and then renamed into place, which replaces any copy another process
+ * published meanwhile with an identical one.
+ */
+static bool store_cached_world(const char *dir, const char *path,
+        const char *data, const size_t size) {
+    const char *name = strrchr(path, '/') + 1;
+    char temp_path[4096];
+
+    snprintf(temp_path, sizeof(temp_path), "%s/.%s.XXXXXX", dir, name);
+
+    const int fd = mkstemp(temp_path);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    bool ok = write(fd, data, size) == (ssize_t) size;
+
+    ok = close(fd) == 0 && ok;
+    ok = ok && chmod(temp_path, 0644) == 0 && rename(temp_path, path) == 0;
+
+    if (!ok) {
+        unlink(temp_path);
+    }
+
+    return ok;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const struct CacheEntry *x = (const struct CacheEntry*) a;
+    const struct CacheEntry *y = (const struct CacheEntry*) b;
+
+    if (x->used.tv_sec != y->used.tv_sec) {
+        return x->used.tv_sec < y->used.tv_sec ? -1 : 1;
+    }
+
+    return (x->used.tv_nsec > y->used.tv_nsec)
+        - (x->used.tv_nsec < y->used.tv_nsec);
+}
+
+/*
+ * Constructs a new WorldCache over dir, creating the directory if needed.
+ * Several caches, in one process or many, may share a directory.
+ *
+ * @param dir The directory to keep cached worlds in.
+ * @param max_bytes The size the cached worlds are trimmed back to.
+ * @return A pointer to a new WorldCache or NULL if dir cannot be created.
+ */
+struct WorldCache *new_world_cache(const char *dir, const size_t max_bytes) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return NULL;
+    }
+
+    struct WorldCache *cache = (struct WorldCache*) calloc(1,
+            sizeof(struct WorldCache));
+
+    cache->dir = new_str_from(dir);
+    cache->max_bytes = max_bytes;
+
+    return cache;
+}
+
+/*
+ * Deletes the given WorldCache. The cached worlds stay on disk.
+ *
+ * @param cache A pointer to a WorldCache.
+ */
+void del_world_cache(struct WorldCache *cache) {
+    free(cache->dir);
+    free(cache);
+}
+
+/*
+ * Returns the world new_random_world builds from the given parameters and
+ * seed, loaded from the cache if it holds it and otherwise generated and then
+ * published to the cache. A cached file that is malformed, say after a crash
+ * lost its contents, is generated and published again.
+ *
+ * Generated worlds go through the compact encoding before they are returned,
+ * so that whether or not the cache held it, and with or without a cache, the
+ * world comes back the same, with the connections sorted by room id as
+ * read_compact_world leaves them.
+ *
+ * @param cache A pointer to a WorldCache, or NULL to always generate.
+ * @param num_rooms The number of rooms.
+ * @param min_connections The fewest connections of any room.
+ * @param seed The seed of the world.
+ * @return A pointer to a new world or NULL if new_random_world cannot meet
+ * the bounds, in which case nothing is cached.
+ */
+struct RoomList *cached_random_world(struct WorldCache *cache,
+        const size_t num_rooms, const size_t min_connections,
+        const uint64_t seed) {
+    char *data = NULL;
+    size_t size = 0;
+    struct RoomList *world;
+
+    if (cache == NULL) {
+        world = new_encoded_world(num_rooms, min_connections, seed, &data,
+                &size);
+        free(data);
+
+        return world;
+    }
+
+    char path[4096];
+    double start = now_seconds();
+
+    random_world_path(cache->dir, num_rooms, min_connections, seed, path,
+            sizeof(path));
+
+    world = load_cached_world(path);
+
+    if (world != NULL) {
+        cache->stats.hits++;
+        cache->stats.load_seconds += now_seconds() - start;
+
+        return world;
+    }
+
+    cache->stats.misses++;
+    start = now_seconds();
+    world = new_encoded_world(num_rooms, min_connections, seed, &data, &size);
+
+    if (world != NULL && store_cached_world(cache->dir, path, data, size)) {
+        cache->stats.stores++;
+        trim_world_cache(cache);
+    }
+
+    free(data);
+
+    cache->stats.generate_seconds += now_seconds() - start;
+
+    return world;
+}
+
+/*
+ * Deletes the least recently used worlds until the cache is within its size
+ * limit, along with stale temporary files left by crashed writers. A process
+ * still reading a deleted world keeps reading it unharmed.
+ *
+ * @param cache A pointer to a WorldCache.
+ * @return The number of worlds deleted.
+ */
+size_t trim_world_cache(struct WorldCache *cache) {
+    const size_t suffix_length = strlen(WORLD_SUFFIX);
+    DIR *handle = opendir(cache->dir);
+
+    if (handle == NULL) {
+        return 0;
+    }
+
+    size_t capacity = 64;
+    size_t num_entries = 0;
+    size_t total = 0;
+    struct CacheEntry *entries = (struct CacheEntry*) malloc(capacity
+            * sizeof(struct CacheEntry));
+    const struct dirent *entry;
+    char path[4096];
+    struct stat info;
+    const time_t now = time(NULL);
+
+    while ((entry = readdir(handle)) != NULL) {
+        const size_t length = strlen(entry->d_name);
+
+        snprintf(path, sizeof(path), "%s/%s", cache->dir, entry->d_name);
+
+        if (entry->d_name[0] == '.') {
+            if (strstr(entry->d_name, WORLD_SUFFIX) != NULL
+                    && stat(path, &info) == 0
+                    && now - info.st_mtime > STALE_TEMP_SECONDS) {
+                unlink(path);
+            }
+
+            continue;
+        }
+
+        if (length <= suffix_length || strcmp(entry->d_name + length
+                    - suffix_length, WORLD_SUFFIX) != 0
+                || stat(path, &info) != 0) {
+            continue;
+        }
+
+        if (num_entries == capacity) {
+            capacity *= 2;
+            entries = (struct CacheEntry*) realloc(entries, capacity
+                    * sizeof(struct CacheEntry));
+        }
+
+        entries[num_entries].path = new_str_from(path);
+        entries[num_entries].size = info.st_size;
+        entries[num_entries].used = info.st_mtim;
+        total += info.st_size;
+        ++num_entries;
+    }
+
+    closedir(handle);
+    qsort(entries, num_entries, sizeof(struct CacheEntry), compare_entries);
+
+    size_t evicted = 0;
+    size_t i;
+
+    for (i = 0; i < num_entries; ++i) {
+        // Another process may have deleted the file first
+        if (total > cache->max_bytes) {
+            evicted += unlink(entries[i].path) == 0;
+            total -= entries[i].size;
+        }
+
+        free(entries[i].path);
+    }
+
+    free(entries);
+    cache->stats.evictions += evicted;
+
+    return evicted;
+}
+
+/*
+ * Copies the counters of a WorldCache.
+ *
+ * @param cache A pointer to a WorldCache.
+ * @param stats A pointer to the WorldCacheStats to fill in.
+ */
+void world_cache_stats(const struct WorldCache *cache,
+        struct WorldCacheStats *stats) {
+    *stats = cache->stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Returns the size of the file at path, or 0 if there is none.
+ */
+static size_t file_size(const char *path) {
+    struct stat info;
+
+    return stat(path, &info) == 0 ? (size_t) info.st_size : 0;
+}
+
+/*
+ * Sets the time a file was last used.
+ */
+static void set_used_time(const char *path, const time_t seconds) {
+    struct timespec times[2];
+
+    times[0].tv_sec = seconds;
+    times[0].tv_nsec = 0;
+    times[1] = times[0];
+    utimensat(AT_FDCWD, path, times, 0);
+}
+
+/*
+ * Asserts that two worlds have the same rooms and connections, both in the
+ * same order.
+ */
+static void assert_identical_world(CuTest *tc,
+        const struct RoomList *expected, const struct RoomList *actual) {
+    const struct RoomLink *curr;
+    const struct RoomLink *other;
+    size_t i;
+
+    assert_same_world(tc, expected, actual);
+
+    for (curr = actual->head, other = expected->head; curr != NULL;
+            curr = curr->next, other = other->next) {
+        for (i = 0; i < curr->room->num_connections; ++i) {
+            CuAssertStrEquals(tc, other->room->connections[i]->name,
+                    curr->room->connections[i]->name);
+        }
+    }
+}
+
+void cached_random_world_should_load_world_it_generated(CuTest *tc) {
+    // Given
+    char dir[64];
+    char path[4096];
+    test_path(dir, sizeof(dir), "world_cache_test", "");
+    struct WorldCache *cache = new_world_cache(dir, 1 << 20);
+    struct RoomList *expected = new_random_world(200, 3, 7);
+    struct WorldCacheStats stats;
+
+    // When
+    struct RoomList *generated = cached_random_world(cache, 200, 3, 7);
+    struct RoomList *loaded = cached_random_world(cache, 200, 3, 7);
+    struct RoomList *uncached = cached_random_world(NULL, 200, 3, 7);
+
+    // Then
+    random_world_path(dir, 200, 3, 7, path, sizeof(path));
+    world_cache_stats(cache, &stats);
+    CuAssertTrue(tc, file_size(path) > 0);
+    CuAssertIntEquals(tc, 1, stats.misses);
+    CuAssertIntEquals(tc, 1, stats.hits);
+    CuAssertIntEquals(tc, 1, stats.stores);
+    assert_same_world(tc, expected, generated);
+    assert_identical_world(tc, generated, loaded);
+    assert_identical_world(tc, generated, uncached);
+
+    // Clean up
+    del_world(uncached);
+    del_world(loaded);
+    del_world(generated);
+    del_world(expected);
+    del_world_cache(cache);
+    remove_dir(dir);
+}
+
+void cached_random_world_should_key_by_parameters_and_seed(CuTest *tc) {
+    // Given
+    char dir[64];
+    test_path(dir, sizeof(dir), "world_cache_test", "");
+    struct WorldCache *cache = new_world_cache(dir, 1 << 20);
+    struct WorldCacheStats stats;
+
+    del_world(cached_random_world(cache, 50, 3, 1));
+
+    // When
+    struct RoomList *other_seed = cached_random_world(cache, 50, 3, 2);
+    struct RoomList *other_size = cached_random_world(cache, 60, 3, 1);
+    struct RoomList *other_min = cached_random_world(cache, 50, 4, 1);
+
+    // Then
+    world_cache_stats(cache, &stats);
+    CuAssertIntEquals(tc, 4, stats.misses);
+    CuAssertIntEquals(tc, 0, stats.hits);
+    CuAssertIntEquals(tc, 60, other_size->size);
+    CuAssertTrue(tc, other_min->tail->room->num_connections >= 4);
+
+    // Clean up
+    del_world(other_min);
+    del_world(other_size);
+    del_world(other_seed);
+    del_world_cache(cache);
+    remove_dir(dir);
+}
+
+void trim_world_cache_should_evict_least_recently_used(CuTest *tc) {
+    // Given a cache with room for about two worlds, holding two
+    char dir[64];
+    char first[4096];
+    char second[4096];
+    char third[4096];
+    test_path(dir, sizeof(dir), "world_cache_test", "");
+    random_world_path(dir, 200, 3, 1, first, sizeof(first));
+    random_world_path(dir, 200, 3, 2, second, sizeof(second));
+    random_world_path(dir, 200, 3, 3, third, sizeof(third));
+
+    struct WorldCache *cache = new_world_cache(dir, 1 << 20);
+    struct WorldCacheStats stats;
+
+    del_world(cached_random_world(cache, 200, 3, 1));
+    del_world(cached_random_world(cache, 200, 3, 2));
+    cache->max_bytes = file_size(first) * 5 / 2;
+    set_used_time(first, 1000);
+    set_used_time(second, 2000);
+
+    // When the first is used again and a third is stored
+    del_world(cached_random_world(cache, 200, 3, 1));
+    del_world(cached_random_world(cache, 200, 3, 3));
+
+    // Then
+    world_cache_stats(cache, &stats);
+    CuAssertIntEquals(tc, 1, stats.evictions);
+    CuAssertTrue(tc, file_size(first) > 0);
+    CuAssertTrue(tc, file_size(second) == 0);
+    CuAssertTrue(tc, file_size(third) > 0);
+
+    // Clean up
+    del_world_cache(cache);
+    remove_dir(dir);
+}
+
+void cached_random_world_when_file_truncated_should_regenerate(CuTest *tc) {
+    // Given a cached world that lost its second half
+    char dir[64];
+    char path[4096];
+    test_path(dir, sizeof(dir), "world_cache_test", "");
+    random_world_path(dir, 200, 3, 9, path, sizeof(path));
+
+    struct WorldCache *cache = new_world_cache(dir, 1 << 20);
+    struct RoomList *expected = new_random_world(200, 3, 9);
+    struct WorldCacheStats stats;
+
+    del_world(cached_random_world(cache, 200, 3, 9));
+    const size_t size = file_size(path);
+    CuAssertIntEquals(tc, 0, truncate(path, size / 2));
+
+    // When
+    struct RoomList *world = cached_random_world(cache, 200, 3, 9);
+
+    // Then
+    world_cache_stats(cache, &stats);
+    CuAssertIntEquals(tc, 2, stats.misses);
+    CuAssertIntEquals(tc, 2, stats.stores);
+    CuAssertIntEquals(tc, size, file_size(path));
+    assert_same_world(tc, expected, world);
+
+    // Clean up
+    del_world(world);
+    del_world(expected);
+    del_world_cache(cache);
+    remove_dir(dir);
+}
+
+void cached_random_world_when_bounds_infeasible_should_return_null(
+        CuTest *tc) {
+    // Given
+    char dir[64];
+    char path[4096];
+    test_path(dir, sizeof(dir), "world_cache_test", "");
+    random_world_path(dir, 10, 7, 1, path, sizeof(path));
+
+    struct WorldCache *cache = new_world_cache(dir, 1 << 20);
+    struct WorldCacheStats stats;
+
+    // When
+    struct RoomList *cached = cached_random_world(cache, 10, 7, 1);
+    struct RoomList *uncached = cached_random_world(NULL, 1, 2, 1);
+
+    // Then
+    world_cache_stats(cache, &stats);
+    CuAssertPtrEquals(tc, NULL, cached);
+    CuAssertPtrEquals(tc, NULL, uncached);
+    CuAssertIntEquals(tc, 0, stats.stores);
+    CuAssertTrue(tc, file_size(path) == 0);
+
+    // Clean up
+    del_world_cache(cache);
+    remove_dir(dir);
+}
+
+CuSuite *get_world_cache_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, cached_random_world_should_load_world_it_generated);
+    SUITE_ADD_TEST(suite, cached_random_world_should_key_by_parameters_and_seed);
+    SUITE_ADD_TEST(suite, trim_world_cache_should_evict_least_recently_used);
+    SUITE_ADD_TEST(suite, cached_random_world_when_file_truncated_should_regenerate);
+    SUITE_ADD_TEST(suite, cached_random_world_when_bounds_infeasible_should_return_null);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+void run_world_cache_benchmark() {
+    const char *dir = "/tmp/world_cache_benchmark";
+    const size_t sizes[] = { 1000, 10000, 100000 };
+    size_t s;
+
+    remove_dir(dir);
+
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        struct WorldCache *cache = new_world_cache(dir, (size_t) 1 << 30);
+        double start = now_seconds();
+
+        // Uncached, cold and warm game starts
+        del_world(cached_random_world(NULL, sizes[s], 3, 1));
+        const double uncached = now_seconds() - start;
+
+        start = now_seconds();
+        del_world(cached_random_world(cache, sizes[s], 3, 1));
+        const double cold = now_seconds() - start;
+
+        start = now_seconds();
+        del_world(cached_random_world(cache, sizes[s], 3, 1));
+        const double warm = now_seconds() - start;
+
+        printf("world_cache: %6zu rooms: uncached %.4f s, cold %.4f s, "
+                "warm %.4f s (%.1fx)\n", sizes[s], uncached, cold, warm,
+                uncached / warm);
+        del_world_cache(cache);
+    }
+
+    remove_dir(dir);
+}
@@ -0,0 +1,47 @@
+#ifndef WORLD_CACHE_H
+#define WORLD_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "room.h"
+#include "room_list.h"
+
+/*
+ * An on-disk cache of generated worlds, so that a game start can load the
+ * world another session already generated from the same parameters and seed
+ * instead of building it again. Each world is one file in the compact
+ * encoding, named after the generator version, the parameters and the seed,
+ * and can be shared by any number of processes.
+ *
+ * A world is published by writing a temporary file of its own and renaming it
+ * into place, so readers see either no file or a complete one. When the cache
+ * grows past its size limit the least recently used files, by modification
+ * time, are deleted; a hit refreshes the time of its file.
+ */
+
+/*
+ * A structure that stores the counters of a WorldCache.
+ */
+struct WorldCacheStats {
+    size_t hits;
+    size_t misses;
+    size_t stores;
+    size_t evictions;
+    double load_seconds;
+    double generate_seconds;
+};
+
+struct WorldCache *new_world_cache(const char *dir, const size_t max_bytes);
+
+void del_world_cache(struct WorldCache *cache);
+
+struct RoomList *cached_random_world(struct WorldCache *cache,
+        const size_t num_rooms, const size_t min_connections,
+        const uint64_t seed);
+
+size_t trim_world_cache(struct WorldCache *cache);
+
+void world_cache_stats(const struct WorldCache *cache,
+        struct WorldCacheStats *stats);
+
+#endif
@@ -0,0 +1,1200 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "room_index.h"
+#include "utils.h"
+#include "world.h"
+#include "world_codec.h"
+#include "world_generator.h"
+#include "CuTest.h"
+
+static const char CODEC_MAGIC[4] = { 'Z', 'C', 'W', 'F' };
+static const uint8_t CODEC_VERSION = 2;
+
+/*
+ * The longest room name the compact encoding stores.
+ */
+#define CODEC_MAX_NAME_LENGTH 65535
+
+/*
+ * The bit of a room's type byte that marks a hub, whose maximum number of
+ * connections follows as a varint.
+ */
+#define CODEC_HUB_FLAG 0x80
+
+/*
+ * The number of bytes of the stream each block holds before compression.
+ */
+#define CODEC_BLOCK_SIZE 65536
+
+/*
+ * How a block is stored.
+ */
+typedef enum { BLOCK_STORED, BLOCK_LZ } block_t;
+
+/*
+ * The number of bits of the LZ77 match finder's hash table.
+ */
+#define LZ_HASH_BITS 14
+
+/*
+ * The shortest match the LZ77 codec encodes.
+ */
+#define LZ_MIN_MATCH 4
+
+/*
+ * A structure that buffers the stream being written into blocks.
+ */
+struct BlockWriter {
+    FILE *out;
+    bool compress;
+    bool ok;
+    size_t size;
+    uint8_t *block;
+    uint8_t *scratch;
+    uint32_t *table;
+};
+
+/*
+ * A structure that reads the stream back block by block.
+ */
+struct BlockReader {
+    FILE *in;
+    bool ok;
+    size_t size;
+    size_t position;
+    uint8_t *block;
+    uint8_t *scratch;
+};
+
+static size_t put_varint_at(uint8_t *buffer, uint64_t value) {
+    size_t size = 0;
+
+    while (value >= 0x80) {
+        buffer[size++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+
+    buffer[size++] = (uint8_t) value;
+
+    return size;
+}
+
+/*
+ * Reads a varint from buffer[*position] onwards without going past size.
+ */
+static bool get_varint_at(const uint8_t *buffer, const size_t size,
+        size_t *position, uint64_t *value) {
+    unsigned shift;
+
+    *value = 0;
+
+    for (shift = 0; shift < 64 && *position < size; shift += 7) {
+        const uint8_t byte = buffer[(*position)++];
+
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/*
+ * Compresses src into dst as a sequence of (literal run, match) pairs, each a
+ * varint literal count, the literals, a varint match length less
+ * LZ_MIN_MATCH and a varint distance. The last pair has literals only. Short
+ * matches at long distances can take more bytes than they save, so the output
+ * is not bounded by the input; compression gives up rather than write more
+ * than capacity bytes.
+ *
+ * @return The compressed size, or 0 if it would exceed capacity.
+ */
+static size_t lz_compress(const uint8_t *src, const size_t size, uint8_t *dst,
+        const size_t capacity, uint32_t *table) {
+    size_t anchor = 0;
+    size_t out = 0;
+    size_t i = 0;
+
+    memset(table, 0, sizeof(uint32_t) << LZ_HASH_BITS);
+
+    while (i + LZ_MIN_MATCH <= size) {
+        const uint32_t word = read_u32(src + i);
+        const uint32_t hash = (word * 2654435761u) >> (32 - LZ_HASH_BITS);
+        const size_t candidate = table[hash];
+
+        table[hash] = (uint32_t) i + 1;
+
+        if (candidate == 0 || read_u32(src + candidate - 1) != word) {
+            ++i;
+            continue;
+        }
+
+        const size_t match = candidate - 1;
+        size_t length = LZ_MIN_MATCH;
+
+        // The pair is at most three varints of 10 bytes and the literals
+        if (out + 3 * 10 + (i - anchor) > capacity) {
+            return 0;
+        }
+
+        while (i + length < size && src[match + length] == src[i + length]) {
+            ++length;
+        }
+
+        out += put_varint_at(dst + out, i - anchor);
+        memcpy(dst + out, src + anchor, i - anchor);
+        out += i - anchor;
+        out += put_varint_at(dst + out, length - LZ_MIN_MATCH);
+        out += put_varint_at(dst + out, i - match);
+        i += length;
+        anchor = i;
+    }
+
+    if (out + 10 + (size - anchor) > capacity) {
+        return 0;
+    }
+
+    out += put_varint_at(dst + out, size - anchor);
+    memcpy(dst + out, src + anchor, size - anchor);
+
+    return out + size - anchor;
+}
+
+/*
+ * Decompresses exactly size bytes from src into dst. Returns false on
+ * corrupt input.
+ */
+static bool lz_decompress(const uint8_t *src, const size_t src_size,
+        uint8_t *dst, const size_t size) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (true) {
+        uint64_t literals;
+        uint64_t length;
+        uint64_t distance;
+
+        if (!get_varint_at(src, src_size, &in, &literals)
+                || literals > size - out || literals > src_size - in) {
+            return false;
+        }
+
+        memcpy(dst + out, src + in, literals);
+        in += literals;
+        out += literals;
+
+        if (out == size) {
+            return in == src_size;
+        }
+
+        if (!get_varint_at(src, src_size, &in, &length)
+                || !get_varint_at(src, src_size, &in, &distance)
+                || distance == 0 || distance > out
+                || size - out < LZ_MIN_MATCH
+                || length > size - out - LZ_MIN_MATCH) {
+            return false;
+        }
+
+        // Matches may overlap the bytes they produce, so copy one at a time
+        for (length += LZ_MIN_MATCH; length > 0; --length, ++out) {
+            dst[out] = dst[out - distance];
+        }
+    }
+}
+
+static void init_block_writer(struct BlockWriter *writer, FILE *out,
+        const bool compress) {
+    writer->out = out;
+    writer->compress = compress;
+    writer->ok = true;
+    writer->size = 0;
+    writer->block = (uint8_t*) malloc(CODEC_BLOCK_SIZE);
+    writer->scratch = (uint8_t*) malloc(CODEC_BLOCK_SIZE);
+    writer->table = compress
+        ? (uint32_t*) malloc(sizeof(uint32_t) << LZ_HASH_BITS) : NULL;
+}
+
+/*
+ * Writes out the buffered bytes as one block: a type byte, the varint size
+ * of the block and, if compressed, the varint size of the compressed data.
+ */
+static void flush_block(struct BlockWriter *writer) {
+    uint8_t header[1 + 2 * 10];
+    size_t header_size = 1;
+    const uint8_t *data = writer->block;
+    size_t data_size = writer->size;
+
+    header[0] = BLOCK_STORED;
+
+    if (writer->compress && writer->size > 0) {
+        // Blocks that do not shrink are stored as they are
+        const size_t compressed = lz_compress(writer->block, writer->size,
+                writer->scratch, writer->size, writer->table);
+
+        if (compressed > 0 && compressed < writer->size) {
+            header[0] = BLOCK_LZ;
+            data = writer->scratch;
+            data_size = compressed;
+        }
+    }
+
+    header_size += put_varint_at(header + header_size, writer->size);
+
+    if (header[0] == BLOCK_LZ) {
+        header_size += put_varint_at(header + header_size, data_size);
+    }
+
+    writer->ok = writer->ok
+        && fwrite(header, 1, header_size, writer->out) == header_size
+        && fwrite(data, 1, data_size, writer->out) == data_size;
+    writer->size = 0;
+}
+
+static void put_byte(struct BlockWriter *writer, const uint8_t byte) {
+    if (writer->size == CODEC_BLOCK_SIZE) {
+        flush_block(writer);
+    }
+
+    writer->block[writer->size++] = byte;
+}
+
+static void put_bytes(struct BlockWriter *writer, const char *bytes,
+        size_t size) {
+    while (size-- > 0) {
+        put_byte(writer, (uint8_t) *bytes++);
+    }
+}
+
+static void put_varint(struct BlockWriter *writer, uint64_t value) {
+    while (value >= 0x80) {
+        put_byte(writer, (uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+
+    put_byte(writer, (uint8_t) value);
+}
+
+/*
+ * Flushes the last block, ends the stream with an empty block and frees the
+ * buffers. Returns whether everything was written.
+ */
+static bool finish_block_writer(struct BlockWriter *writer) {
+    if (writer->size > 0) {
+        flush_block(writer);
+    }
+
+    flush_block(writer);
+    free(writer->table);
+    free(writer->scratch);
+    free(writer->block);
+
+    return writer->ok;
+}
+
+static void init_block_reader(struct BlockReader *reader, FILE *in) {
+    reader->in = in;
+    reader->ok = true;
+    reader->size = 0;
+    reader->position = 0;
+    reader->block = (uint8_t*) malloc(CODEC_BLOCK_SIZE);
+    reader->scratch = (uint8_t*) malloc(CODEC_BLOCK_SIZE
+            + CODEC_BLOCK_SIZE / 64 + 16);
+}
+
+static void del_block_reader(struct BlockReader *reader) {
+    free(reader->scratch);
+    free(reader->block);
+}
+
+static bool read_file_varint(FILE *in, uint64_t *value) {
+    unsigned shift;
+    int byte;
+
+    *value = 0;
+
+    for (shift = 0; shift < 64 && (byte = fgetc(in)) != EOF; shift += 7) {
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Reads the next block. The empty block that ends the stream, like any
+ * corrupt block, leaves the reader failed.
+ */
+static bool refill_block(struct BlockReader *reader) {
+    const int type = fgetc(reader->in);
+    uint64_t size;
+    uint64_t stored_size;
+
+    reader->ok = reader->ok && (type == BLOCK_STORED || type == BLOCK_LZ)
+        && read_file_varint(reader->in, &size)
+        && size > 0 && size <= CODEC_BLOCK_SIZE;
+
+    if (reader->ok && type == BLOCK_STORED) {
+        reader->ok = fread(reader->block, 1, size, reader->in) == size;
+    } else if (reader->ok) {
+        reader->ok = read_file_varint(reader->in, &stored_size)
+            && stored_size <= CODEC_BLOCK_SIZE + CODEC_BLOCK_SIZE / 64 + 16
+            && fread(reader->scratch, 1, stored_size, reader->in)
+                == stored_size
+            && lz_decompress(reader->scratch, stored_size, reader->block,
+                    size);
+    }
+
+    reader->size = reader->ok ? size : 0;
+    reader->position = 0;
+
+    return reader->ok;
+}
+
+static bool get_byte(struct BlockReader *reader, uint8_t *byte) {
+    if (reader->position == reader->size && !refill_block(reader)) {
+        return false;
+    }
+
+    *byte = reader->block[reader->position++];
+
+    return true;
+}
+
+static bool get_varint(struct BlockReader *reader, uint64_t *value) {
+    unsigned shift;
+    uint8_t byte;
+
+    *value = 0;
+
+    for (shift = 0; shift < 64 && get_byte(reader, &byte); shift += 7) {
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Returns whether the stream ends right after the bytes read so far.
+ */
+static bool at_end_of_blocks(struct BlockReader *reader) {
+    return reader->position == reader->size && fgetc(reader->in) == BLOCK_STORED
+        && fgetc(reader->in) == 0;
+}
+
+static int compare_ids(const void *a, const void *b) {
+    const size_t id1 = *(const size_t*) a;
+    const size_t id2 = *(const size_t*) b;
+
+    return id1 < id2 ? -1 : (id1 > id2);
+}
+
+/*
+ * Sorts the given ids, by insertion for ordinary rooms and qsort for hubs.
+ */
+static void sort_ids(size_t *ids, const size_t size) {
+    size_t i;
+    size_t j;
+
+    if (size > ROOM_MAX_CONNECTIONS) {
+        qsort(ids, size, sizeof(size_t), compare_ids);
+        return;
+    }
+
+    for (i = 1; i < size; ++i) {
+        const size_t id = ids[i];
+
+        for (j = i; j > 0 && ids[j - 1] > id; --j) {
+            ids[j] = ids[j - 1];
+        }
+
+        ids[j] = id;
+    }
+}
+
+/*
+ * Writes the given world in the compact encoding. Fails if the world has a
+ * connection to a room outside of it.
+ *
+ * @param out The stream to write to.
+ * @param world A pointer to a RoomList.
+ * @param compress Whether to compress the blocks.
+ * @return Whether the world was written.
+ */
+bool write_compact_world(FILE *out, const struct RoomList *world,
+        const bool compress) {
+    struct RoomIndex *index = new_room_index(world, 1);
+    struct BlockWriter writer;
+    const char *previous = "";
+    size_t capacity = ROOM_MAX_CONNECTIONS;
+    size_t *ids = (size_t*) malloc(capacity * sizeof(size_t));
+    size_t i;
+    size_t j;
+
+    init_block_writer(&writer, out, compress);
+    writer.ok = fwrite(CODEC_MAGIC, 1, sizeof(CODEC_MAGIC), out)
+        == sizeof(CODEC_MAGIC)
+        && fputc(CODEC_VERSION, out) != EOF
+        && fputc(compress, out) != EOF;
+    put_varint(&writer, index->size);
+
+    for (i = 0; i < index->size; ++i) {
+        const char *name = index->rooms[i]->name;
+        size_t shared = 0;
+
+        while (previous[shared] != '\0' && previous[shared] == name[shared]) {
+            ++shared;
+        }
+
+        const size_t suffix = strlen(name + shared);
+
+        writer.ok = writer.ok && shared + suffix <= CODEC_MAX_NAME_LENGTH;
+        put_varint(&writer, shared);
+        put_varint(&writer, suffix);
+        put_bytes(&writer, name + shared, suffix);
+
+        if (index->rooms[i]->max_connections > MAX_CONNECTIONS) {
+            put_byte(&writer, (uint8_t) index->rooms[i]->type
+                    | CODEC_HUB_FLAG);
+            put_varint(&writer, index->rooms[i]->max_connections);
+        } else {
+            put_byte(&writer, (uint8_t) index->rooms[i]->type);
+        }
+
+        previous = name;
+    }
+
+    for (i = 0; i < index->size; ++i) {
+        const size_t degree = index->offsets[i + 1] - index->offsets[i];
+
+        if (degree > capacity) {
+            capacity = degree;
+            ids = (size_t*) realloc(ids, capacity * sizeof(size_t));
+        }
+
+        for (j = 0; j < degree; ++j) {
+            ids[j] = index->neighbors[index->offsets[i] + j];
+            writer.ok = writer.ok && ids[j] != ROOM_INDEX_NONE;
+        }
+
+        sort_ids(ids, degree);
+        put_varint(&writer, degree);
+
+        // Neighbours tend to be close to the room, so the first id is stored
+        // as a zigzag encoded offset from the room's own id
+        for (j = 0; j < degree; ++j) {
+            if (j == 0) {
+                const int64_t delta = (int64_t) ids[0] - (int64_t) i;
+                put_varint(&writer, ((uint64_t) delta << 1) ^ (delta >> 63));
+            } else {
+                put_varint(&writer, ids[j] - ids[j - 1] - 1);
+            }
+        }
+    }
+
+    free(ids);
+    del_room_index(index);
+
+    return finish_block_writer(&writer);
+}
+
+/*
+ * Reads a world written by write_compact_world.
+ *
+ * @param in The stream to read from.
+ * @return A pointer to a new world or NULL if the stream is not a valid
+ * compact world.
+ */
+struct RoomList *read_compact_world(FILE *in) {
+    char magic[sizeof(CODEC_MAGIC)];
+    struct BlockReader reader;
+    uint64_t num_rooms;
+
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic)
+            || memcmp(magic, CODEC_MAGIC, sizeof(magic)) != 0
+            || fgetc(in) != CODEC_VERSION || fgetc(in) == EOF) {
+        return NULL;
+    }
+
+    init_block_reader(&reader, in);
+
+    if (!get_varint(&reader, &num_rooms) || num_rooms >= UINT32_MAX) {
+        del_block_reader(&reader);
+        return NULL;
+    }
+
+    // The room count is not trusted to size anything up front: the array of
+    // rooms only grows as rooms are actually read
+    struct RoomList *world = new_room_list();
+    size_t room_capacity = 64;
+    struct Room **rooms = (struct Room**) malloc(room_capacity
+            * sizeof(struct Room*));
+    char *name = (char*) malloc(CODEC_MAX_NAME_LENGTH + 1);
+    size_t name_length = 0;
+    bool ok = rooms != NULL && name != NULL;
+    size_t i;
+    size_t j;
+
+    for (i = 0; ok && i < num_rooms; ++i) {
+        uint64_t shared;
+        uint64_t suffix;
+        uint64_t max_connections = MAX_CONNECTIONS;
+        uint8_t type = 0;
+
+        ok = get_varint(&reader, &shared) && shared <= name_length
+            && get_varint(&reader, &suffix)
+            && suffix <= CODEC_MAX_NAME_LENGTH - shared;
+
+        if (ok && i == room_capacity) {
+            struct Room **grown = (struct Room**) realloc(rooms,
+                    2 * room_capacity * sizeof(struct Room*));
+
+            ok = grown != NULL;
+            rooms = ok ? grown : rooms;
+            room_capacity *= 2;
+        }
+
+        for (j = 0; ok && j < suffix; ++j) {
+            ok = get_byte(&reader, (uint8_t*) &name[shared + j]);
+        }
+
+        ok = ok && get_byte(&reader, &type);
+
+        if (ok && (type & CODEC_HUB_FLAG) != 0) {
+            ok = get_varint(&reader, &max_connections)
+                && max_connections > MAX_CONNECTIONS
+                && max_connections <= UINT32_MAX;
+            type &= ~CODEC_HUB_FLAG;
+        }
+
+        ok = ok && type <= END_ROOM;
+
+        if (ok) {
+            name_length = shared + suffix;
+            name[name_length] = '\0';
+            rooms[i] = new_room(name, (room_t) type);
+            set_max_connections(rooms[i], max_connections);
+            add_room(world, rooms[i]);
+        }
+    }
+
+    for (i = 0; ok && i < num_rooms; ++i) {
+        uint64_t degree;
+        uint64_t value;
+        size_t id = 0;
+
+        ok = get_varint(&reader, &degree)
+            && degree <= rooms[i]->max_connections;
+
+        for (j = 0; ok && j < degree; ++j) {
+            ok = get_varint(&reader, &value);
+            id = j == 0 ? i + (int64_t) ((value >> 1) ^ -(value & 1))
+                : id + value + 1;
+            ok = ok && id < num_rooms && id != i;
+
+            // Each connection is listed by both rooms: it is added by the
+            // first and must already be there for the second
+            if (ok && id > i) {
+                ok = add_connection(rooms[i], rooms[id]);
+            } else if (ok) {
+                ok = has_connection(rooms[i], rooms[id]);
+            }
+        }
+
+        // Every earlier room that listed this one is listed back
+        ok = ok && rooms[i]->num_connections == degree;
+    }
+
+    ok = ok && at_end_of_blocks(&reader);
+
+    free(name);
+    free(rooms);
+    del_block_reader(&reader);
+
+    if (!ok) {
+        del_world(world);
+        return NULL;
+    }
+
+    return world;
+}
+
+/*
+ * Writes the given world in the text encoding.
+ *
+ * @param out The stream to write to.
+ * @param world A pointer to a RoomList.
+ * @return Whether the world was written.
+ */
+bool write_text_world(FILE *out, const struct RoomList *world) {
+    const struct RoomLink *curr;
+
+    for (curr = world->head; curr != NULL; curr = curr->next) {
+        fprint_room(out, curr->room);
+    }
+
+    return ferror(out) == 0;
+}
+
+/*
+ * A room name and the position of the room in the text being read.
+ */
+struct TextName {
+    const char *name;
+    size_t id;
+};
+
+static int compare_text_names(const void *a, const void *b) {
+    return strcmp(((const struct TextName*) a)->name,
+            ((const struct TextName*) b)->name);
+}
+
+/*
+ * Returns whether line starts with prefix and if so points value at the rest
+ * of it, without the newline.
+ */
+static bool parse_text_line(char *line, const char *prefix, char **value) {
+    const size_t length = strlen(prefix);
+
+    if (strncmp(line, prefix, length) != 0) {
+        return false;
+    }
+
+    *value = line + length;
+    (*value)[strcspn(*value, "\n")] = '\0';
+
+    return true;
+}
+
+/*
+ * Reads a world written by write_text_world, or any concatenation of
+ * print_room output. A connection is restored if either room lists it.
+ *
+ * @param in The stream to read from.
+ * @return A pointer to a new world or NULL if the text is malformed or names
+ * a room that is not in it.
+ */
+struct RoomList *read_text_world(FILE *in) {
+    struct RoomList *world = new_room_list();
+    size_t room_capacity = 64;
+    size_t num_rooms = 0;
+    struct Room **rooms = (struct Room**) malloc(room_capacity
+            * sizeof(struct Room*));
+    size_t edge_capacity = 64;
+    size_t num_edges = 0;
+    struct TextName *edges = (struct TextName*) malloc(edge_capacity
+            * sizeof(struct TextName));
+    char *line = NULL;
+    size_t line_capacity = 0;
+    bool in_room = false;
+    bool ok = true;
+    char *value;
+    size_t i;
+
+    while (ok && getline(&line, &line_capacity, in) != -1) {
+        if (!in_room && parse_text_line(line, "ROOM NAME: ", &value)) {
+            if (num_rooms == room_capacity) {
+                room_capacity *= 2;
+                rooms = (struct Room**) realloc(rooms, room_capacity
+                        * sizeof(struct Room*));
+            }
+
+            rooms[num_rooms] = new_room(value, MID_ROOM);
+            add_room(world, rooms[num_rooms++]);
+            in_room = true;
+        } else if (in_room && strncmp(line, "CONNECTION ", 11) == 0
+                && (value = strstr(line, ": ")) != NULL) {
+            if (num_edges == edge_capacity) {
+                edge_capacity *= 2;
+                edges = (struct TextName*) realloc(edges, edge_capacity
+                        * sizeof(struct TextName));
+            }
+
+            value += 2;
+            value[strcspn(value, "\n")] = '\0';
+            edges[num_edges].name = new_str_from(value);
+            edges[num_edges++].id = num_rooms - 1;
+        } else if (in_room && parse_text_line(line, "MAX CONNECTIONS: ",
+                    &value)) {
+            char *end;
+            const unsigned long max_connections = strtoul(value, &end, 10);
+
+            ok = *value >= '0' && *value <= '9' && *end == '\0'
+                && max_connections > MAX_CONNECTIONS
+                && set_max_connections(rooms[num_rooms - 1], max_connections);
+        } else if (in_room && parse_text_line(line, "ROOM TYPE: ", &value)) {
+            if (strcmp(value, "START_ROOM") == 0) {
+                rooms[num_rooms - 1]->type = START_ROOM;
+            } else if (strcmp(value, "END_ROOM") == 0) {
+                rooms[num_rooms - 1]->type = END_ROOM;
+            } else {
+                ok = strcmp(value, "MID_ROOM") == 0;
+            }
+
+            in_room = false;
+        } else {
+            ok = false;
+        }
+    }
+
+    ok = ok && !in_room;
+
+    struct TextName *names = (struct TextName*) malloc((num_rooms + 1)
+            * sizeof(struct TextName));
+
+    for (i = 0; i < num_rooms; ++i) {
+        names[i].name = rooms[i]->name;
+        names[i].id = i;
+    }
+
+    qsort(names, num_rooms, sizeof(struct TextName), compare_text_names);
+
+    // Only hubs may list more connections than usual
+    size_t *degrees = (size_t*) calloc(num_rooms + 1, sizeof(size_t));
+
+    for (i = 0; i < num_edges; ++i) {
+        degrees[edges[i].id]++;
+    }
+
+    for (i = 0; i < num_rooms; ++i) {
+        ok = ok && degrees[i] <= rooms[i]->max_connections;
+    }
+
+    free(degrees);
+
+    for (i = 0; i < num_edges; ++i) {
+        const struct TextName *other = ok ? (const struct TextName*) bsearch(
+                &edges[i], names, num_rooms, sizeof(struct TextName),
+                compare_text_names) : NULL;
+        struct Room *room = rooms[edges[i].id];
+
+        ok = other != NULL;
+
+        if (ok && find_connection(room, other->name) == NULL) {
+            ok = add_connection(room, rooms[other->id]);
+        }
+
+        free((char*) edges[i].name);
+    }
+
+    free(names);
+    free(line);
+    free(edges);
+    free(rooms);
+
+    if (!ok) {
+        del_world(world);
+        return NULL;
+    }
+
+    return world;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void read_compact_world_should_read_back_written_world(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_random_world(500, 3, 1);
+    FILE *file = tmpfile();
+
+    // When
+    CuAssertIntEquals(tc, true, write_compact_world(file, world, false));
+    rewind(file);
+    struct RoomList *actual = read_compact_world(file);
+
+    // Then
+    CuAssertPtrNotNull(tc, actual);
+    assert_same_world(tc, world, actual);
+
+    // Clean up
+    fclose(file);
+    del_world(actual);
+    del_world(world);
+}
+
+void write_compact_world_when_compressed_should_be_smaller(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(100000, 6);
+    FILE *plain = tmpfile();
+    FILE *compressed = tmpfile();
+
+    // When
+    write_compact_world(plain, world, false);
+    write_compact_world(compressed, world, true);
+    rewind(compressed);
+    struct RoomList *actual = read_compact_world(compressed);
+
+    // Then
+    CuAssertTrue(tc, ftell(compressed) < ftell(plain));
+    CuAssertPtrNotNull(tc, actual);
+    assert_same_world(tc, world, actual);
+
+    // Clean up
+    fclose(compressed);
+    fclose(plain);
+    del_world(actual);
+    del_world(world);
+}
+
+void read_compact_world_when_truncated_should_return_null(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_random_world(100, 3, 1);
+    FILE *file = tmpfile();
+    write_compact_world(file, world, true);
+    fflush(file);
+    const long size = ftell(file);
+    CuAssertIntEquals(tc, 0, ftruncate(fileno(file), size - 4));
+    rewind(file);
+
+    // When
+    struct RoomList *actual = read_compact_world(file);
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, actual);
+
+    // Clean up
+    fclose(file);
+    del_world(world);
+}
+
+void read_compact_world_when_match_overruns_block_should_return_null(
+        CuTest *tc) {
+    // Given a block of 65534 literals followed by a match of LZ_MIN_MATCH
+    // bytes, two more than the block holds
+    uint8_t data[3 + 65534 + 2];
+    uint8_t header[1 + 2 * 10];
+    size_t data_size = put_varint_at(data, 65534);
+    size_t header_size = 1;
+    FILE *file = tmpfile();
+
+    memset(data + data_size, 'x', 65534);
+    data_size += 65534;
+    data[data_size++] = 0;
+    data[data_size++] = 1;
+    header[0] = BLOCK_LZ;
+    header_size += put_varint_at(header + header_size, CODEC_BLOCK_SIZE);
+    header_size += put_varint_at(header + header_size, data_size);
+    fwrite(CODEC_MAGIC, 1, sizeof(CODEC_MAGIC), file);
+    fputc(CODEC_VERSION, file);
+    fputc(true, file);
+    fwrite(header, 1, header_size, file);
+    fwrite(data, 1, data_size, file);
+    rewind(file);
+
+    // When
+    struct RoomList *actual = read_compact_world(file);
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, actual);
+
+    // Clean up
+    fclose(file);
+}
+
+void read_compact_world_when_connection_listed_once_should_return_null(
+        CuTest *tc) {
+    // Given two rooms where only the first lists the connection between them
+    const uint8_t data[] = {
+        2, 0, 1, 'A', START_ROOM, 0, 1, 'B', END_ROOM, 1, 2, 0
+    };
+    FILE *file = tmpfile();
+
+    fwrite(CODEC_MAGIC, 1, sizeof(CODEC_MAGIC), file);
+    fputc(CODEC_VERSION, file);
+    fputc(false, file);
+    fputc(BLOCK_STORED, file);
+    fputc(sizeof(data), file);
+    fwrite(data, 1, sizeof(data), file);
+    fputc(BLOCK_STORED, file);
+    fputc(0, file);
+    rewind(file);
+
+    // When
+    struct RoomList *actual = read_compact_world(file);
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, actual);
+
+    // Clean up
+    fclose(file);
+}
+
+void lz_compress_when_output_would_overflow_should_give_up(CuTest *tc) {
+    // Given a block of random bytes of which, after the first 16385, every
+    // five start with four bytes from 16385 earlier and end with a new one,
+    // so that every match is short and takes a three byte distance
+    const size_t distance = 16385;
+    uint8_t *src = (uint8_t*) malloc(CODEC_BLOCK_SIZE);
+    uint8_t *dst = (uint8_t*) malloc(2 * CODEC_BLOCK_SIZE);
+    uint32_t *table = (uint32_t*) malloc(sizeof(uint32_t) << LZ_HASH_BITS);
+    struct Xoshiro256 rng;
+    size_t i;
+    seed_xoshiro(&rng, 1);
+
+    for (i = 0; i < CODEC_BLOCK_SIZE; ++i) {
+        src[i] = i < distance ? (uint8_t) next_xoshiro(&rng)
+            : (i - distance) % 5 < 4 ? src[i - distance]
+            : src[i - distance] ^ (uint8_t) (1 + xoshiro_below(&rng, 255));
+    }
+
+    memset(dst, 0xaa, 2 * CODEC_BLOCK_SIZE);
+
+    // When
+    const size_t unbounded = lz_compress(src, CODEC_BLOCK_SIZE, dst,
+            2 * CODEC_BLOCK_SIZE, table);
+    memset(dst, 0xaa, 2 * CODEC_BLOCK_SIZE);
+    const size_t bounded = lz_compress(src, CODEC_BLOCK_SIZE, dst,
+            CODEC_BLOCK_SIZE, table);
+
+    // Then
+    CuAssertTrue(tc, unbounded > CODEC_BLOCK_SIZE);
+    CuAssertIntEquals(tc, 0, bounded);
+
+    for (i = CODEC_BLOCK_SIZE; i < 2 * CODEC_BLOCK_SIZE; ++i) {
+        CuAssertIntEquals(tc, 0xaa, dst[i]);
+    }
+
+    // Clean up
+    free(table);
+    free(dst);
+    free(src);
+}
+
+void read_compact_world_when_hub_should_read_back_written_world(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_random_world(300, 3, 3);
+    struct Room *hub = world->head->room;
+    const struct RoomLink *curr;
+    FILE *file = tmpfile();
+
+    set_max_connections(hub, 300);
+
+    for (curr = world->head->next; curr != NULL; curr = curr->next) {
+        if (!has_connection(hub, curr->room)) {
+            set_max_connections(curr->room, curr->room->num_connections + 1);
+            add_connection(hub, curr->room);
+        }
+    }
+
+    // When
+    CuAssertIntEquals(tc, true, write_compact_world(file, world, true));
+    rewind(file);
+    struct RoomList *compact = read_compact_world(file);
+    rewind(file);
+    CuAssertIntEquals(tc, true, write_text_world(file, world));
+    fflush(file);
+    CuAssertIntEquals(tc, 0, ftruncate(fileno(file), ftell(file)));
+    rewind(file);
+    struct RoomList *text = read_text_world(file);
+
+    // Then
+    CuAssertIntEquals(tc, 299, hub->num_connections);
+    CuAssertPtrNotNull(tc, compact);
+    CuAssertPtrNotNull(tc, text);
+    CuAssertIntEquals(tc, 300, compact->head->room->max_connections);
+    CuAssertIntEquals(tc, 300, text->head->room->max_connections);
+    CuAssertIntEquals(tc, MAX_CONNECTIONS,
+            compact->tail->room->max_connections);
+    assert_same_world(tc, world, compact);
+    assert_same_world(tc, world, text);
+
+    // Clean up
+    fclose(file);
+    del_world(text);
+    del_world(compact);
+    del_world(world);
+}
+
+void read_text_world_should_read_back_written_world(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_random_world(100, 3, 2);
+    FILE *file = tmpfile();
+
+    // When
+    CuAssertIntEquals(tc, true, write_text_world(file, world));
+    rewind(file);
+    struct RoomList *actual = read_text_world(file);
+
+    // Then
+    CuAssertPtrNotNull(tc, actual);
+    assert_same_world(tc, world, actual);
+
+    // Clean up
+    fclose(file);
+    del_world(actual);
+    del_world(world);
+}
+
+void read_text_world_when_connection_unknown_should_return_null(CuTest *tc) {
+    // Given
+    FILE *file = tmpfile();
+    fputs("ROOM NAME: Eastern Palace\nCONNECTION 1: Ice Palace\n"
+            "ROOM TYPE: START_ROOM\n", file);
+    rewind(file);
+
+    // When
+    struct RoomList *actual = read_text_world(file);
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, actual);
+
+    // Clean up
+    fclose(file);
+}
+
+void read_text_world_when_too_many_connections_should_return_null(
+        CuTest *tc) {
+    // Given a room that is not a hub listing seven connections
+    FILE *file = tmpfile();
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < 8; ++i) {
+        fprintf(file, "ROOM NAME: Room %zu\n", i);
+
+        for (j = 1; j < 8; ++j) {
+            if (i == 0) {
+                fprintf(file, "CONNECTION %zu: Room %zu\n", j, j);
+            } else if (j == 1) {
+                fputs("CONNECTION 1: Room 0\n", file);
+            }
+        }
+
+        fputs("ROOM TYPE: MID_ROOM\n", file);
+    }
+
+    rewind(file);
+
+    // When
+    struct RoomList *actual = read_text_world(file);
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, actual);
+
+    // Clean up
+    fclose(file);
+}
+
+void read_text_world_when_room_connects_to_itself_should_return_null(
+        CuTest *tc) {
+    // Given
+    FILE *file = tmpfile();
+    fputs("ROOM NAME: Eastern Palace\nCONNECTION 1: Eastern Palace\n"
+            "ROOM TYPE: START_ROOM\n", file);
+    rewind(file);
+
+    // When
+    struct RoomList *actual = read_text_world(file);
+
+    // Then
+    CuAssertPtrEquals(tc, NULL, actual);
+
+    // Clean up
+    fclose(file);
+}
+
+CuSuite *get_world_codec_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, read_compact_world_should_read_back_written_world);
+    SUITE_ADD_TEST(suite, write_compact_world_when_compressed_should_be_smaller);
+    SUITE_ADD_TEST(suite, read_compact_world_when_truncated_should_return_null);
+    SUITE_ADD_TEST(suite, read_compact_world_when_match_overruns_block_should_return_null);
+    SUITE_ADD_TEST(suite, read_compact_world_when_connection_listed_once_should_return_null);
+    SUITE_ADD_TEST(suite, lz_compress_when_output_would_overflow_should_give_up);
+    SUITE_ADD_TEST(suite, read_compact_world_when_hub_should_read_back_written_world);
+    SUITE_ADD_TEST(suite, read_text_world_should_read_back_written_world);
+    SUITE_ADD_TEST(suite, read_text_world_when_connection_unknown_should_return_null);
+    SUITE_ADD_TEST(suite, read_text_world_when_too_many_connections_should_return_null);
+    SUITE_ADD_TEST(suite, read_text_world_when_room_connects_to_itself_should_return_null);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Encodes a world in the given format into memory, decodes it back and
+ * reports bytes per room. Throughput is given in MB/s of the text encoding so
+ * the formats can be compared directly. Returns the encoded size.
+ */
+static size_t run_codec_benchmark(const char *label,
+        const struct RoomList *world, const int format,
+        const size_t text_size) {
+    char *buffer = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&buffer, &size);
+    double start = now_seconds();
+
+    if (format == 0) {
+        write_text_world(out, world);
+    } else {
+        write_compact_world(out, world, format == 2);
+    }
+
+    fclose(out);
+
+    const double encode_seconds = now_seconds() - start;
+    const size_t text_bytes = format == 0 ? size : text_size;
+    FILE *in = fmemopen(buffer, size, "rb");
+
+    start = now_seconds();
+    struct RoomList *copy = format == 0 ? read_text_world(in)
+        : read_compact_world(in);
+    const double decode_seconds = now_seconds() - start;
+
+    printf("world_codec: %-14s %6.2f bytes/room, encode %6.1f MB/s, "
+            "decode %6.1f MB/s%s\n", label, (double) size / world->size,
+            text_bytes / encode_seconds / 1e6,
+            text_bytes / decode_seconds / 1e6,
+            copy != NULL && copy->size == world->size ? "" : " (FAILED)");
+
+    fclose(in);
+
+    if (copy != NULL) {
+        del_world(copy);
+    }
+
+    free(buffer);
+
+    return size;
+}
+
+void run_world_codec_benchmark() {
+    struct RoomList *worlds[2];
+    const char *names[2] = { "random", "circulant" };
+    size_t w;
+
+    worlds[0] = new_random_world(1000000, 3, 1);
+    worlds[1] = new_circulant_world(1000000, 6);
+
+    for (w = 0; w < 2; ++w) {
+        printf("world_codec: %s world of %zu rooms\n", names[w],
+                worlds[w]->size);
+
+        const size_t text_size = run_codec_benchmark("text", worlds[w], 0, 0);
+
+        run_codec_benchmark("compact", worlds[w], 1, text_size);
+        run_codec_benchmark("compact+blocks", worlds[w], 2, text_size);
+        del_world(worlds[w]);
+    }
+}
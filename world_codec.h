@@ -0,0 +1,35 @@
+#ifndef WORLD_CODEC_H
+#define WORLD_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "room.h"
+#include "room_list.h"
+
+/*
+ * Two streaming encodings of a whole world.
+ *
+ * The text encoding is the print_room output of every room, one after the
+ * other.
+ *
+ * The compact encoding is a 6 byte header followed by a stream of blocks, each
+ * stored as is or compressed with a small LZ77 codec. The stream holds the
+ * number of rooms, then a name dictionary in which every name is front coded
+ * against the one before it and followed by the room's type and, for hubs,
+ * their maximum number of connections, then the connections of every room as varint
+ * deltas between the sorted ids of its neighbours. Room ids are positions in
+ * the RoomList. Connections come back sorted by id rather than in their
+ * original order.
+ */
+
+bool write_compact_world(FILE *out, const struct RoomList *world,
+        bool compress);
+
+struct RoomList *read_compact_world(FILE *in);
+
+bool write_text_world(FILE *out, const struct RoomList *world);
+
+struct RoomList *read_text_world(FILE *in);
+
+#endif
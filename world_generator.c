@@ -0,0 +1,438 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "utils.h"
+#include "world.h"
+#include "world_generator.h"
+#include "world_verifier.h"
+#include "CuTest.h"
+
+/*
+ * A connection placed by the generator, which may be rewired to resolve a
+ * conflicting pair of stubs.
+ */
+struct PlacedEdge {
+    uint32_t room1;
+    uint32_t room2;
+};
+
+/*
+ * Constructs the rooms of a generated world and returns them in an array so
+ * they can be connected by position.
+ */
+static struct Room **new_generated_rooms(struct RoomList *world,
+        const size_t num_rooms) {
+    struct Room **rooms = (struct Room**) malloc(num_rooms *
+            sizeof(struct Room*));
+    char name[32];
+    size_t i;
+
+    for (i = 0; i < num_rooms; ++i) {
+        room_t type = MID_ROOM;
+
+        if (i == 0) {
+            type = START_ROOM;
+        } else if (i == num_rooms / 2) {
+            type = END_ROOM;
+        }
+
+        snprintf(name, sizeof(name), "Room %zu", i);
+        rooms[i] = new_room(name, type);
+        add_room(world, rooms[i]);
+    }
+
+    return rooms;
+}
+
+/*
+ * Tries to replace the conflicting pair (a, b) and a placed edge (c, d) with
+ * the connections a-c and b-d. Returns whether the rewiring was valid and
+ * done. This never disconnects the world: a pair conflicts because a and b
+ * are the same room or already connected, so whichever side of the removed
+ * edge they are on, c and d both get connected back to it.
+ */
+static bool rewire(struct Room **rooms, struct PlacedEdge *edge,
+        const uint32_t a, const uint32_t b, const uint32_t c,
+        const uint32_t d) {
+    if (a == c || b == d || has_connection(rooms[a], rooms[c])
+            || has_connection(rooms[b], rooms[d])) {
+        return false;
+    }
+
+    remove_connection(rooms[c], rooms[d]);
+    add_connection(rooms[a], rooms[c]);
+    add_connection(rooms[b], rooms[d]);
+    edge->room1 = a;
+    edge->room2 = c;
+
+    return true;
+}
+
+/*
+ * Connects room to the first room at or after a random position that has a
+ * connection available and is not connected to it yet. This is the last
+ * resort for a stub whose pair could not be swapped, which only happens in
+ * very small worlds.
+ */
+static void connect_to_any(struct Room **rooms, const size_t num_rooms,
+        const uint32_t room, const size_t max_connections,
+        struct Xoshiro256 *rng) {
+    const size_t start = xoshiro_below(rng, num_rooms);
+    size_t i;
+
+    for (i = 0; i < num_rooms; ++i) {
+        const size_t other = (start + i) % num_rooms;
+
+        if (other != room && rooms[other]->num_connections < max_connections
+                && !has_connection(rooms[room], rooms[other])) {
+            add_connection(rooms[room], rooms[other]);
+            return;
+        }
+    }
+}
+
+/*
+ * Constructs a connected random world in which every room has between
+ * min_connections and MAX_CONNECTIONS connections (at most num_rooms - 1),
+ * in time linear in the number of connections.
+ *
+ * Every room first draws a target degree. A random spanning tree is then
+ * grown by attaching the rooms one at a time, in random order, to a stub
+ * drawn from the unused stubs of the rooms already placed; since every target
+ * is at least 2 the pool never runs dry. The remaining stubs are shuffled and
+ * paired up. A pair that would be a self loop or a duplicate is swapped with
+ * an already placed connection instead of being redrawn, so no step is ever
+ * rejected and retried, and the swap keeps the world connected. Conflicts
+ * are rare, so a scan for a valid swap costs O(1) connections on average.
+ *
+ * In worlds of a handful of rooms a conflicting pair may have no valid swap,
+ * in which case each of its rooms is connected to any room with a connection
+ * to spare instead. Only when min_connections is close to num_rooms, as in
+ * 8 rooms with at least 6 connections each, can that still leave a room
+ * short.
+ *
+ * @param num_rooms The number of rooms in the world.
+ * @param min_connections The minimum number of connections of every room. It
+ * must be at least 2 unless the world has only 2 rooms.
+ * @param seed The seed of the random number generator.
+ * @return A pointer to a new world or NULL if the bounds cannot be met.
+ */
+struct RoomList *new_random_world(const size_t num_rooms,
+        const size_t min_connections, const uint64_t seed) {
+    const size_t max_connections = num_rooms - 1 < MAX_CONNECTIONS
+        ? num_rooms - 1 : MAX_CONNECTIONS;
+
+    if (num_rooms < 2 || num_rooms > UINT32_MAX || min_connections < 1
+            || (min_connections < 2 && num_rooms > 2)
+            || min_connections > max_connections) {
+        return NULL;
+    }
+
+    struct RoomList *world = new_room_list();
+    struct Room **rooms = new_generated_rooms(world, num_rooms);
+    uint8_t *targets = (uint8_t*) malloc(num_rooms);
+    uint32_t *order = (uint32_t*) malloc(num_rooms * sizeof(uint32_t));
+    struct Xoshiro256 rng;
+    size_t num_stubs = 0;
+    size_t i;
+    size_t j;
+
+    seed_xoshiro(&rng, seed);
+
+    for (i = 0; i < num_rooms; ++i) {
+        targets[i] = (uint8_t) (min_connections + xoshiro_below(&rng,
+                    max_connections - min_connections + 1));
+        num_stubs += targets[i];
+        order[i] = (uint32_t) i;
+    }
+
+    // Every stub needs a partner, so make the total even
+    for (i = 0; num_stubs % 2 == 1; ++i) {
+        if (targets[i] < max_connections) {
+            targets[i]++;
+            num_stubs++;
+        } else if (targets[i] > min_connections) {
+            targets[i]--;
+            num_stubs--;
+        }
+    }
+
+    for (i = num_rooms - 1; i > 0; --i) {
+        const size_t other = xoshiro_below(&rng, i + 1);
+        const uint32_t room = order[i];
+
+        order[i] = order[other];
+        order[other] = room;
+    }
+
+    // Grow the spanning tree
+    uint32_t *pool = (uint32_t*) malloc(num_stubs * sizeof(uint32_t));
+    struct PlacedEdge *edges = (struct PlacedEdge*) malloc(num_stubs
+            * sizeof(struct PlacedEdge));
+    size_t pool_size = 0;
+    size_t num_edges = 0;
+
+    for (j = 0; j < targets[order[0]]; ++j) {
+        pool[pool_size++] = order[0];
+    }
+
+    for (i = 1; i < num_rooms; ++i) {
+        const uint32_t room = order[i];
+        const size_t stub = xoshiro_below(&rng, pool_size);
+        const uint32_t parent = pool[stub];
+
+        pool[stub] = pool[--pool_size];
+        add_connection(rooms[room], rooms[parent]);
+        edges[num_edges].room1 = room;
+        edges[num_edges++].room2 = parent;
+
+        for (j = 1; j < targets[room]; ++j) {
+            pool[pool_size++] = room;
+        }
+    }
+
+    free(order);
+
+    // Match the remaining stubs
+    size_t num_conflicts = 0;
+    size_t num_unresolved = 0;
+
+    for (i = pool_size; i > 1; --i) {
+        const size_t other = xoshiro_below(&rng, i);
+        const uint32_t room = pool[i - 1];
+
+        pool[i - 1] = pool[other];
+        pool[other] = room;
+    }
+
+    for (i = 0; i + 1 < pool_size; i += 2) {
+        const uint32_t a = pool[i];
+        const uint32_t b = pool[i + 1];
+
+        if (a != b && !has_connection(rooms[a], rooms[b])) {
+            add_connection(rooms[a], rooms[b]);
+            edges[num_edges].room1 = a;
+            edges[num_edges].room2 = b;
+            num_edges++;
+        } else {
+            // Keep the pair for later, when there are more edges to swap with
+            pool[2 * num_conflicts] = a;
+            pool[2 * num_conflicts + 1] = b;
+            num_conflicts++;
+        }
+    }
+
+    for (i = 0; i < num_conflicts; ++i) {
+        const uint32_t a = pool[2 * i];
+        const uint32_t b = pool[2 * i + 1];
+        const size_t start = num_edges == 0 ? 0
+            : xoshiro_below(&rng, num_edges);
+
+        for (j = 0; j < num_edges; ++j) {
+            struct PlacedEdge *edge = &edges[(start + j) % num_edges];
+            const uint32_t c = edge->room1;
+            const uint32_t d = edge->room2;
+
+            if (rewire(rooms, edge, a, b, c, d)) {
+                edges[num_edges].room1 = b;
+                edges[num_edges++].room2 = d;
+                break;
+            } else if (rewire(rooms, edge, a, b, d, c)) {
+                edges[num_edges].room1 = b;
+                edges[num_edges++].room2 = c;
+                break;
+            }
+        }
+
+        if (j == num_edges) {
+            pool[2 * num_unresolved] = a;
+            pool[2 * num_unresolved + 1] = b;
+            num_unresolved++;
+        }
+    }
+
+    // Only now can rooms go past their targets without starving a swap
+    for (i = 0; i < num_unresolved; ++i) {
+        connect_to_any(rooms, num_rooms, pool[2 * i], max_connections, &rng);
+        connect_to_any(rooms, num_rooms, pool[2 * i + 1], max_connections,
+                &rng);
+    }
+
+    free(edges);
+    free(pool);
+    free(targets);
+    free(rooms);
+
+    return world;
+}
+
+/*
+ * Constructs a random world the obvious way: keep picking two random rooms
+ * with connections available and connect them unless they are the same room
+ * or already connected, until every room has min_connections connections.
+ * Near saturation most picks are rejected, and the result need not be
+ * connected. It is kept as the baseline new_random_world is measured against.
+ *
+ * @param num_rooms The number of rooms in the world.
+ * @param min_connections The minimum number of connections of every room.
+ * @param seed The seed of the random number generator.
+ * @param num_attempts A pointer to the number of pairs tried, or NULL.
+ * @return A pointer to a new world, which falls short of min_connections if
+ * the generator gave up after 16 attempts per connection slot.
+ */
+struct RoomList *new_random_world_by_retry(const size_t num_rooms,
+        const size_t min_connections, const uint64_t seed,
+        size_t *num_attempts) {
+    struct RoomList *world = new_room_list();
+    struct Room **rooms = new_generated_rooms(world, num_rooms);
+    const size_t max_attempts = 16 * num_rooms * MAX_CONNECTIONS;
+    size_t num_short = min_connections > 0 ? num_rooms : 0;
+    size_t attempts = 0;
+    struct Xoshiro256 rng;
+
+    seed_xoshiro(&rng, seed);
+
+    while (num_short > 0 && attempts < max_attempts) {
+        struct Room *room1 = rooms[xoshiro_below(&rng, num_rooms)];
+        struct Room *room2 = rooms[xoshiro_below(&rng, num_rooms)];
+
+        attempts++;
+
+        if (!has_connection_available(room1)
+                || !has_connection_available(room2)
+                || has_connection(room1, room2)
+                || !add_connection(room1, room2)) {
+            continue;
+        }
+
+        num_short -= (room1->num_connections == min_connections)
+            + (room2->num_connections == min_connections);
+    }
+
+    if (num_attempts != NULL) {
+        *num_attempts = attempts;
+    }
+
+    free(rooms);
+
+    return world;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void new_random_world_should_be_connected_within_degree_bounds(CuTest *tc) {
+    // When
+    struct RoomList *world = new_random_world(1000, 3, 1);
+    struct VerifyReport *report = verify_world(world, 3, 1);
+
+    // Then
+    CuAssertIntEquals(tc, 1000, world->size);
+    CuAssertIntEquals(tc, true, verify_report_ok(report));
+
+    // Clean up
+    del_verify_report(report);
+    del_world(world);
+}
+
+void new_random_world_when_game_sized_should_always_be_valid(CuTest *tc) {
+    uint64_t seed;
+
+    for (seed = 0; seed < 200; ++seed) {
+        // When
+        struct RoomList *world = new_random_world(7, 3, seed);
+        struct VerifyReport *report = verify_world(world, 3, 1);
+
+        // Then
+        CuAssertIntEquals(tc, true, verify_report_ok(report));
+
+        // Clean up
+        del_verify_report(report);
+        del_world(world);
+    }
+}
+
+void new_random_world_when_bounds_impossible_should_return_null(CuTest *tc) {
+    // Then
+    CuAssertPtrEquals(tc, NULL, new_random_world(1, 1, 1));
+    CuAssertPtrEquals(tc, NULL, new_random_world(5, 5, 1));
+    CuAssertPtrEquals(tc, NULL, new_random_world(100, 7, 1));
+    CuAssertPtrEquals(tc, NULL, new_random_world(100, 1, 1));
+}
+
+void new_random_world_by_retry_should_give_every_room_min_connections(CuTest *tc) {
+    // Given
+    size_t attempts;
+
+    // When
+    struct RoomList *world = new_random_world_by_retry(100, 3, 1, &attempts);
+
+    // Then
+    struct RoomLink *curr;
+    for (curr = world->head; curr != NULL; curr = curr->next) {
+        CuAssertTrue(tc, curr->room->num_connections >= 3);
+    }
+
+    CuAssertTrue(tc, attempts >= 150);
+
+    // Clean up
+    del_world(world);
+}
+
+CuSuite *get_world_generator_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, new_random_world_should_be_connected_within_degree_bounds);
+    SUITE_ADD_TEST(suite, new_random_world_when_game_sized_should_always_be_valid);
+    SUITE_ADD_TEST(suite, new_random_world_when_bounds_impossible_should_return_null);
+    SUITE_ADD_TEST(suite, new_random_world_by_retry_should_give_every_room_min_connections);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Times new_random_world against new_random_world_by_retry at 1K and 1M
+ * rooms. Set WORLD_GENERATOR_10M in the environment to also run 10M rooms,
+ * which needs a few GB of memory.
+ */
+void run_world_generator_benchmark() {
+    const size_t sizes[] = { 1000, 1000000, 10000000 };
+    const size_t num_sizes = getenv("WORLD_GENERATOR_10M") != NULL ? 3 : 2;
+    const size_t min_connections = 3;
+    size_t s;
+
+    for (s = 0; s < num_sizes; ++s) {
+        size_t attempts;
+        double start = now_seconds();
+        struct RoomList *world = new_random_world(sizes[s], min_connections,
+                1);
+        const double linear_seconds = now_seconds() - start;
+        struct VerifyReport *report = verify_world(world, min_connections, 0);
+
+        printf("world_generator: %zu rooms: stub matching %.3f s (%s)\n",
+                sizes[s], linear_seconds,
+                verify_report_ok(report) ? "valid" : "INVALID");
+
+        del_verify_report(report);
+        del_world(world);
+
+        start = now_seconds();
+        world = new_random_world_by_retry(sizes[s], min_connections, 1,
+                &attempts);
+        const double retry_seconds = now_seconds() - start;
+        report = verify_world(world, min_connections, 0);
+
+        printf("world_generator: %zu rooms: retry %.3f s, %zu attempts, "
+                "%zu components, %zu rooms short (%.1fx slower)\n", sizes[s],
+                retry_seconds, attempts, report->num_components,
+                report->counts[VIOLATION_TOO_FEW_CONNECTIONS],
+                retry_seconds / linear_seconds);
+
+        del_verify_report(report);
+        del_world(world);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef WORLD_GENERATOR_H
+#define WORLD_GENERATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "room.h"
+#include "room_list.h"
+
+/*
+ * Random world generators. Rooms are named "Room <n>"; the first room is the
+ * START_ROOM and the middle room is the END_ROOM, as in new_circulant_world.
+ */
+
+/*
+ * The version of the generators, which must be bumped whenever a change makes
+ * them build a different world from the same parameters and seed, so that
+ * worlds cached by an older version are not served.
+ */
+#define WORLD_GENERATOR_VERSION 1
+
+struct RoomList *new_random_world(size_t num_rooms, size_t min_connections,
+        uint64_t seed);
+
+struct RoomList *new_random_world_by_retry(size_t num_rooms,
+        size_t min_connections, uint64_t seed, size_t *num_attempts);
+
+#endif
@@ -0,0 +1,809 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bitset_world.h"
+#include "world.h"
+#include "world_host.h"
+#include "CuTest.h"
+
+/*
+ * The space set aside for each room name, enough for "Room 255".
+ */
+#define HOST_NAME_SIZE 16
+
+/*
+ * A hosted world. It sits at the start of its own memory region, followed by
+ * its rooms and then their names.
+ */
+struct HostedWorld {
+    size_t num_rooms;
+    size_t region_size;
+    struct Room *rooms;
+};
+
+/*
+ * A structure that stores a worker thread, the requests routed to it and its
+ * counters. The queue is shared with the client under lock; the counters are
+ * only written by the worker. Workers are cache line aligned so that one
+ * worker's counters do not share a line with another's queue.
+ */
+struct HostWorker {
+    struct WorldHost *host;
+    size_t id;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool stopping;
+    struct HostRequest **queue;
+    size_t queue_size;
+    size_t queue_capacity;
+    size_t live_worlds;
+    size_t worlds_created;
+    size_t worlds_destroyed;
+    size_t world_bytes;
+    size_t moves;
+    double total_move_us;
+    double max_move_us;
+} __attribute__((aligned(64)));
+
+/*
+ * A structure that stores a world host. worlds[id] is only touched by the
+ * owner of world id, worker id % num_workers. The free ids, and the bitmap of
+ * the ids handed out and not yet destroyed, are only touched by the client.
+ */
+struct WorldHost {
+    size_t num_workers;
+    size_t max_worlds;
+    struct HostWorker *workers;
+    struct HostedWorld **worlds;
+    uint32_t *free_ids;
+    size_t num_free_ids;
+    uint64_t *allocated;
+    pthread_mutex_t done_lock;
+    pthread_cond_t done;
+    size_t outstanding;
+};
+
+/*
+ * Builds a world in a region of its own: the world, then its rooms, then their
+ * names. The connections are laid out on a BitsetWorld first, which the
+ * classic generator fills quickly, and then copied onto the rooms.
+ */
+static struct HostedWorld *new_hosted_world(const size_t num_rooms,
+        const uint64_t seed) {
+    const size_t region_size = sizeof(struct HostedWorld)
+        + num_rooms * (sizeof(struct Room) + HOST_NAME_SIZE);
+    struct HostedWorld *world = (struct HostedWorld*) malloc(region_size);
+    char *names = (char*) ((struct Room*) (world + 1) + num_rooms);
+    struct BitsetWorld *layout = new_bitset_world(num_rooms);
+    struct Xoshiro256 rng;
+    size_t i;
+    size_t j;
+
+    world->num_rooms = num_rooms;
+    world->region_size = region_size;
+    world->rooms = (struct Room*) (world + 1);
+
+    for (i = 0; i < num_rooms; ++i) {
+        room_t type = MID_ROOM;
+
+        if (i == 0) {
+            type = START_ROOM;
+        } else if (i == num_rooms / 2) {
+            type = END_ROOM;
+        }
+
+        snprintf(names + i * HOST_NAME_SIZE, HOST_NAME_SIZE, "Room %u",
+                (unsigned) i);
+        init_room(&world->rooms[i], names + i * HOST_NAME_SIZE, type);
+    }
+
+    seed_xoshiro(&rng, seed);
+    connect_bitset_world(layout, num_rooms > 3 ? 3 : num_rooms - 1, &rng);
+
+    for (i = 0; i < num_rooms; ++i) {
+        for (j = i + 1; j < num_rooms; ++j) {
+            if (bitset_connected(layout, i, j)) {
+                add_connection(&world->rooms[i], &world->rooms[j]);
+            }
+        }
+    }
+
+    del_bitset_world(layout);
+
+    return world;
+}
+
+/*
+ * Serves one request on the worker that owns its world.
+ */
+static void serve_request(struct HostWorker *worker,
+        struct HostRequest *request) {
+    struct HostedWorld **slot = &worker->host->worlds[request->world];
+    struct HostedWorld *world = *slot;
+
+    switch (request->type) {
+        case HOST_CREATE_WORLD:
+            world = new_hosted_world(request->num_rooms, request->seed);
+            *slot = world;
+            request->room = &world->rooms[0];
+            request->ok = true;
+            worker->live_worlds++;
+            worker->worlds_created++;
+            worker->world_bytes += world->region_size;
+            break;
+        case HOST_DESTROY_WORLD:
+            request->ok = world != NULL;
+
+            if (request->ok) {
+                worker->live_worlds--;
+                worker->worlds_destroyed++;
+                worker->world_bytes -= world->region_size;
+                free(world);
+                *slot = NULL;
+            }
+
+            break;
+        case HOST_MOVE:
+            request->ok = world != NULL && request->room >= world->rooms
+                && request->room < world->rooms + world->num_rooms;
+
+            if (request->ok) {
+                const struct Room *next = find_connection(request->room,
+                        request->name);
+
+                request->ok = next != NULL;
+                request->room = next != NULL ? next : request->room;
+            }
+
+            break;
+    }
+}
+
+/*
+ * Pins a worker to a CPU of its own, as far as there are enough of them.
+ */
+static void pin_worker(const size_t id) {
+    cpu_set_t cpus;
+
+    CPU_ZERO(&cpus);
+    CPU_SET(id % default_num_threads(), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+/*
+ * The body of a worker: take every queued request at once, serve them and
+ * report them done.
+ */
+static void *run_host_worker(void *arg) {
+    struct HostWorker *worker = (struct HostWorker*) arg;
+    struct WorldHost *host = worker->host;
+    struct HostRequest **batch = NULL;
+    size_t batch_capacity = 0;
+    size_t i;
+
+    pin_worker(worker->id);
+
+    for (;;) {
+        pthread_mutex_lock(&worker->lock);
+
+        while (worker->queue_size == 0 && !worker->stopping) {
+            pthread_cond_wait(&worker->wake, &worker->lock);
+        }
+
+        // Swap the queue with the spare array so the client can keep queueing
+        // while this batch is served
+        struct HostRequest **requests = worker->queue;
+        const size_t size = worker->queue_size;
+        const size_t capacity = worker->queue_capacity;
+
+        worker->queue = batch;
+        worker->queue_capacity = batch_capacity;
+        worker->queue_size = 0;
+        batch = requests;
+        batch_capacity = capacity;
+        pthread_mutex_unlock(&worker->lock);
+
+        if (size == 0) {
+            break;
+        }
+
+        for (i = 0; i < size; ++i) {
+            serve_request(worker, batch[i]);
+        }
+
+        const double now = now_seconds();
+
+        for (i = 0; i < size; ++i) {
+            batch[i]->latency_us = (now - batch[i]->submitted) * 1e6;
+
+            if (batch[i]->type == HOST_MOVE) {
+                worker->moves++;
+                worker->total_move_us += batch[i]->latency_us;
+
+                if (batch[i]->latency_us > worker->max_move_us) {
+                    worker->max_move_us = batch[i]->latency_us;
+                }
+            }
+        }
+
+        pthread_mutex_lock(&host->done_lock);
+        host->outstanding -= size;
+
+        if (host->outstanding == 0) {
+            pthread_cond_broadcast(&host->done);
+        }
+
+        pthread_mutex_unlock(&host->done_lock);
+    }
+
+    free(batch);
+
+    return NULL;
+}
+
+/*
+ * Constructs a new WorldHost and starts its workers.
+ *
+ * @param num_workers The number of worker threads, 0 for one per online
+ * processor.
+ * @param max_worlds The most worlds that can be alive at once.
+ * @return A pointer to a new WorldHost.
+ */
+struct WorldHost *new_world_host(size_t num_workers, const size_t max_worlds) {
+    struct WorldHost *host = (struct WorldHost*) malloc(
+            sizeof(struct WorldHost));
+    size_t i;
+
+    if (num_workers == 0) {
+        num_workers = default_num_threads();
+    }
+
+    host->num_workers = num_workers;
+    host->max_worlds = max_worlds;
+    host->worlds = (struct HostedWorld**) calloc(max_worlds,
+            sizeof(struct HostedWorld*));
+    host->free_ids = (uint32_t*) malloc(max_worlds * sizeof(uint32_t));
+    host->num_free_ids = max_worlds;
+    host->allocated = (uint64_t*) calloc((max_worlds + 63) / 64,
+            sizeof(uint64_t));
+    host->outstanding = 0;
+    pthread_mutex_init(&host->done_lock, NULL);
+    pthread_cond_init(&host->done, NULL);
+
+    // Hand out low ids first
+    for (i = 0; i < max_worlds; ++i) {
+        host->free_ids[i] = (uint32_t) (max_worlds - 1 - i);
+    }
+
+    if (posix_memalign((void**) &host->workers, 64,
+                num_workers * sizeof(struct HostWorker)) != 0) {
+        abort();
+    }
+
+    memset(host->workers, 0, num_workers * sizeof(struct HostWorker));
+
+    for (i = 0; i < num_workers; ++i) {
+        struct HostWorker *worker = &host->workers[i];
+
+        worker->host = host;
+        worker->id = i;
+        pthread_mutex_init(&worker->lock, NULL);
+        pthread_cond_init(&worker->wake, NULL);
+        pthread_create(&worker->thread, NULL, run_host_worker, worker);
+    }
+
+    return host;
+}
+
+/*
+ * Waits for every submitted request, stops the workers and destroys every
+ * world still alive.
+ *
+ * @param host A pointer to a WorldHost.
+ */
+void del_world_host(struct WorldHost *host) {
+    size_t i;
+
+    host_wait(host);
+
+    for (i = 0; i < host->num_workers; ++i) {
+        struct HostWorker *worker = &host->workers[i];
+
+        pthread_mutex_lock(&worker->lock);
+        worker->stopping = true;
+        pthread_cond_signal(&worker->wake);
+        pthread_mutex_unlock(&worker->lock);
+        pthread_join(worker->thread, NULL);
+        free(worker->queue);
+        pthread_mutex_destroy(&worker->lock);
+        pthread_cond_destroy(&worker->wake);
+    }
+
+    for (i = 0; i < host->max_worlds; ++i) {
+        free(host->worlds[i]);
+    }
+
+    pthread_mutex_destroy(&host->done_lock);
+    pthread_cond_destroy(&host->done);
+    free(host->workers);
+    free(host->allocated);
+    free(host->free_ids);
+    free(host->worlds);
+    free(host);
+}
+
+/*
+ * Routes a batch of requests to the workers that own their worlds. Each worker
+ * is locked and woken once per batch. Requests that cannot be routed, such as
+ * a create when every id is taken, a request for an id out of range or a
+ * destroy of a world that is not alive, fail at once. The requests must stay alive until host_wait returns.
+ *
+ * @param host A pointer to a WorldHost.
+ * @param requests The requests to submit.
+ * @param num_requests The number of requests.
+ */
+void host_submit(struct WorldHost *host, struct HostRequest *requests,
+        const size_t num_requests) {
+    const double now = now_seconds();
+    size_t routed = 0;
+    size_t i;
+    size_t w;
+
+    for (i = 0; i < num_requests; ++i) {
+        struct HostRequest *request = &requests[i];
+
+        request->ok = false;
+        request->submitted = now;
+        request->latency_us = 0;
+
+        if (request->type == HOST_CREATE_WORLD) {
+            if (host->num_free_ids == 0 || request->num_rooms == 0
+                    || request->num_rooms > HOST_MAX_ROOMS) {
+                request->world = HOST_WORLD_NONE;
+                continue;
+            }
+
+            request->world = host->free_ids[--host->num_free_ids];
+            host->allocated[request->world / 64] |= (uint64_t) 1
+                << (request->world % 64);
+        } else if (request->world >= host->max_worlds) {
+            request->world = HOST_WORLD_NONE;
+            continue;
+        } else if (request->type == HOST_DESTROY_WORLD) {
+            const uint64_t bit = (uint64_t) 1 << (request->world % 64);
+
+            if ((host->allocated[request->world / 64] & bit) == 0) {
+                request->world = HOST_WORLD_NONE;
+                continue;
+            }
+
+            // The owner serves requests in order, so the id can be handed out
+            // again right away: anything sent to it next runs after this
+            host->allocated[request->world / 64] &= ~bit;
+            host->free_ids[host->num_free_ids++] = request->world;
+        }
+
+        ++routed;
+    }
+
+    pthread_mutex_lock(&host->done_lock);
+    host->outstanding += routed;
+    pthread_mutex_unlock(&host->done_lock);
+
+    for (w = 0; w < host->num_workers; ++w) {
+        struct HostWorker *worker = &host->workers[w];
+        size_t queued = 0;
+
+        pthread_mutex_lock(&worker->lock);
+
+        for (i = 0; i < num_requests; ++i) {
+            if (requests[i].world == HOST_WORLD_NONE
+                    || requests[i].world % host->num_workers != w) {
+                continue;
+            }
+
+            if (worker->queue_size == worker->queue_capacity) {
+                worker->queue_capacity = worker->queue_capacity == 0 ? 64
+                    : 2 * worker->queue_capacity;
+                worker->queue = (struct HostRequest**) realloc(worker->queue,
+                        worker->queue_capacity * sizeof(struct HostRequest*));
+            }
+
+            worker->queue[worker->queue_size++] = &requests[i];
+            ++queued;
+        }
+
+        if (queued > 0) {
+            pthread_cond_signal(&worker->wake);
+        }
+
+        pthread_mutex_unlock(&worker->lock);
+    }
+}
+
+/*
+ * Waits until every request submitted so far is done.
+ *
+ * @param host A pointer to a WorldHost.
+ */
+void host_wait(struct WorldHost *host) {
+    pthread_mutex_lock(&host->done_lock);
+
+    while (host->outstanding > 0) {
+        pthread_cond_wait(&host->done, &host->done_lock);
+    }
+
+    pthread_mutex_unlock(&host->done_lock);
+}
+
+/*
+ * Sums the counters of every worker. Call it after host_wait.
+ *
+ * @param host A pointer to a WorldHost.
+ * @param stats The HostStats to fill in.
+ */
+void host_stats(const struct WorldHost *host, struct HostStats *stats) {
+    double total_move_us = 0;
+    size_t i;
+
+    memset(stats, 0, sizeof(struct HostStats));
+
+    for (i = 0; i < host->num_workers; ++i) {
+        const struct HostWorker *worker = &host->workers[i];
+
+        stats->live_worlds += worker->live_worlds;
+        stats->worlds_created += worker->worlds_created;
+        stats->worlds_destroyed += worker->worlds_destroyed;
+        stats->world_bytes += worker->world_bytes;
+        stats->moves += worker->moves;
+        total_move_us += worker->total_move_us;
+
+        if (worker->max_move_us > stats->max_move_us) {
+            stats->max_move_us = worker->max_move_us;
+        }
+    }
+
+    stats->mean_move_us = stats->moves > 0 ? total_move_us / stats->moves : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void host_move_should_follow_connections_of_its_world(CuTest *tc) {
+    // Given
+    struct WorldHost *host = new_world_host(3, 10);
+    struct HostRequest create[5];
+    struct HostRequest move[5];
+    size_t i;
+
+    for (i = 0; i < 5; ++i) {
+        create[i].type = HOST_CREATE_WORLD;
+        create[i].num_rooms = 7;
+        create[i].seed = i;
+    }
+
+    host_submit(host, create, 5);
+    host_wait(host);
+
+    // When
+    for (i = 0; i < 5; ++i) {
+        move[i].type = HOST_MOVE;
+        move[i].world = create[i].world;
+        move[i].room = create[i].room;
+        move[i].name = create[i].room->connections[0]->name;
+    }
+
+    host_submit(host, move, 5);
+    host_wait(host);
+
+    // Then
+    for (i = 0; i < 5; ++i) {
+        CuAssertIntEquals(tc, true, create[i].ok);
+        CuAssertIntEquals(tc, i, create[i].world);
+        CuAssertIntEquals(tc, START_ROOM, create[i].room->type);
+        CuAssertIntEquals(tc, true, move[i].ok);
+        CuAssertPtrEquals(tc, create[i].room->connections[0],
+                (struct Room*) move[i].room);
+    }
+
+    // Clean up
+    del_world_host(host);
+}
+
+void host_move_when_not_connected_should_fail(CuTest *tc) {
+    // Given
+    struct WorldHost *host = new_world_host(2, 4);
+    struct HostRequest requests[3];
+
+    requests[0].type = HOST_CREATE_WORLD;
+    requests[0].num_rooms = 10;
+    requests[0].seed = 1;
+    host_submit(host, requests, 1);
+    host_wait(host);
+
+    // When a move names an unknown room and another one uses a room of a
+    // different world
+    requests[1].type = HOST_MOVE;
+    requests[1].world = requests[0].world;
+    requests[1].room = requests[0].room;
+    requests[1].name = "Room 99";
+    requests[2].type = HOST_MOVE;
+    requests[2].world = requests[0].world + 1;
+    requests[2].room = requests[0].room;
+    requests[2].name = requests[0].room->connections[0]->name;
+    host_submit(host, requests + 1, 2);
+    host_wait(host);
+
+    // Then
+    CuAssertIntEquals(tc, false, requests[1].ok);
+    CuAssertPtrEquals(tc, (struct Room*) requests[0].room,
+            (struct Room*) requests[1].room);
+    CuAssertIntEquals(tc, false, requests[2].ok);
+
+    // Clean up
+    del_world_host(host);
+}
+
+void host_destroy_world_should_free_its_id(CuTest *tc) {
+    // Given
+    struct WorldHost *host = new_world_host(2, 2);
+    struct HostRequest requests[4];
+    struct HostStats stats;
+    size_t i;
+
+    for (i = 0; i < 3; ++i) {
+        requests[i].type = HOST_CREATE_WORLD;
+        requests[i].num_rooms = 5;
+        requests[i].seed = i;
+    }
+
+    host_submit(host, requests, 3);
+    host_wait(host);
+
+    // When
+    requests[3].type = HOST_DESTROY_WORLD;
+    requests[3].world = requests[0].world;
+    host_submit(host, requests + 3, 1);
+    host_submit(host, requests + 2, 1);
+    host_wait(host);
+    host_stats(host, &stats);
+
+    // Then the third world only fits once the first is gone
+    CuAssertIntEquals(tc, true, requests[3].ok);
+    CuAssertIntEquals(tc, true, requests[2].ok);
+    CuAssertIntEquals(tc, requests[0].world, requests[2].world);
+    CuAssertIntEquals(tc, 2, stats.live_worlds);
+    CuAssertIntEquals(tc, 3, stats.worlds_created);
+    CuAssertIntEquals(tc, 1, stats.worlds_destroyed);
+
+    // Clean up
+    del_world_host(host);
+}
+
+void host_destroy_world_when_not_alive_should_fail(CuTest *tc) {
+    // Given
+    struct WorldHost *host = new_world_host(1, 4);
+    struct HostRequest first;
+    struct HostRequest destroy[3];
+    struct HostRequest create[2];
+    struct HostStats stats;
+    size_t i;
+
+    first.type = HOST_CREATE_WORLD;
+    first.num_rooms = 5;
+    first.seed = 1;
+    host_submit(host, &first, 1);
+    host_wait(host);
+
+    // When a world that was never created is destroyed, the first world is
+    // destroyed twice and then two more worlds are created
+    destroy[0].type = HOST_DESTROY_WORLD;
+    destroy[0].world = 3;
+    destroy[1].type = HOST_DESTROY_WORLD;
+    destroy[1].world = first.world;
+    destroy[2] = destroy[1];
+
+    for (i = 0; i < 2; ++i) {
+        create[i].type = HOST_CREATE_WORLD;
+        create[i].num_rooms = 5;
+        create[i].seed = i;
+    }
+
+    host_submit(host, destroy, 3);
+    host_submit(host, create, 2);
+    host_wait(host);
+    host_stats(host, &stats);
+
+    // Then
+    CuAssertIntEquals(tc, false, destroy[0].ok);
+    CuAssertIntEquals(tc, true, destroy[1].ok);
+    CuAssertIntEquals(tc, false, destroy[2].ok);
+    CuAssertIntEquals(tc, true, create[0].ok);
+    CuAssertIntEquals(tc, true, create[1].ok);
+    CuAssertTrue(tc, create[0].world != create[1].world);
+    CuAssertIntEquals(tc, 2, stats.live_worlds);
+    CuAssertIntEquals(tc, 1, stats.worlds_destroyed);
+
+    // Clean up
+    del_world_host(host);
+}
+
+CuSuite *get_world_host_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, host_move_should_follow_connections_of_its_world);
+    SUITE_ADD_TEST(suite, host_move_when_not_connected_should_fail);
+    SUITE_ADD_TEST(suite, host_destroy_world_should_free_its_id);
+    SUITE_ADD_TEST(suite, host_destroy_world_when_not_alive_should_fail);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Builds the same world as new_hosted_world out of Rooms on the shared heap,
+ * the way worlds are built everywhere else.
+ */
+static struct RoomList *new_heap_world(const size_t num_rooms,
+        const uint64_t seed) {
+    struct RoomList *world = new_room_list();
+    struct Room *rooms[HOST_MAX_ROOMS];
+    struct BitsetWorld *layout = new_bitset_world(num_rooms);
+    struct Xoshiro256 rng;
+    char name[HOST_NAME_SIZE];
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < num_rooms; ++i) {
+        snprintf(name, sizeof(name), "Room %u", (unsigned) i);
+        rooms[i] = new_room(name, i == 0 ? START_ROOM : MID_ROOM);
+        add_room(world, rooms[i]);
+    }
+
+    seed_xoshiro(&rng, seed);
+    connect_bitset_world(layout, 3, &rng);
+
+    for (i = 0; i < num_rooms; ++i) {
+        for (j = i + 1; j < num_rooms; ++j) {
+            if (bitset_connected(layout, i, j)) {
+                add_connection(rooms[i], rooms[j]);
+            }
+        }
+    }
+
+    del_bitset_world(layout);
+
+    return world;
+}
+
+void run_world_host_benchmark() {
+    const size_t num_worlds = 10000;
+    const size_t num_rooms = 12;
+    const size_t num_rounds = 100;
+    const size_t num_workers = default_num_threads() < 4 ? 4
+        : default_num_threads();
+    struct WorldHost *host = new_world_host(num_workers, num_worlds);
+    struct HostRequest *requests = (struct HostRequest*) malloc(num_worlds *
+            sizeof(struct HostRequest));
+    struct RoomList **heap_worlds = (struct RoomList**) malloc(num_worlds *
+            sizeof(struct RoomList*));
+    struct Xoshiro256 rng;
+    struct HostStats stats;
+    size_t i;
+    size_t r;
+
+    seed_xoshiro(&rng, 42);
+
+    double start = now_seconds();
+
+    for (i = 0; i < num_worlds; ++i) {
+        heap_worlds[i] = new_heap_world(num_rooms, i);
+    }
+
+    const double heap_create = now_seconds() - start;
+    start = now_seconds();
+
+    for (i = 0; i < num_worlds; ++i) {
+        del_world(heap_worlds[i]);
+    }
+
+    const double heap_destroy = now_seconds() - start;
+
+    printf("world_host: shared heap, 1 thread: %.0f worlds created/s, "
+            "%.0f destroyed/s\n", num_worlds / heap_create,
+            num_worlds / heap_destroy);
+
+    for (i = 0; i < num_worlds; ++i) {
+        requests[i].type = HOST_CREATE_WORLD;
+        requests[i].num_rooms = num_rooms;
+        requests[i].seed = i;
+    }
+
+    start = now_seconds();
+    host_submit(host, requests, num_worlds);
+    host_wait(host);
+
+    const double host_create = now_seconds() - start;
+
+    // One session per world; every round moves each of them once
+    const struct Room **sessions = (const struct Room**) malloc(num_worlds *
+            sizeof(struct Room*));
+    uint32_t *ids = (uint32_t*) malloc(num_worlds * sizeof(uint32_t));
+
+    for (i = 0; i < num_worlds; ++i) {
+        sessions[i] = requests[i].room;
+        ids[i] = requests[i].world;
+    }
+
+    start = now_seconds();
+
+    for (r = 0; r < num_rounds; ++r) {
+        for (i = 0; i < num_worlds; ++i) {
+            requests[i].type = HOST_MOVE;
+            requests[i].world = ids[i];
+            requests[i].room = sessions[i];
+            requests[i].name = sessions[i]->connections[xoshiro_below(&rng,
+                    sessions[i]->num_connections)]->name;
+        }
+
+        host_submit(host, requests, num_worlds);
+        host_wait(host);
+
+        for (i = 0; i < num_worlds; ++i) {
+            sessions[i] = requests[i].room;
+        }
+    }
+
+    const double move_seconds = now_seconds() - start;
+
+    host_stats(host, &stats);
+    printf("world_host: %zu workers, %zu worlds of %zu rooms (%.0f bytes "
+            "each): %.0f worlds created/s\n", num_workers, stats.live_worlds,
+            num_rooms, (double) stats.world_bytes / stats.live_worlds,
+            num_worlds / host_create);
+    printf("world_host: %zu moves in batches of %zu: %.1f M moves/s, latency "
+            "mean %.1f us, max %.1f us\n", stats.moves, num_worlds,
+            stats.moves / move_seconds / 1e6, stats.mean_move_us,
+            stats.max_move_us);
+
+    // A lone move pays the full handoff to its worker and back
+    start = now_seconds();
+
+    for (i = 0; i < num_worlds; ++i) {
+        requests[0].type = HOST_MOVE;
+        requests[0].world = ids[i];
+        requests[0].room = sessions[i];
+        requests[0].name = sessions[i]->connections[0]->name;
+        host_submit(host, requests, 1);
+        host_wait(host);
+    }
+
+    printf("world_host: %zu lone moves: %.1f us round trip\n", num_worlds,
+            (now_seconds() - start) / num_worlds * 1e6);
+
+    for (i = 0; i < num_worlds; ++i) {
+        requests[i].type = HOST_DESTROY_WORLD;
+        requests[i].world = ids[i];
+    }
+
+    start = now_seconds();
+    host_submit(host, requests, num_worlds);
+    host_wait(host);
+
+    printf("world_host: %.0f worlds destroyed/s\n",
+            num_worlds / (now_seconds() - start));
+
+    free(ids);
+    free(sessions);
+    free(heap_worlds);
+    free(requests);
+    del_world_host(host);
+}
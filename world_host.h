@@ -0,0 +1,93 @@
+#ifndef WORLD_HOST_H
+#define WORLD_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "room.h"
+#include "utils.h"
+
+/*
+ * A world host runs many small independent worlds in one process. Each world
+ * lives in a single memory region of its own, holding its rooms, their names
+ * and the world itself, so it is created with one allocation and destroyed
+ * with one free. Every world is owned by one of a fixed set of worker threads,
+ * each pinned to a CPU, and every request for a world is routed to its owner,
+ * so a world is only ever touched by one thread and needs no locking.
+ *
+ * Requests are submitted in batches from a single client thread and complete
+ * asynchronously; host_wait returns once every submitted request is done.
+ */
+
+/*
+ * The most rooms a hosted world can have.
+ */
+#define HOST_MAX_ROOMS 256
+
+/*
+ * The id of no world.
+ */
+#define HOST_WORLD_NONE UINT32_MAX
+
+/*
+ * The kinds of requests a WorldHost serves.
+ */
+typedef enum {
+    HOST_CREATE_WORLD,
+    HOST_DESTROY_WORLD,
+    HOST_MOVE
+} host_request_t;
+
+/*
+ * A structure that stores one request and, once it is done, its outcome.
+ *
+ * HOST_CREATE_WORLD builds a world of num_rooms rooms with at least three
+ * connections each from seed. host_submit fills in the id of the new world and
+ * the request sets room to its START_ROOM.
+ *
+ * HOST_DESTROY_WORLD tears down world at once.
+ *
+ * HOST_MOVE moves a session of world from room to the connection of room
+ * called name and sets room to it. Rooms stay readable by the client until
+ * their world is destroyed.
+ *
+ * ok tells whether the request succeeded and latency_us how long it took from
+ * submission to completion.
+ */
+struct HostRequest {
+    host_request_t type;
+    uint32_t world;
+    size_t num_rooms;
+    uint64_t seed;
+    const struct Room *room;
+    const char *name;
+    bool ok;
+    double submitted;
+    double latency_us;
+};
+
+/*
+ * A structure that stores the counters of a WorldHost, summed over its
+ * workers.
+ */
+struct HostStats {
+    size_t live_worlds;
+    size_t worlds_created;
+    size_t worlds_destroyed;
+    size_t world_bytes;
+    size_t moves;
+    double mean_move_us;
+    double max_move_us;
+};
+
+struct WorldHost *new_world_host(size_t num_workers, const size_t max_worlds);
+
+void del_world_host(struct WorldHost *host);
+
+void host_submit(struct WorldHost *host, struct HostRequest *requests,
+        const size_t num_requests);
+
+void host_wait(struct WorldHost *host);
+
+void host_stats(const struct WorldHost *host, struct HostStats *stats);
+
+#endif
@@ -0,0 +1,608 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "world.h"
+#include "world_codec.h"
+#include "world_generator.h"
+#include "world_save.h"
+#include "CuTest.h"
+
+static const char MANIFEST_NAME[] = "MANIFEST";
+static const char ROOM_SUFFIX[] = ".room";
+static const char PREVIOUS_SUFFIX[] = ".prev";
+
+/*
+ * Builds the path of the file of the room with the given name. Bytes that
+ * could make the name a path or a hidden file are escaped as %XX.
+ */
+static char *new_room_path(const char *dir, const char *name) {
+    const size_t dir_length = strlen(dir);
+    char *path = (char*) malloc(dir_length + 1 + 3 * strlen(name)
+            + sizeof(ROOM_SUFFIX));
+    char *out = path + dir_length + 1;
+    const char *in;
+
+    memcpy(path, dir, dir_length);
+    path[dir_length] = '/';
+
+    for (in = name; *in != '\0'; ++in) {
+        const unsigned char c = (unsigned char) *in;
+
+        if (c == '/' || c == '%' || c < 0x20 || c == 0x7f
+                || (c == '.' && in == name)) {
+            out += sprintf(out, "%%%02X", c);
+        } else {
+            *out++ = (char) c;
+        }
+    }
+
+    memcpy(out, ROOM_SUFFIX, sizeof(ROOM_SUFFIX));
+
+    return path;
+}
+
+/*
+ * Writes size bytes to path by way of a synced temporary file that is then
+ * renamed over it.
+ */
+static bool write_file_atomically(const char *path, const char *data,
+        const size_t size) {
+    const size_t path_length = strlen(path);
+    char *temp_path = (char*) malloc(path_length + 5);
+    bool ok;
+
+    memcpy(temp_path, path, path_length);
+    memcpy(temp_path + path_length, ".tmp", 5);
+
+    const int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    ok = fd >= 0 && write(fd, data, size) == (ssize_t) size
+        && fdatasync(fd) == 0;
+    ok = fd >= 0 && close(fd) == 0 && ok;
+    ok = ok && rename(temp_path, path) == 0;
+
+    if (!ok) {
+        unlink(temp_path);
+    }
+
+    free(temp_path);
+
+    return ok;
+}
+
+static bool sync_dir(const char *dir) {
+    const int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    bool ok = fd >= 0 && fsync(fd) == 0;
+
+    return fd >= 0 && close(fd) == 0 && ok;
+}
+
+/*
+ * Builds the path of the previous copy of the room file at path.
+ */
+static char *new_previous_path(const char *path) {
+    const size_t path_length = strlen(path);
+    char *previous = (char*) malloc(path_length + sizeof(PREVIOUS_SUFFIX));
+
+    memcpy(previous, path, path_length);
+    memcpy(previous + path_length, PREVIOUS_SUFFIX, sizeof(PREVIOUS_SUFFIX));
+
+    return previous;
+}
+
+/*
+ * Opens a room file and reads the generation it was saved in, leaving the
+ * file at the room's text. Returns NULL if the file is missing or has no
+ * generation.
+ */
+static FILE *open_room_file(const char *path, uint64_t *generation) {
+    FILE *file = fopen(path, "r");
+
+    if (file != NULL && fscanf(file, "GENERATION: %lu\n",
+                (unsigned long*) generation) != 1) {
+        fclose(file);
+        file = NULL;
+    }
+
+    return file;
+}
+
+/*
+ * Keeps the room file at path as its previous copy if it belongs to a
+ * complete save, so that it survives being replaced by a save that does not
+ * complete. A copy from a save that did not complete is never kept.
+ */
+static void keep_previous_copy(const char *path, const uint64_t generation) {
+    uint64_t file_generation;
+    FILE *file = open_room_file(path, &file_generation);
+
+    if (file == NULL) {
+        return;
+    }
+
+    fclose(file);
+
+    if (file_generation <= generation) {
+        char *previous = new_previous_path(path);
+
+        unlink(previous);
+        link(path, previous);
+        free(previous);
+    }
+}
+
+/*
+ * Reads the generation from the manifest of dir. Returns false if there is
+ * no valid manifest.
+ */
+static bool read_manifest(const char *dir, uint64_t *generation) {
+    char path[4096];
+    FILE *file;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, MANIFEST_NAME);
+    file = fopen(path, "r");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    const bool ok = fscanf(file, "GENERATION: %lu\n",
+            (unsigned long*) generation) == 1;
+
+    fclose(file);
+
+    return ok;
+}
+
+/*
+ * Saves the dirty rooms of a world into dir, creating it if needed, and
+ * marks them clean. If dir holds no complete save yet every room is written.
+ * A crash part way through leaves every file either old or new and the
+ * manifest at the previous generation. Each room file is stamped with the
+ * generation it was written in, and the copy it replaces is kept as a
+ * previous copy for load_world to fall back to.
+ *
+ * Rooms removed from the world keep their files until remove_saved_room is
+ * called for them.
+ *
+ * @param dir The directory to save into.
+ * @param world A pointer to a RoomList.
+ * @param stats A pointer to the SaveStats to fill in, or NULL.
+ * @return Whether every file was written.
+ */
+bool save_world(const char *dir, struct RoomList *world,
+        struct SaveStats *stats) {
+    const double start = now_seconds();
+    uint64_t generation = 0;
+    size_t written = 0;
+    char *buffer = NULL;
+    size_t size = 0;
+    struct RoomLink *curr;
+    bool ok = true;
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+
+    const bool full = !read_manifest(dir, &generation);
+    FILE *text = open_memstream(&buffer, &size);
+
+    for (curr = world->head; ok && curr != NULL; curr = curr->next) {
+        struct Room *room = curr->room;
+
+        if (!room->dirty && !full) {
+            continue;
+        }
+
+        char *path = new_room_path(dir, room->name);
+
+        if (!full) {
+            keep_previous_copy(path, generation);
+        }
+
+        rewind(text);
+        fprintf(text, "GENERATION: %lu\n", (unsigned long) (generation + 1));
+        fprint_room(text, room);
+        fflush(text);
+        ok = write_file_atomically(path, buffer, ftell(text));
+        room->dirty = room->dirty && !ok;
+        written += ok;
+        free(path);
+    }
+
+    fclose(text);
+    free(buffer);
+
+    char manifest[128];
+    char path[4096];
+    const int manifest_size = snprintf(manifest, sizeof(manifest),
+            "GENERATION: %lu\nROOMS: %zu\nWRITTEN: %zu\n",
+            (unsigned long) (generation + 1), world->size, written);
+
+    // Renames are only durable once the directory is synced
+    snprintf(path, sizeof(path), "%s/%s", dir, MANIFEST_NAME);
+    ok = ok && sync_dir(dir)
+        && write_file_atomically(path, manifest, manifest_size)
+        && sync_dir(dir);
+
+    if (stats != NULL) {
+        stats->generation = ok ? generation + 1 : generation;
+        stats->rooms_total = world->size;
+        stats->rooms_written = written;
+        stats->seconds = now_seconds() - start;
+    }
+
+    return ok;
+}
+
+/*
+ * Deletes the file of the room with the given name, and its previous copy,
+ * from a saved world.
+ */
+bool remove_saved_room(const char *dir, const char *name) {
+    char *path = new_room_path(dir, name);
+    char *previous = new_previous_path(path);
+    const bool ok = unlink(path) == 0;
+
+    unlink(previous);
+    free(previous);
+    free(path);
+
+    return ok;
+}
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(char *const*) a, *(char *const*) b);
+}
+
+/*
+ * Loads a world saved by save_world. Rooms come back in the order of their
+ * file names and clean. Room files written by a save that did not complete
+ * are newer than the manifest; the previous copy is read in their place, and
+ * rooms that have none did not exist in the last complete save.
+ *
+ * @param dir The directory of the saved world.
+ * @return A pointer to a new world or NULL if dir holds no complete save or a
+ * room file is malformed or has no copy from a complete save.
+ */
+struct RoomList *load_world(const char *dir) {
+    const size_t suffix_length = strlen(ROOM_SUFFIX);
+    uint64_t generation;
+    DIR *handle;
+
+    if (!read_manifest(dir, &generation)
+            || (handle = opendir(dir)) == NULL) {
+        return NULL;
+    }
+
+    size_t capacity = 64;
+    size_t num_files = 0;
+    char **files = (char**) malloc(capacity * sizeof(char*));
+    const struct dirent *entry;
+
+    while ((entry = readdir(handle)) != NULL) {
+        const size_t length = strlen(entry->d_name);
+
+        if (length <= suffix_length || strcmp(entry->d_name + length
+                    - suffix_length, ROOM_SUFFIX) != 0) {
+            continue;
+        }
+
+        if (num_files == capacity) {
+            capacity *= 2;
+            files = (char**) realloc(files, capacity * sizeof(char*));
+        }
+
+        files[num_files++] = new_str_from(entry->d_name);
+    }
+
+    closedir(handle);
+    qsort(files, num_files, sizeof(char*), compare_strings);
+
+    // Stitch the room files together into one text world
+    char *buffer = NULL;
+    size_t size = 0;
+    FILE *text = open_memstream(&buffer, &size);
+    char chunk[4096];
+    char path[4096];
+    bool ok = true;
+    size_t i;
+
+    for (i = 0; i < num_files; ++i) {
+        uint64_t file_generation;
+        size_t n;
+
+        snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+        FILE *file = ok ? open_room_file(path, &file_generation) : NULL;
+
+        ok = ok && file != NULL;
+
+        if (ok && file_generation > generation) {
+            char *previous = new_previous_path(path);
+
+            fclose(file);
+            file = open_room_file(previous, &file_generation);
+            ok = file == NULL || file_generation <= generation;
+            free(previous);
+        }
+
+        while (file != NULL && (n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            fwrite(chunk, 1, n, text);
+        }
+
+        if (file != NULL) {
+            fclose(file);
+        }
+
+        free(files[i]);
+    }
+
+    free(files);
+    fclose(text);
+
+    struct RoomList *world = NULL;
+
+    if (ok) {
+        FILE *in = fmemopen(buffer, size, "r");
+
+        world = size > 0 ? read_text_world(in) : new_room_list();
+        fclose(in);
+    }
+
+    free(buffer);
+
+    if (world != NULL) {
+        struct RoomLink *curr;
+
+        for (curr = world->head; curr != NULL; curr = curr->next) {
+            curr->room->dirty = false;
+        }
+    }
+
+    return world;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void load_world_should_read_back_saved_world(CuTest *tc) {
+    // Given
+    char dir[64];
+    struct RoomList *world = new_random_world(30, 3, 1);
+    struct RoomLink *curr;
+    size_t i;
+    test_path(dir, sizeof(dir), "world_save_test", "");
+    add_room(world, new_room("../Escaped/%Room", MID_ROOM));
+
+    // When
+    CuAssertIntEquals(tc, true, save_world(dir, world, NULL));
+    struct RoomList *actual = load_world(dir);
+
+    // Then
+    CuAssertPtrNotNull(tc, actual);
+    CuAssertIntEquals(tc, world->size, actual->size);
+
+    for (curr = actual->head; curr != NULL; curr = curr->next) {
+        const struct RoomLink *other = world->head;
+
+        while (strcmp(other->room->name, curr->room->name) != 0) {
+            other = other->next;
+        }
+
+        CuAssertIntEquals(tc, false, curr->room->dirty);
+        CuAssertIntEquals(tc, other->room->type, curr->room->type);
+        CuAssertIntEquals(tc, other->room->num_connections,
+                curr->room->num_connections);
+
+        for (i = 0; i < curr->room->num_connections; ++i) {
+            CuAssertPtrNotNull(tc, find_connection(other->room,
+                        curr->room->connections[i]->name));
+        }
+    }
+
+    // Clean up
+    del_world(actual);
+    del_world(world);
+    remove_dir(dir);
+}
+
+void save_world_should_only_write_dirty_rooms(CuTest *tc) {
+    // Given
+    char dir[64];
+    struct RoomList *world = new_random_world(100, 3, 1);
+    struct Room *room = world->head->room;
+    struct SaveStats first;
+    struct SaveStats unchanged;
+    struct SaveStats edited;
+    test_path(dir, sizeof(dir), "world_save_test", "");
+
+    // When
+    CuAssertIntEquals(tc, true, save_world(dir, world, &first));
+    CuAssertIntEquals(tc, true, save_world(dir, world, &unchanged));
+    remove_connection(room, room->connections[0]);
+    CuAssertIntEquals(tc, true, save_world(dir, world, &edited));
+
+    // Then
+    CuAssertIntEquals(tc, 100, first.rooms_written);
+    CuAssertIntEquals(tc, 0, unchanged.rooms_written);
+    CuAssertIntEquals(tc, 2, edited.rooms_written);
+    CuAssertTrue(tc, edited.generation == 3);
+    CuAssertIntEquals(tc, false, room->dirty);
+
+    // Clean up
+    del_world(world);
+    remove_dir(dir);
+}
+
+void save_world_when_no_manifest_should_write_every_room(CuTest *tc) {
+    // Given a world that is clean but was never saved to this directory
+    char dir[64];
+    struct RoomList *world = new_random_world(20, 3, 1);
+    struct SaveStats stats;
+    struct RoomLink *curr;
+    test_path(dir, sizeof(dir), "world_save_test", "");
+
+    for (curr = world->head; curr != NULL; curr = curr->next) {
+        curr->room->dirty = false;
+    }
+
+    // When
+    CuAssertIntEquals(tc, true, save_world(dir, world, &stats));
+
+    // Then
+    CuAssertIntEquals(tc, 20, stats.rooms_written);
+    CuAssertTrue(tc, stats.generation == 1);
+
+    // Clean up
+    del_world(world);
+    remove_dir(dir);
+}
+
+void load_world_when_hub_made_after_save_should_read_back_hub(CuTest *tc) {
+    // Given a room made a hub after the world was first saved
+    char dir[64];
+    struct RoomList *world = new_random_world(20, 3, 1);
+    struct Room *room = world->head->room;
+    const struct RoomLink *curr;
+    test_path(dir, sizeof(dir), "world_save_test", "");
+
+    CuAssertIntEquals(tc, true, save_world(dir, world, NULL));
+    CuAssertIntEquals(tc, true, set_max_connections(room, 100));
+
+    // When
+    CuAssertIntEquals(tc, true, save_world(dir, world, NULL));
+    struct RoomList *actual = load_world(dir);
+
+    // Then
+    CuAssertPtrNotNull(tc, actual);
+
+    for (curr = actual->head; curr != NULL; curr = curr->next) {
+        if (strcmp(curr->room->name, room->name) == 0) {
+            CuAssertIntEquals(tc, 100, curr->room->max_connections);
+        }
+    }
+
+    // Clean up
+    del_world(actual);
+    del_world(world);
+    remove_dir(dir);
+}
+
+void load_world_when_save_incomplete_should_read_last_complete_save(
+        CuTest *tc) {
+    // Given a second save whose room files were written but whose manifest
+    // was not, as after a crash
+    char dir[64];
+    char path[4096];
+    struct RoomList *world = new_random_world(20, 3, 1);
+    struct Room *room = world->head->room;
+    const size_t num_connections = room->num_connections;
+    const struct RoomLink *curr;
+    FILE *manifest;
+    test_path(dir, sizeof(dir), "world_save_test", "");
+
+    CuAssertIntEquals(tc, true, save_world(dir, world, NULL));
+    remove_connection(room, room->connections[0]);
+    add_room(world, new_room("Unsaved Room", MID_ROOM));
+    CuAssertIntEquals(tc, true, save_world(dir, world, NULL));
+    snprintf(path, sizeof(path), "%s/MANIFEST", dir);
+    manifest = fopen(path, "w");
+    fputs("GENERATION: 1\n", manifest);
+    fclose(manifest);
+
+    // When
+    struct RoomList *actual = load_world(dir);
+
+    // Then
+    CuAssertPtrNotNull(tc, actual);
+    CuAssertIntEquals(tc, 20, actual->size);
+
+    for (curr = actual->head; curr != NULL; curr = curr->next) {
+        if (strcmp(curr->room->name, room->name) == 0) {
+            CuAssertIntEquals(tc, num_connections,
+                    curr->room->num_connections);
+        }
+    }
+
+    // Clean up
+    del_world(actual);
+    del_world(world);
+    remove_dir(dir);
+}
+
+void load_world_when_no_manifest_should_return_null(CuTest *tc) {
+    // Then
+    CuAssertPtrEquals(tc, NULL, load_world("/tmp/no_such_saved_world"));
+}
+
+CuSuite *get_world_save_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, load_world_should_read_back_saved_world);
+    SUITE_ADD_TEST(suite, save_world_should_only_write_dirty_rooms);
+    SUITE_ADD_TEST(suite, save_world_when_no_manifest_should_write_every_room);
+    SUITE_ADD_TEST(suite, load_world_when_hub_made_after_save_should_read_back_hub);
+    SUITE_ADD_TEST(suite, load_world_when_save_incomplete_should_read_last_complete_save);
+    SUITE_ADD_TEST(suite, load_world_when_no_manifest_should_return_null);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+void run_world_save_benchmark() {
+    const char *dir = "/tmp/world_save_benchmark";
+    const size_t num_rooms = 20000;
+    const size_t edit_counts[] = { 1, 10, 100, 1000 };
+    struct RoomList *world = new_random_world(num_rooms, 3, 1);
+    struct Room **rooms = (struct Room**) malloc(num_rooms *
+            sizeof(struct Room*));
+    struct RoomLink *curr;
+    struct SaveStats stats;
+    struct Xoshiro256 rng;
+    size_t i;
+    size_t e;
+
+    remove_dir(dir);
+    seed_xoshiro(&rng, 1);
+
+    for (i = 0, curr = world->head; curr != NULL; curr = curr->next) {
+        rooms[i++] = curr->room;
+    }
+
+    save_world(dir, world, &stats);
+    printf("world_save: full save of %zu rooms: %.3f s\n",
+            stats.rooms_total, stats.seconds);
+
+    for (e = 0; e < sizeof(edit_counts) / sizeof(edit_counts[0]); ++e) {
+        // Move one end of a connection, which dirties up to three rooms
+        for (i = 0; i < edit_counts[e]; ++i) {
+            struct Room *room = rooms[xoshiro_below(&rng, num_rooms)];
+            struct Room *other = rooms[xoshiro_below(&rng, num_rooms)];
+
+            if (room->num_connections > 0) {
+                remove_connection(room, room->connections[0]);
+            }
+
+            if (find_connection(room, other->name) == NULL) {
+                add_connection(room, other);
+            }
+        }
+
+        save_world(dir, world, &stats);
+        printf("world_save: %4zu edits: %5zu rooms written in %.4f s\n",
+                edit_counts[e], stats.rooms_written, stats.seconds);
+    }
+
+    free(rooms);
+    del_world(world);
+    remove_dir(dir);
+}
@@ -0,0 +1,36 @@
+#ifndef WORLD_SAVE_H
+#define WORLD_SAVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "room.h"
+#include "room_list.h"
+
+/*
+ * A saved world is a directory with one file per room, holding the
+ * generation it was saved in and the room's print_room text, and a MANIFEST
+ * naming the generation of the last complete save. Saves are incremental:
+ * only rooms marked dirty are rewritten, so a checkpoint costs I/O in
+ * proportion to the rooms changed since the last one.
+ * Every file is replaced atomically by writing a temporary file and renaming
+ * it over the old one, and the manifest is replaced last.
+ */
+
+/*
+ * A structure that stores what a save did.
+ */
+struct SaveStats {
+    uint64_t generation;
+    size_t rooms_total;
+    size_t rooms_written;
+    double seconds;
+};
+
+bool save_world(const char *dir, struct RoomList *world,
+        struct SaveStats *stats);
+
+bool remove_saved_room(const char *dir, const char *name);
+
+struct RoomList *load_world(const char *dir);
+
+#endif
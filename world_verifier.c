@@ -0,0 +1,641 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "world_verifier.h"
+#include "room_index.h"
+#include "world.h"
+#include "CuTest.h"
+
+/*
+ * The state shared by the verifier threads. Each thread writes only to its own
+ * partial report; the union-find forest used for the connectivity check is
+ * updated lock-free with compare-and-swap.
+ */
+struct VerifyTask {
+    const struct RoomIndex *index;
+    size_t min_connections;
+    size_t *parent;
+    struct VerifyReport *partials;
+};
+
+/*
+ * Counts a violation and keeps its details if there is room for them.
+ */
+static void record_violation(struct VerifyReport *report, violation_t type,
+        const struct Room *room, const struct Room *other) {
+    report->counts[type]++;
+    report->num_violations++;
+
+    if (report->num_recorded < MAX_RECORDED_VIOLATIONS) {
+        struct Violation *violation = &report->recorded[report->num_recorded++];
+        violation->type = type;
+        violation->room = room;
+        violation->other = other;
+    }
+}
+
+/*
+ * Finds the root of x, halving the path on the way up.
+ */
+static size_t find_root(size_t *parent, size_t x) {
+    size_t p = __atomic_load_n(&parent[x], __ATOMIC_RELAXED);
+
+    while (p != x) {
+        size_t gp = __atomic_load_n(&parent[p], __ATOMIC_RELAXED);
+        __atomic_compare_exchange_n(&parent[x], &p, gp, false,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        x = p;
+        p = __atomic_load_n(&parent[x], __ATOMIC_RELAXED);
+    }
+
+    return x;
+}
+
+/*
+ * Merges the sets of a and b. Roots are always linked to a smaller root which
+ * rules out cycles when several threads race on the same sets.
+ */
+static void union_rooms(size_t *parent, size_t a, size_t b) {
+    while (true) {
+        a = find_root(parent, a);
+        b = find_root(parent, b);
+
+        if (a == b) {
+            return;
+        }
+
+        if (a < b) {
+            size_t tmp = a;
+            a = b;
+            b = tmp;
+        }
+
+        size_t expected = a;
+
+        if (__atomic_compare_exchange_n(&parent[a], &expected, b, false,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+}
+
+/*
+ * Returns whether the connections of room id contain target.
+ */
+static bool lists_neighbor(const struct RoomIndex *index, size_t id,
+        size_t target) {
+    size_t j;
+
+    // Hubs answer from their lookup rather than a scan of every connection
+    if (index->rooms[id]->lookup_type != CONNECTIONS_SCANNED) {
+        return has_connection(index->rooms[id], index->rooms[target]);
+    }
+
+    for (j = index->offsets[id]; j < index->offsets[id + 1]; ++j) {
+        if (index->neighbors[j] == target) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * A neighbour id and the position it is listed at.
+ */
+struct ListedNeighbor {
+    size_t id;
+    size_t position;
+};
+
+static int compare_listed_neighbors(const void *a, const void *b) {
+    const struct ListedNeighbor *n1 = (const struct ListedNeighbor*) a;
+    const struct ListedNeighbor *n2 = (const struct ListedNeighbor*) b;
+
+    if (n1->id != n2->id) {
+        return n1->id < n2->id ? -1 : 1;
+    }
+
+    return n1->position < n2->position ? -1 : (n1->position > n2->position);
+}
+
+/*
+ * Sets duplicate[j] for every neighbour listed at an earlier position too.
+ * Ordinary rooms compare every pair; hubs sort their neighbours instead.
+ */
+static void mark_duplicates(const size_t *neighbors, const size_t n,
+        bool *duplicate) {
+    size_t j;
+    size_t k;
+
+    for (j = 0; j < n; ++j) {
+        duplicate[j] = false;
+    }
+
+    if (n <= ROOM_MAX_CONNECTIONS) {
+        for (j = 0; j < n; ++j) {
+            for (k = 0; k < j && !duplicate[j]; ++k) {
+                duplicate[j] = neighbors[k] == neighbors[j];
+            }
+        }
+
+        return;
+    }
+
+    struct ListedNeighbor *listed = (struct ListedNeighbor*) malloc(n *
+            sizeof(struct ListedNeighbor));
+
+    for (j = 0; j < n; ++j) {
+        listed[j].id = neighbors[j];
+        listed[j].position = j;
+    }
+
+    qsort(listed, n, sizeof(struct ListedNeighbor), compare_listed_neighbors);
+
+    for (j = 1; j < n; ++j) {
+        if (listed[j].id == listed[j - 1].id) {
+            duplicate[listed[j].position] = true;
+        }
+    }
+
+    free(listed);
+}
+
+/*
+ * Checks every per-room invariant of the rooms in [begin, end) and unions each
+ * room with its connections.
+ */
+static void verify_range(void *ctx, size_t begin, size_t end, size_t thread) {
+    struct VerifyTask *task = (struct VerifyTask*) ctx;
+    const struct RoomIndex *index = task->index;
+    struct VerifyReport *report = &task->partials[thread];
+    bool small_duplicate[ROOM_MAX_CONNECTIONS];
+    size_t u;
+    size_t j;
+
+    for (u = begin; u < end; ++u) {
+        const struct Room *room = index->rooms[u];
+        const size_t *neighbors = index->neighbors + index->offsets[u];
+        bool *duplicate = room->num_connections <= ROOM_MAX_CONNECTIONS
+            ? small_duplicate
+            : (bool*) malloc(room->num_connections * sizeof(bool));
+
+        if (room_index_find(index, room) != u) {
+            // The rest of the checks already ran for the first appearance
+            record_violation(report, VIOLATION_DUPLICATE_ROOM, room, NULL);
+
+            if (duplicate != small_duplicate) {
+                free(duplicate);
+            }
+
+            continue;
+        }
+
+        if (room->type == START_ROOM) {
+            report->num_start_rooms++;
+        } else if (room->type == END_ROOM) {
+            report->num_end_rooms++;
+        }
+
+        if (room->num_connections < task->min_connections) {
+            record_violation(report, VIOLATION_TOO_FEW_CONNECTIONS, room, NULL);
+        } else if (room->num_connections > room->max_connections) {
+            record_violation(report, VIOLATION_TOO_MANY_CONNECTIONS, room, NULL);
+        }
+
+        mark_duplicates(neighbors, room->num_connections, duplicate);
+
+        for (j = 0; j < room->num_connections; ++j) {
+            const size_t v = neighbors[j];
+            const struct Room *other = room->connections[j];
+
+            if (v == ROOM_INDEX_NONE) {
+                record_violation(report, VIOLATION_UNKNOWN_ROOM, room, other);
+                continue;
+            }
+
+            if (v == u) {
+                record_violation(report, VIOLATION_SELF_LOOP, room, other);
+                continue;
+            }
+
+            if (duplicate[j]) {
+                record_violation(report, VIOLATION_DUPLICATE_CONNECTION, room,
+                        other);
+                continue;
+            }
+
+            if (!lists_neighbor(index, v, u)) {
+                record_violation(report, VIOLATION_ASYMMETRIC_CONNECTION, room,
+                        other);
+            }
+
+            if (u < v) {
+                union_rooms(task->parent, u, v);
+            }
+        }
+
+        if (duplicate != small_duplicate) {
+            free(duplicate);
+        }
+    }
+}
+
+/*
+ * Verifies the invariants the game relies on: every Room is listed once, every
+ * connection points to a Room of the world, is not a self loop, is not listed
+ * twice and is listed by the other Room too, every Room has between
+ * min_connections and its max_connections connections, there is exactly one
+ * START_ROOM and one END_ROOM and every Room is reachable from every other.
+ *
+ * The per-room checks and the union-find connectivity check run in a single
+ * sweep over num_threads threads (0 means one per online processor). Each
+ * connection of an ordinary Room is checked with O(degree) work; hubs sort
+ * their neighbours and answer reverse lookups from their index so they cost
+ * O(degree log degree) rather than O(degree^2).
+ *
+ * @param world A pointer to a RoomList.
+ * @param min_connections The minimum number of connections of every Room.
+ * @param num_threads The number of threads to verify with.
+ * @return A pointer to a new VerifyReport.
+ */
+struct VerifyReport *verify_world(const struct RoomList *world,
+        size_t min_connections, size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = default_num_threads();
+    }
+
+    struct RoomIndex *index = new_room_index(world, num_threads);
+    struct VerifyReport *report = (struct VerifyReport*) calloc(1,
+            sizeof(struct VerifyReport));
+    struct VerifyTask task;
+    size_t i;
+    size_t t;
+
+    task.index = index;
+    task.min_connections = min_connections;
+    task.parent = (size_t*) malloc((index->size + 1) * sizeof(size_t));
+    task.partials = (struct VerifyReport*) calloc(num_threads,
+            sizeof(struct VerifyReport));
+
+    for (i = 0; i < index->size; ++i) {
+        task.parent[i] = i;
+    }
+
+    parallel_for(index->size, num_threads, verify_range, &task);
+
+    // Merge the partial reports in thread order which is also room order
+    report->num_rooms = index->size;
+
+    for (t = 0; t < num_threads; ++t) {
+        const struct VerifyReport *partial = &task.partials[t];
+
+        report->num_start_rooms += partial->num_start_rooms;
+        report->num_end_rooms += partial->num_end_rooms;
+
+        for (i = 0; i < NUM_VIOLATION_TYPES; ++i) {
+            report->counts[i] += partial->counts[i];
+        }
+
+        report->num_violations += partial->num_violations;
+
+        for (i = 0; i < partial->num_recorded
+                && report->num_recorded < MAX_RECORDED_VIOLATIONS; ++i) {
+            report->recorded[report->num_recorded++] = partial->recorded[i];
+        }
+    }
+
+    if (report->num_start_rooms != 1) {
+        record_violation(report, VIOLATION_START_ROOM_COUNT, NULL, NULL);
+    }
+
+    if (report->num_end_rooms != 1) {
+        record_violation(report, VIOLATION_END_ROOM_COUNT, NULL, NULL);
+    }
+
+    // Every component after the first one is reported through one of its rooms
+    for (i = 0; i < index->size; ++i) {
+        if (task.parent[i] == i && room_index_find(index, index->rooms[i]) == i) {
+            if (report->num_components++ > 0) {
+                record_violation(report, VIOLATION_DISCONNECTED,
+                        index->rooms[i], NULL);
+            }
+        }
+    }
+
+    free(task.partials);
+    free(task.parent);
+    del_room_index(index);
+
+    return report;
+}
+
+/*
+ * Deletes the given VerifyReport.
+ */
+void del_verify_report(struct VerifyReport *report) {
+    free(report);
+}
+
+/*
+ * Returns whether the verified world satisfied every invariant.
+ */
+bool verify_report_ok(const struct VerifyReport *report) {
+    return report->num_violations == 0;
+}
+
+/*
+ * Returns a printable name for a violation type.
+ */
+const char *violation_name(const violation_t type) {
+    switch (type) {
+        case VIOLATION_DUPLICATE_ROOM:
+            return "DUPLICATE_ROOM";
+        case VIOLATION_UNKNOWN_ROOM:
+            return "UNKNOWN_ROOM";
+        case VIOLATION_SELF_LOOP:
+            return "SELF_LOOP";
+        case VIOLATION_DUPLICATE_CONNECTION:
+            return "DUPLICATE_CONNECTION";
+        case VIOLATION_ASYMMETRIC_CONNECTION:
+            return "ASYMMETRIC_CONNECTION";
+        case VIOLATION_TOO_FEW_CONNECTIONS:
+            return "TOO_FEW_CONNECTIONS";
+        case VIOLATION_TOO_MANY_CONNECTIONS:
+            return "TOO_MANY_CONNECTIONS";
+        case VIOLATION_START_ROOM_COUNT:
+            return "START_ROOM_COUNT";
+        case VIOLATION_END_ROOM_COUNT:
+            return "END_ROOM_COUNT";
+        case VIOLATION_DISCONNECTED:
+            return "DISCONNECTED";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+/*
+ * Prints the given VerifyReport.
+ */
+void print_verify_report(const struct VerifyReport *report) {
+    size_t i;
+
+    printf("ROOMS: %zu\n", report->num_rooms);
+    printf("START ROOMS: %zu\n", report->num_start_rooms);
+    printf("END ROOMS: %zu\n", report->num_end_rooms);
+    printf("COMPONENTS: %zu\n", report->num_components);
+    printf("VIOLATIONS: %zu\n", report->num_violations);
+
+    for (i = 0; i < NUM_VIOLATION_TYPES; ++i) {
+        if (report->counts[i] > 0) {
+            printf("  %s: %zu\n", violation_name(i), report->counts[i]);
+        }
+    }
+
+    for (i = 0; i < report->num_recorded; ++i) {
+        const struct Violation *violation = &report->recorded[i];
+
+        printf("VIOLATION %zu: %s %s%s%s\n", i + 1,
+                violation_name(violation->type),
+                violation->room != NULL ? violation->room->name : "",
+                violation->other != NULL ? " -> " : "",
+                violation->other != NULL ? violation->other->name : "");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests
+////////////////////////////////////////////////////////////////////////////////
+
+void verify_world_when_world_valid_should_report_no_violations(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(1000, 6);
+
+    // When
+    struct VerifyReport *report = verify_world(world, 3, 4);
+
+    // Then
+    CuAssertIntEquals(tc, true, verify_report_ok(report));
+    CuAssertIntEquals(tc, 1000, report->num_rooms);
+    CuAssertIntEquals(tc, 1, report->num_start_rooms);
+    CuAssertIntEquals(tc, 1, report->num_end_rooms);
+    CuAssertIntEquals(tc, 1, report->num_components);
+
+    // Clean up
+    del_verify_report(report);
+    del_world(world);
+}
+
+void verify_world_when_self_loop_should_report_self_loop(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 4);
+    struct Room *room = world->head->next->room;
+    room->connections[room->num_connections++] = room;
+
+    // When
+    struct VerifyReport *report = verify_world(world, 3, 2);
+
+    // Then
+    CuAssertIntEquals(tc, 1, report->num_violations);
+    CuAssertIntEquals(tc, 1, report->counts[VIOLATION_SELF_LOOP]);
+    CuAssertPtrEquals(tc, room, (void*) report->recorded[0].room);
+
+    // Clean up
+    del_verify_report(report);
+    del_world(world);
+}
+
+void verify_world_when_connection_one_sided_should_report_asymmetric(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 4);
+    struct Room *room = world->head->room;
+    struct Room *other = world->head->next->next->next->next->next->room;
+    room->connections[room->num_connections++] = other;
+
+    // When
+    struct VerifyReport *report = verify_world(world, 3, 2);
+
+    // Then
+    CuAssertIntEquals(tc, 1, report->num_violations);
+    CuAssertIntEquals(tc, 1, report->counts[VIOLATION_ASYMMETRIC_CONNECTION]);
+    CuAssertPtrEquals(tc, room, (void*) report->recorded[0].room);
+    CuAssertPtrEquals(tc, other, (void*) report->recorded[0].other);
+
+    // Clean up
+    del_verify_report(report);
+    del_world(world);
+}
+
+void verify_world_when_connection_listed_twice_should_report_duplicate(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 4);
+    struct Room *room1 = world->head->room;
+    struct Room *room2 = world->head->next->room;
+    add_connection(room1, room2);
+
+    // When
+    struct VerifyReport *report = verify_world(world, 3, 2);
+
+    // Then
+    CuAssertIntEquals(tc, 2, report->num_violations);
+    CuAssertIntEquals(tc, 2, report->counts[VIOLATION_DUPLICATE_CONNECTION]);
+
+    // Clean up
+    del_verify_report(report);
+    del_world(world);
+}
+
+void verify_world_when_too_few_connections_should_report_degree(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 2);
+
+    // When
+    struct VerifyReport *report = verify_world(world, 3, 2);
+
+    // Then
+    CuAssertIntEquals(tc, 10, report->num_violations);
+    CuAssertIntEquals(tc, 10, report->counts[VIOLATION_TOO_FEW_CONNECTIONS]);
+
+    // Clean up
+    del_verify_report(report);
+    del_world(world);
+}
+
+void verify_world_when_connection_outside_world_should_report_unknown(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 4);
+    struct Room *stranger = new_room("stranger", MID_ROOM);
+    add_connection(world->head->room, stranger);
+
+    // When
+    struct VerifyReport *report = verify_world(world, 3, 2);
+
+    // Then
+    CuAssertIntEquals(tc, 1, report->num_violations);
+    CuAssertIntEquals(tc, 1, report->counts[VIOLATION_UNKNOWN_ROOM]);
+    CuAssertPtrEquals(tc, stranger, (void*) report->recorded[0].other);
+
+    // Clean up
+    del_verify_report(report);
+    del_world(world);
+    del_room(stranger);
+}
+
+void verify_world_when_room_listed_twice_should_report_duplicate_room(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 4);
+    struct RoomList *listing = new_room_list();
+    struct RoomLink *curr;
+
+    for (curr = world->head; curr != NULL; curr = curr->next) {
+        add_room(listing, curr->room);
+    }
+
+    add_room(listing, world->head->next->room);
+
+    // When
+    struct VerifyReport *report = verify_world(listing, 3, 2);
+
+    // Then
+    CuAssertIntEquals(tc, 1, report->num_violations);
+    CuAssertIntEquals(tc, 1, report->counts[VIOLATION_DUPLICATE_ROOM]);
+    CuAssertIntEquals(tc, 1, report->num_components);
+
+    // Clean up
+    del_verify_report(report);
+    del_room_list(listing);
+    del_world(world);
+}
+
+void verify_world_when_two_start_rooms_and_no_end_room_should_report_counts(CuTest *tc) {
+    // Given
+    struct RoomList *world = new_circulant_world(10, 4);
+    world->head->next->room->type = START_ROOM;
+    world->head->next->next->next->next->next->room->type = MID_ROOM;
+
+    // When
+    struct VerifyReport *report = verify_world(world, 3, 2);
+
+    // Then
+    CuAssertIntEquals(tc, 2, report->num_violations);
+    CuAssertIntEquals(tc, 2, report->num_start_rooms);
+    CuAssertIntEquals(tc, 0, report->num_end_rooms);
+    CuAssertIntEquals(tc, 1, report->counts[VIOLATION_START_ROOM_COUNT]);
+    CuAssertIntEquals(tc, 1, report->counts[VIOLATION_END_ROOM_COUNT]);
+
+    // Clean up
+    del_verify_report(report);
+    del_world(world);
+}
+
+void verify_world_when_world_split_should_report_disconnected(CuTest *tc) {
+    // Given two rings where only the first one has a START_ROOM and END_ROOM
+    struct RoomList *world = new_circulant_world(10, 4);
+    struct RoomList *island = new_circulant_world(10, 4);
+    struct RoomList *listing = new_room_list();
+    struct RoomLink *curr;
+
+    for (curr = world->head; curr != NULL; curr = curr->next) {
+        add_room(listing, curr->room);
+    }
+
+    for (curr = island->head; curr != NULL; curr = curr->next) {
+        curr->room->type = MID_ROOM;
+        add_room(listing, curr->room);
+    }
+
+    // When
+    struct VerifyReport *report = verify_world(listing, 3, 3);
+
+    // Then
+    CuAssertIntEquals(tc, 1, report->num_violations);
+    CuAssertIntEquals(tc, 2, report->num_components);
+    CuAssertIntEquals(tc, 1, report->counts[VIOLATION_DISCONNECTED]);
+    CuAssertPtrEquals(tc, island->head->room, (void*) report->recorded[0].room);
+
+    // Clean up
+    del_verify_report(report);
+    del_room_list(listing);
+    del_world(world);
+    del_world(island);
+}
+
+CuSuite *get_world_verifier_suite() {
+    CuSuite *suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, verify_world_when_world_valid_should_report_no_violations);
+    SUITE_ADD_TEST(suite, verify_world_when_self_loop_should_report_self_loop);
+    SUITE_ADD_TEST(suite, verify_world_when_connection_one_sided_should_report_asymmetric);
+    SUITE_ADD_TEST(suite, verify_world_when_connection_listed_twice_should_report_duplicate);
+    SUITE_ADD_TEST(suite, verify_world_when_too_few_connections_should_report_degree);
+    SUITE_ADD_TEST(suite, verify_world_when_connection_outside_world_should_report_unknown);
+    SUITE_ADD_TEST(suite, verify_world_when_room_listed_twice_should_report_duplicate_room);
+    SUITE_ADD_TEST(suite, verify_world_when_two_start_rooms_and_no_end_room_should_report_counts);
+    SUITE_ADD_TEST(suite, verify_world_when_world_split_should_report_disconnected);
+
+    return suite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////
+
+void run_world_verifier_benchmark() {
+    const size_t num_rooms = 1000000;
+    struct RoomList *world = new_circulant_world(num_rooms, 6);
+    size_t num_threads;
+
+    for (num_threads = 1; num_threads <= default_num_threads() * 2;
+            num_threads *= 2) {
+        const double start = now_seconds();
+        struct VerifyReport *report = verify_world(world, 3, num_threads);
+        const double elapsed = now_seconds() - start;
+
+        printf("verify_world: %zu rooms, %zu threads: %.3f s (%zu violations)\n",
+                num_rooms, num_threads, elapsed, report->num_violations);
+
+        del_verify_report(report);
+    }
+
+    del_world(world);
+}
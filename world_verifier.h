@@ -0,0 +1,66 @@
+#ifndef WORLD_VERIFIER_H
+#define WORLD_VERIFIER_H
+
+#include <stddef.h>
+#include "room.h"
+#include "room_list.h"
+
+/*
+ * An enumeration for the invariants a world can violate.
+ */
+typedef enum {
+    VIOLATION_DUPLICATE_ROOM,
+    VIOLATION_UNKNOWN_ROOM,
+    VIOLATION_SELF_LOOP,
+    VIOLATION_DUPLICATE_CONNECTION,
+    VIOLATION_ASYMMETRIC_CONNECTION,
+    VIOLATION_TOO_FEW_CONNECTIONS,
+    VIOLATION_TOO_MANY_CONNECTIONS,
+    VIOLATION_START_ROOM_COUNT,
+    VIOLATION_END_ROOM_COUNT,
+    VIOLATION_DISCONNECTED,
+    NUM_VIOLATION_TYPES
+} violation_t;
+
+/*
+ * The maximum number of violations a report keeps the details of. Every
+ * violation is still counted.
+ */
+#define MAX_RECORDED_VIOLATIONS 64
+
+/*
+ * A single violation. The room is the offending Room (NULL for violations of
+ * the whole world) and other is the connection involved, if any.
+ */
+struct Violation {
+    violation_t type;
+    const struct Room *room;
+    const struct Room *other;
+};
+
+/*
+ * A structure that stores the outcome of verifying a world.
+ */
+struct VerifyReport {
+    size_t num_rooms;
+    size_t num_start_rooms;
+    size_t num_end_rooms;
+    size_t num_components;
+    size_t num_violations;
+    size_t counts[NUM_VIOLATION_TYPES];
+    size_t num_recorded;
+    struct Violation recorded[MAX_RECORDED_VIOLATIONS];
+};
+
+struct VerifyReport *verify_world(const struct RoomList *world,
+        size_t min_connections, size_t num_threads);
+
+void del_verify_report(struct VerifyReport *report);
+
+bool verify_report_ok(const struct VerifyReport *report);
+
+void print_verify_report(const struct VerifyReport *report);
+
+const char *violation_name(const violation_t type);
+
+#endif
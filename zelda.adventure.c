@@ -1,8 +1,11 @@
 #include "room.h"
+#include "room_catalog.h"
 
 int main(int argc, char *argv[]) {
-    struct Room *eastern_palace = new_room("Eastern Palace", START_ROOM);
-    struct Room *house_of_gales = new_room("House of Gales", END_ROOM);
+    struct Room *eastern_palace = new_catalog_room(
+            find_catalog_name("Eastern Palace"), START_ROOM);
+    struct Room *house_of_gales = new_catalog_room(
+            find_catalog_name("House of Gales"), END_ROOM);
 
     add_connection(eastern_palace, house_of_gales);
 